@@ -1,5 +1,8 @@
 
+#include <algorithm>
 #include <iostream>
+#include <cmath>
+#include <cstdio>
 #include <vector>
 #include <chrono>
 #include <iomanip>
@@ -7,13 +10,21 @@
 #include <limits>
 #include <string>
 #include "../common/common.hpp"
+#include "../common/integrand.hpp"
+#include "../common/jobs.hpp"
+#include "../common/profile.hpp"
 #include "../integral_single/single.hpp"
 #include "../integral_parallel/parallel.hpp"
+#include "../integral_parallel/thread_pool.hpp"
+#include "../integral_adaptive/adaptive.hpp"
+#include "../integral_adaptive/progressive.hpp"
+#include "../grid_sampling/sampling.hpp"
 #ifdef ENABLE_OPENMP
 #include "../integral_parallel_omp/omp_parallel.hpp"
 #endif
 #ifdef ENABLE_OPENCL
 #include "../integral_opencl/opencl_impl.hpp"
+#include "../integral_hybrid/hybrid.hpp"
 #endif
 
 // Главный файл приложения для сравнения производительности и точности
@@ -27,6 +38,7 @@ struct ResultRow {
     std::string cpu_parallel;  // результат и время многопоточного CPU
     std::string cpu_openmp;    // результат и время OpenMP
     std::string gpu_opencl;    // результат и время OpenCL
+    std::string hybrid;        // результат и время CPU + OpenCL
     std::string result_check;  // статус проверки
 };
 
@@ -41,6 +53,26 @@ int main() {
         // {30, 100000000}
     };
     std::vector<ResultRow> rows;
+    std::cout << "Batch kernel: " << common::batch_kernel_name() << "\n";
+    // Точность (WEIER_PRECISION=fp64|fp32, WEIER_SUMMATION=plain|kahan|neumaier|pairwise)
+    std::cout << "Precision: " << common::precision_name(common::default_precision()) << "\n";
+    // Размещение потоков (WEIER_PLACEMENT=none|cores|all, WEIER_THREADS)
+    std::cout << "Thread pool: " << integral_parallel::default_pool().describe() << "\n";
+#ifdef ENABLE_OPENMP
+    std::cout << "OpenMP: " << integral_parallel_omp::describe(integral_parallel_omp::default_options()) << "\n";
+#endif
+#ifdef ENABLE_OPENCL
+    // Движок OpenCL создаётся один раз: контекст, очередь и программа общие для всех конфигураций
+    // (устройство выбирается через WEIER_CL_PLATFORM / WEIER_CL_DEVICE / WEIER_CL_TYPE)
+    std::string cl_error;
+    integral_opencl::OpenCLEngine* engine = integral_opencl::default_engine(cl_error);
+    if (engine) {
+        std::cout << "OpenCL device: " << engine->device_name() << " (" << engine->platform_name() << ")"
+                  << (engine->binary_from_cache() ? ", program from cache" : "") << "\n";
+    } else {
+        std::cerr << "OpenCL error: " << cl_error << "\n";
+    }
+#endif
 
     // Основной цикл по конфигурациям
     for (std::size_t idx = 0; idx < configs.size(); ++idx) {
@@ -50,15 +82,19 @@ int main() {
         double b = common::WEIER_B;           // параметр b
         double x0 = common::INTEGRAL_X0;      // левая граница
         double x1 = common::INTEGRAL_X1;      // правая граница
+        // План с коэффициентами a^k, PI*b^k — общий для всех методов
+        auto plan = common::weierstrass_plan(a, b, n);
+        // WEIER_PROFILE=1: отчёт инструментирования по каждой конфигурации
+        if (common::profiling()) common::reset_profile();
 
         // Однопоточное интегрирование
         auto t_single = std::chrono::high_resolution_clock::now();
-        double single_res = integral_single::integrate_weierstrass(a, b, n, x0, x1, steps);
+        double single_res = integral_single::integrate_weierstrass(*plan, x0, x1, steps);
         double single_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_single).count();
 
         // Многопоточное интегрирование (std::thread)
         auto t_parallel = std::chrono::high_resolution_clock::now();
-        double parallel_res = integral_parallel::integrate_weierstrass_parallel(a, b, n, x0, x1, steps);
+        double parallel_res = integral_parallel::integrate_weierstrass_parallel(*plan, x0, x1, steps);
         double parallel_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_parallel).count();
 
         // Интегрирование с помощью OpenMP
@@ -66,36 +102,62 @@ int main() {
 #ifdef ENABLE_OPENMP
         {
             auto t_omp = std::chrono::high_resolution_clock::now();
-            openmp_res = integral_parallel_omp::integrate_weierstrass_parallel_omp(a, b, n, x0, x1, steps);
+            openmp_res = integral_parallel_omp::integrate_weierstrass_parallel_omp(*plan, x0, x1, steps);
             openmp_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_omp).count();
             openmp_available = true;
         }
 #endif
         // Интегрирование на GPU через OpenCL
-        double gpu_res = 0.0; double gpu_time = 0.0; bool gpu_ok = false;
+        double gpu_res = 0.0; double gpu_time = 0.0; bool gpu_ok = false; std::string gpu_variant;
 #ifdef ENABLE_OPENCL
-        {
+        if (engine) {
             auto t_gpu = std::chrono::high_resolution_clock::now();
-            gpu_res = integral_opencl::integrate_weierstrass_opencl(a, b, n, x0, x1, steps, gpu_ok);
+            integral_opencl::Result r = engine->integrate(*plan, x0, x1, steps);
             gpu_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_gpu).count();
+            gpu_ok = r.ok();
+            gpu_res = r.value;
+            gpu_variant = r.variant;
             if (!gpu_ok) {
-                std::cerr << "OpenCL error: " << integral_opencl::last_error() << "\n";
+                std::cerr << "OpenCL error: " << r.error << "\n";
                 gpu_res = std::numeric_limits<double>::quiet_NaN();
             }
         }
 #endif
 
+        // Один интеграл одновременно на устройстве OpenCL и на пуле потоков CPU
+        double hybrid_res = 0.0; double hybrid_time = 0.0; bool hybrid_ok = false;
+#ifdef ENABLE_OPENCL
+        if (engine) {
+            integral_hybrid::HybridStats stats;
+            auto t_hybrid = std::chrono::high_resolution_clock::now();
+            hybrid_res = integral_hybrid::integrate_weierstrass_hybrid(*plan, x0, x1, steps, *engine,
+                                                                       integral_parallel::default_pool(),
+                                                                       integral_hybrid::HybridOptions(), &stats);
+            hybrid_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_hybrid).count();
+            hybrid_ok = true;
+            if (!stats.device_error.empty()) {
+                std::cerr << "[WARN] Hybrid: device failed, CPU finished the range: " << stats.device_error << "\n";
+            }
+            std::cout << "hybrid split (n=" << n << "): cpu " << stats.cpu_points << " points in " << stats.cpu_chunks
+                      << " chunks, device " << stats.device_points << " points in " << stats.device_chunks << " chunks\n";
+        }
+#endif
+
         // Проверка совпадения результатов между методами (single как эталон)
-        bool check_parallel = std::abs(single_res - parallel_res) < 1e-6;
-        bool check_openmp = std::abs(single_res - openmp_res) < 1e-6;
+        // В воспроизводимом режиме CPU реализации обязаны совпасть побитно
+        bool repro = plan->precision().reproducible;
+        bool check_parallel = repro ? parallel_res == single_res : std::abs(single_res - parallel_res) < 1e-6;
+        bool check_openmp = repro ? openmp_res == single_res : std::abs(single_res - openmp_res) < 1e-6;
         bool check_gpu = std::abs(single_res - gpu_res) < 1e-6;
+        bool check_hybrid = std::abs(single_res - hybrid_res) < 1e-6;
+        const char* cpu_tolerance = repro ? " (reproducible: must be 0)" : " > 1e-6";
         if (!check_parallel) {
             std::cerr << "[WARN] CPU parallel mismatch: |single - parallel| = "
-                    << std::abs(single_res - parallel_res) << " > 1e-6\n";
+                    << std::abs(single_res - parallel_res) << cpu_tolerance << "\n";
         }
         if (openmp_available && !check_openmp) {
             std::cerr << "[WARN] OpenMP mismatch: |single - openmp| = "
-                    << std::abs(single_res - openmp_res) << " > 1e-6\n";
+                    << std::abs(single_res - openmp_res) << cpu_tolerance << "\n";
         }
         if (gpu_ok && !check_gpu) {
             // Дополнительная проверка на NaN/Inf для GPU результата
@@ -106,12 +168,85 @@ int main() {
             }
         }
 
+        if (hybrid_ok && !check_hybrid) {
+            std::cerr << "[WARN] Hybrid mismatch: |single - hybrid| = " << std::abs(single_res - hybrid_res) << " > 1e-6\n";
+        }
+
         // Итоговая проверка для всего
-        bool check = check_parallel && (!openmp_available || check_openmp) && (!gpu_ok || check_gpu);
-        std::cout << "finished (n=" << n << ", steps=" << steps << ")\n";
+        bool check = check_parallel && (!openmp_available || check_openmp) && (!gpu_ok || check_gpu)
+                     && (!hybrid_ok || check_hybrid);
+        std::cout << "finished (n=" << n << ", steps=" << steps << ")";
+        if (gpu_ok) std::cout << ", OpenCL kernel: " << gpu_variant;
+        std::cout << "\n";
+        if (common::profiling()) std::cout << common::profile_text(common::profile_report());
+
+        // Адаптивная квадратура с допуском вместо steps: число точек против сетки средних
+        integral_adaptive::AdaptiveOptions adaptive;
+        auto t_adaptive = std::chrono::high_resolution_clock::now();
+        integral_adaptive::AdaptiveResult ar = integral_adaptive::integrate_weierstrass_adaptive(
+            *plan, x0, x1, adaptive, integral_parallel::default_pool());
+        double adaptive_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_adaptive).count();
+        std::cout << "adaptive (n=" << n << ", tol " << adaptive.abs_tol << "): " << std::setprecision(10) << ar.value
+                  << " +- " << std::setprecision(2) << ar.error << ", " << ar.evaluations << " points vs " << steps
+                  << " midpoints, " << ar.filon_terms << " Filon terms, " << std::setprecision(3) << adaptive_time
+                  << "s" << (ar.converged ? "" : " (budget reached)") << ", |adaptive - midpoint| = "
+                  << std::abs(ar.value - single_res) << std::setprecision(6) << "\n";
+
+        // Прогрессивное утроение сетки с экстраполяцией Ричардсона, этапы печатаются по ходу
+        integral_adaptive::ProgressiveOptions progressive;
+        progressive.max_steps = steps;
+        integral_adaptive::ProgressiveResult pr = integral_adaptive::integrate_weierstrass_progressive(
+            *plan, x0, x1, progressive, integral_parallel::default_pool(),
+            [](const integral_adaptive::ProgressiveStage& s) {
+                std::cout << "  stage " << s.stage << ": " << s.steps << " steps, " << std::setprecision(10)
+                          << s.estimate << ", change " << std::setprecision(2) << s.change << ", "
+                          << std::setprecision(3) << s.seconds << "s" << std::setprecision(6) << "\n";
+                return true;
+            });
+        std::cout << "progressive (n=" << n << ", tol " << progressive.abs_tol << "): " << std::setprecision(10)
+                  << pr.value << " after " << pr.stages << " stages, " << pr.evaluations << " points"
+                  << (pr.converged ? "" : " (step limit reached)") << std::setprecision(6) << "\n";
+
+        // Обобщённый движок пула на ядре с n во время компиляции против ядра плана (с поворотом)
+        common::FixedWeierstrass fixed(*plan);
+        auto t_fixed = std::chrono::high_resolution_clock::now();
+        double fixed_res = integral_parallel::integrate(fixed, x0, x1, steps);
+        double fixed_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_fixed).count();
+        std::cout << "fixed-n kernel (n=" << n << (fixed.specialized() ? "" : ", not in the table")
+                  << "): " << fixed_res << " (" << std::setprecision(3) << fixed_time << "s vs " << parallel_time
+                  << "s with the plan kernel)" << std::setprecision(6) << "\n";
+
+        // Таблица первообразной в 1000 точках за один проход по сетке против вызова на точку
+        const std::size_t table_points = 1000;
+        std::vector<double> table(table_points);
+        auto t_table = std::chrono::high_resolution_clock::now();
+        std::string table_error =
+            integral_parallel::cumulative_weierstrass(*plan, x0, x1, table_points, steps / table_points, table.data());
+        double table_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_table).count();
+        if (!table_error.empty()) {
+            std::cout << "cumulative table (" << table_points << " points): " << table_error << "\n";
+        } else {
+            std::cout << "cumulative table (" << table_points << " points): " << std::setprecision(3) << table_time
+                      << "s vs ~" << parallel_time * table_points / 2
+                      << "s for one integral per point, F(x1) - parallel = " << std::setprecision(2)
+                      << table.back() - parallel_res;
+#ifdef ENABLE_OPENMP
+            std::vector<double> omp_table(table_points);
+            auto t_omp_table = std::chrono::high_resolution_clock::now();
+            integral_parallel_omp::cumulative_weierstrass_omp(*plan, x0, x1, table_points, steps / table_points,
+                                                              omp_table.data());
+            double omp_table_time =
+                std::chrono::duration<double>(std::chrono::high_resolution_clock::now()-t_omp_table).count();
+            double diff = 0.0;
+            for (std::size_t j = 0; j < table_points; ++j) diff = std::max(diff, std::abs(omp_table[j] - table[j]));
+            std::cout << ", OpenMP " << std::setprecision(3) << omp_table_time << "s (max diff "
+                      << std::setprecision(2) << diff << ")";
+#endif
+            std::cout << std::setprecision(6) << "\n";
+        }
 
         // Форматирование результатов для вывода
-        std::ostringstream ssSingle, ssParallel, ssOmp, ssGpu;
+        std::ostringstream ssSingle, ssParallel, ssOmp, ssGpu, ssHybrid;
         ssSingle << std::fixed << std::setprecision(6) << single_res << " (" << std::setprecision(3) << single_time << "s)";
         ssParallel << std::fixed << std::setprecision(6) << parallel_res << " (" << std::setprecision(3) << parallel_time << "s)";
         if (openmp_available)
@@ -122,6 +257,10 @@ int main() {
             ssGpu << std::fixed << std::setprecision(6) << gpu_res << " (" << std::setprecision(3) << gpu_time << "s)";
         else
             ssGpu << "N/A";
+        if (hybrid_ok)
+            ssHybrid << std::fixed << std::setprecision(6) << hybrid_res << " (" << std::setprecision(3) << hybrid_time << "s)";
+        else
+            ssHybrid << "N/A";
 
         std::ostringstream cfg;
         cfg << "n=" << n << ", steps=" << steps;
@@ -131,15 +270,102 @@ int main() {
         row.cpu_parallel = ssParallel.str();
         row.cpu_openmp = ssOmp.str();
         row.gpu_opencl = ssGpu.str();
+        row.hybrid = ssHybrid.str();
         row.result_check = check ? "OK" : "FAIL";
         rows.push_back(row);
     }
 
     // Вывод итоговой таблицы результатов
     std::cout << "\nBenchmark Results:\n";
-    std::cout << std::left << std::setw(25) << "Config" << std::setw(30) << "CPU Single" << std::setw(30) << "CPU Parallel" << std::setw(30) << "CPU OpenMP" << std::setw(30) << "GPU OpenCL" << "Check" << "\n";
+    std::cout << std::left << std::setw(25) << "Config" << std::setw(30) << "CPU Single" << std::setw(30) << "CPU Parallel" << std::setw(30) << "CPU OpenMP" << std::setw(30) << "GPU OpenCL" << std::setw(30) << "CPU+OpenCL" << "Check" << "\n";
     for (const auto &r : rows) {
-        std::cout << std::left << std::setw(25) << r.config << std::setw(30) << r.cpu_single << std::setw(30) << r.cpu_parallel << std::setw(30) << r.cpu_openmp << std::setw(30) << r.gpu_opencl << r.result_check << "\n";
+        std::cout << std::left << std::setw(25) << r.config << std::setw(30) << r.cpu_single << std::setw(30) << r.cpu_parallel << std::setw(30) << r.cpu_openmp << std::setw(30) << r.gpu_opencl << std::setw(30) << r.hybrid << r.result_check << "\n";
+    }
+    std::cout << "\n";
+
+    // Пакет мелких заданий: цикл по одиночным вызовам против одного пакетного вызова
+    std::vector<common::IntegralJob> jobs;
+    for (std::size_t j = 0; j < 512; ++j) {
+        common::IntegralJob job;
+        job.a = common::WEIER_A + 0.01 * static_cast<double>(j % 16);
+        job.n = 10;
+        job.x1 = common::INTEGRAL_X1 + 0.01 * static_cast<double>(j);
+        job.steps = 1000;
+        jobs.push_back(job);
+    }
+    std::vector<double> looped(jobs.size()), batched(jobs.size());
+    auto seconds = [](auto&& fn) {
+        auto t = std::chrono::high_resolution_clock::now();
+        fn();
+        return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t).count();
+    };
+    auto report = [&](const char* name, double loop_time, double batch_time) {
+        double dev = 0.0;
+        for (std::size_t j = 0; j < jobs.size(); ++j) dev = std::max(dev, std::abs(looped[j] - batched[j]));
+        std::cout << std::left << std::setw(14) << name << "loop " << std::fixed << std::setprecision(4) << loop_time
+                  << "s, batch " << batch_time << "s (" << std::setprecision(1) << loop_time / batch_time
+                  << "x), max |diff| " << std::scientific << std::setprecision(1) << dev << std::defaultfloat << "\n";
+    };
+    std::cout << "Batch of " << jobs.size() << " jobs (n=10, steps=1000):\n";
+    double loop_time = seconds([&] {
+        for (std::size_t j = 0; j < jobs.size(); ++j)
+            looped[j] = integral_parallel::integrate_weierstrass_parallel(jobs[j].a, jobs[j].b, jobs[j].n, jobs[j].x0,
+                                                                          jobs[j].x1, jobs[j].steps);
+    });
+    double batch_time = seconds([&] {
+        integral_parallel::integrate_weierstrass_batch_parallel(jobs.data(), jobs.size(), batched.data());
+    });
+    report("CPU Parallel", loop_time, batch_time);
+#ifdef ENABLE_OPENMP
+    loop_time = seconds([&] {
+        for (std::size_t j = 0; j < jobs.size(); ++j)
+            looped[j] = integral_parallel_omp::integrate_weierstrass_parallel_omp(jobs[j].a, jobs[j].b, jobs[j].n,
+                                                                                  jobs[j].x0, jobs[j].x1, jobs[j].steps);
+    });
+    batch_time = seconds([&] {
+        integral_parallel_omp::integrate_weierstrass_batch_omp(jobs.data(), jobs.size(), batched.data());
+    });
+    report("CPU OpenMP", loop_time, batch_time);
+#endif
+#ifdef ENABLE_OPENCL
+    if (engine) {
+        std::string error;
+        loop_time = seconds([&] {
+            for (std::size_t j = 0; j < jobs.size() && error.empty(); ++j) {
+                integral_opencl::Result r = engine->integrate(*common::weierstrass_plan(jobs[j].a, jobs[j].b, jobs[j].n),
+                                                              jobs[j].x0, jobs[j].x1, jobs[j].steps);
+                looped[j] = r.value;
+                error = r.error;
+            }
+        });
+        integral_opencl::Result r;
+        batch_time = seconds([&] { r = engine->integrate_batch(jobs.data(), jobs.size(), batched.data()); });
+        if (!error.empty() || !r.ok()) std::cerr << "OpenCL error: " << (error.empty() ? r.error : error) << "\n";
+        else report("GPU OpenCL", loop_time, batch_time);
+    }
+#endif
+
+    // Выгрузка значений на сетке в отображённый файл: пропускная способность в GB/s
+    const std::size_t grid_points = std::size_t(1) << 22;
+    const char* grid_path = "/tmp/weier_benchmark_grid.bin";
+    auto grid_plan = common::weierstrass_plan(common::WEIER_A, common::WEIER_B, 10);
+    std::cout << "Grid sampling (" << grid_points << " points, n=10) into " << grid_path << ":\n";
+    for (auto kernel : {grid_sampling::SampleKernel::Scalar, grid_sampling::SampleKernel::Batch}) {
+        for (std::size_t window : {std::size_t(0), std::size_t(1) << 18}) {
+            grid_sampling::SampleOptions sampling;
+            sampling.kernel = kernel;
+            sampling.window = window;
+            grid_sampling::SampleStats st = grid_sampling::sample_weierstrass_file(
+                *grid_plan, common::INTEGRAL_X0, common::INTEGRAL_X1, grid_points, grid_path,
+                integral_parallel::default_pool(), sampling);
+            std::cout << "  " << (kernel == grid_sampling::SampleKernel::Scalar ? "scalar" : "batch ")
+                      << (window ? " windowed" : " whole   ") << ": ";
+            if (!st.error.empty()) std::cout << st.error << "\n";
+            else std::cout << std::fixed << std::setprecision(3) << st.seconds << "s, " << st.gb_per_second << " GB/s, "
+                           << st.windows << " windows" << (st.huge_pages ? ", huge pages" : "") << std::defaultfloat
+                           << "\n";
+        }
     }
+    std::remove(grid_path);
     std::cout << "\n";
 }
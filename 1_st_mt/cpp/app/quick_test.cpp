@@ -1,9 +1,32 @@
 #include "../common/common.hpp"
+#include "../common/integrand.hpp"
+#include "../common/jobs.hpp"
+#include "../common/mapped_file.hpp"
+#include "../common/profile.hpp"
 #include "../integral_single/single.hpp"
 #include "../integral_parallel/parallel.hpp"
+#include "../integral_parallel/thread_pool.hpp"
+#include "../integral_adaptive/adaptive.hpp"
+#include "../integral_adaptive/progressive.hpp"
+#include "../integral_hybrid/hybrid.hpp"
+#include "../grid_sampling/sampling.hpp"
+#include "../integral_opencl/kernel_source.hpp"
+#ifdef ENABLE_OPENMP
+#include "../integral_parallel_omp/omp_parallel.hpp"
+#endif
+#ifdef ENABLE_OPENCL
+#include "../integral_opencl/opencl_impl.hpp"
+#endif
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
 
 int main() {
     double a = common::WEIER_A;
@@ -20,5 +43,739 @@ int main() {
         return 1;
     }
     std::cout << "OK single vs parallel: " << s << "\n";
+
+    // Отдельный пул с мелким зерном: кража задач не меняет результат
+    // и закрепление за CPU по топологии тоже
+    for (auto placement : {common::Placement::None, common::Placement::All}) {
+        integral_parallel::ThreadPool pool(3, placement);
+        double ps = integral_parallel::integrate_weierstrass_parallel(*common::weierstrass_plan(a, b, n), x0, x1,
+                                                                      steps, pool, 1);
+        if (std::abs(s - ps) > 1e-12) {
+            std::cerr << "Mismatch single vs pool(" << pool.describe() << "): " << s << " vs " << ps << "\n";
+            return 1;
+        }
+    }
+    std::cout << "OK thread pool\n";
+
+    // Блочное SIMD-ядро против скалярной функции, включая огромные аргументы cos
+    double xs[37], out[37];
+    for (int i = 0; i < 37; ++i) xs[i] = x0 + (x1 - x0) * (i + 0.5) / 37.0;
+    common::weierstrass_batch(xs, out, 37, a, b, 30);
+    for (int i = 0; i < 37; ++i) {
+        double ref = common::weierstrass(xs[i], a, b, 30);
+        if (std::abs(ref - out[i]) > 1e-14) {
+            std::cerr << "Mismatch batch (" << common::batch_kernel_name() << ") at x=" << xs[i]
+                      << ": " << out[i] << " vs " << ref << "\n";
+            return 1;
+        }
+    }
+    std::cout << "OK batch kernel: " << common::batch_kernel_name() << "\n";
+
+    // План: кэшируется и побитно совпадает со скалярной функцией
+    auto plan = common::weierstrass_plan(a, b, 30);
+    if (plan != common::weierstrass_plan(a, b, 30) || (*plan)(0.3) != common::weierstrass(0.3, a, b, 30)) {
+        std::cerr << "Plan cache or plan evaluation mismatch\n";
+        return 1;
+    }
+    std::cout << "OK plan\n";
+
+    // Точная редукция: при x = 1/4 и b = 30 слагаемые k >= 2 дают cos(PI * целое),
+    // W = cos(PI/4) - 1/4 + sum_{k=3}^{29} 2^-k
+    auto exact = common::weierstrass_plan(a, b, 30, common::Reduction::Exact);
+    double expected = std::cos(common::PI / 4) - 0.25 + (0.25 - std::ldexp(1.0, -29));
+    if (!exact->exact_reduction() || std::abs((*exact)(0.25) - expected) > 1e-15) {
+        std::cerr << "Exact reduction mismatch: " << (*exact)(0.25) << " vs " << expected << "\n";
+        return 1;
+    }
+    std::cout << "OK exact reduction\n";
+
+    // Fp32: не дальше 1e-7 * sum |a^k| от fp64 в каждой точке, значит и в интеграле
+    common::PrecisionPolicy fp32;
+    fp32.arithmetic = common::Arithmetic::Fp32;
+    double i64 = integral_single::integrate_weierstrass(*common::weierstrass_plan(a, b, 30), x0, x1, steps);
+    double i32 = integral_single::integrate_weierstrass(
+        *common::weierstrass_plan(a, b, 30, common::Reduction::Standard, fp32), x0, x1, steps);
+    if (std::abs(i64 - i32) > 2e-7) {
+        std::cerr << "Fp32 integral deviates: " << i32 << " vs " << i64 << "\n";
+        return 1;
+    }
+    // Neumaier не теряет единицы рядом с большими слагаемыми
+    common::RunningSum neumaier(common::Summation::Neumaier);
+    for (double v : {1.0, 1e100, 1.0, -1e100}) neumaier.add(v);
+    if (neumaier.value() != 2.0) {
+        std::cerr << "Neumaier sum: " << neumaier.value() << " instead of 2\n";
+        return 1;
+    }
+    std::cout << "OK precision\n";
+
+    // Воспроизводимая редукция: побитно одинаково при любом числе потоков и зерне
+    common::PrecisionPolicy repro;
+    repro.reproducible = true;
+    auto rplan = common::weierstrass_plan(a, b, 20, common::Reduction::Standard, repro);
+    double r1 = integral_single::integrate_weierstrass(*rplan, x0, x1, 100000);
+    for (unsigned threads : {1u, 3u}) {
+        for (std::size_t grain : {std::size_t(0), std::size_t(1)}) {
+            integral_parallel::ThreadPool pool(threads);
+            double rp = integral_parallel::integrate_weierstrass_parallel(*rplan, x0, x1, 100000, pool, grain);
+            if (rp != r1) {
+                std::cerr << "Reproducible sum differs: " << threads << " threads, grain " << grain << ": "
+                          << rp << " vs " << r1 << "\n";
+                return 1;
+            }
+        }
+    }
+    std::cout << "OK reproducible\n";
+
+    // Поворот по сетке. Сегменты выровнены по глобальному i и считаются целиком,
+    // так что диапазон из одной точки i даёт её значение через i % ROTATION_RESEED
+    // шагов поворота от пересева. Несколько сегментов, n до 30 (слагаемые у порога
+    // 2^47) и x0 вдали от нуля: каждая точка — против скалярной функции в пределах
+    // оценки из common.hpp, сумма длинного диапазона — против суммы этих значений
+    {
+        const double eps = std::ldexp(1.0, -53);
+        const std::size_t R = common::ROTATION_RESEED, points = 5 * R + 13;
+        const double rh = 1.0 / 10007.0;
+        for (std::size_t rn : {std::size_t(5), std::size_t(10), std::size_t(20), std::size_t(30)}) {
+            auto rplan = common::weierstrass_plan(a, b, rn);
+            for (double rx0 : {0.0, 100.3}) {
+                double worst = 0.0, values = 0.0;
+                for (std::size_t i = 0; i < points; ++i) {
+                    double xi = rx0 + rh * (static_cast<double>(i) + 0.5);
+                    double v = common::weierstrass_midpoint_sum_rotation(*rplan, rx0, rh, i, i + 1);
+                    double d = std::abs(v - common::weierstrass(xi, a, b, rn));
+                    // Оценка по вращаемым слагаемым сегмента плюс округление прямых
+                    std::size_t seg = i - i % R;
+                    double xmax = std::max(std::abs(rx0 + rh * (static_cast<double>(seg) + 0.5)),
+                                           std::abs(rx0 + rh * (static_cast<double>(seg + R - 1) + 0.5)));
+                    double j = static_cast<double>(i % R), bound = 0.0;
+                    for (std::size_t k = 0; k < rn; ++k) {
+                        double amp = std::abs(rplan->amp()[k]), freq = std::abs(rplan->freq()[k]);
+                        bound += 4.0 * eps * amp;
+                        if (freq * xmax < 140737488355328.0)   // 2^47
+                            bound += amp * (5.0 * j * eps + eps * freq * (4.0 * std::abs(xi) + j * rh));
+                    }
+                    if (d > bound) {
+                        std::cerr << "Rotation n=" << rn << " x0=" << rx0 << " point " << i << ": deviation " << d
+                                  << " above the bound " << bound << "\n";
+                        return 1;
+                    }
+                    worst = std::max(worst, d);
+                    values += v;
+                }
+                double whole = common::weierstrass_midpoint_sum_rotation(*rplan, rx0, rh, 0, points);
+                if (std::abs(whole - values) > 1e-13 * static_cast<double>(points)) {
+                    std::cerr << "Rotation range sum " << whole << " is not the sum of its points " << values << "\n";
+                    return 1;
+                }
+                if (rn != 5 && rn != 30) continue;
+                std::cout << "  rotation n=" << rn << " x0=" << rx0 << ": max |rotated - scalar| " << worst << "\n";
+            }
+        }
+    }
+    std::cout << "OK rotation\n";
+
+    // Пакет: задания с разными (a, b, n), интервалами и длинами, пустое задание;
+    // длинное задание режется на куски мелким зерном
+    std::vector<common::IntegralJob> jobs;
+    for (std::size_t j = 0; j < 24; ++j) {
+        common::IntegralJob job;
+        job.a = j % 3 == 0 ? 0.7 : a;
+        job.n = 5 + j % 4 * 5;
+        job.x0 = -0.25 * static_cast<double>(j % 2);
+        job.steps = 500 + 97 * j;
+        jobs.push_back(job);
+    }
+    jobs[5].steps = 0;
+    jobs[7].steps = 50000;
+    std::vector<double> single_batch(jobs.size()), pool_batch(jobs.size());
+    integral_single::integrate_weierstrass_batch(jobs.data(), jobs.size(), single_batch.data());
+    integral_parallel::ThreadPool batch_pool(3);
+    integral_parallel::integrate_weierstrass_batch_parallel(jobs.data(), jobs.size(), pool_batch.data(), batch_pool,
+                                                            common::BATCH_BLOCK);
+    for (std::size_t j = 0; j < jobs.size(); ++j) {
+        const common::IntegralJob& job = jobs[j];
+        double ref = job.steps ? integral_single::integrate_weierstrass(job.a, job.b, job.n, job.x0, job.x1, job.steps)
+                               : 0.0;
+        if (std::abs(single_batch[j] - ref) > 1e-12 || std::abs(pool_batch[j] - ref) > 1e-12) {
+            std::cerr << "Batch job " << j << ": " << single_batch[j] << ", " << pool_batch[j] << " vs " << ref << "\n";
+            return 1;
+        }
+    }
+    common::BatchPlan shared(jobs.data(), jobs.size());
+    if (shared.distinct_plans() != 8) {
+        std::cerr << "Batch built " << shared.distinct_plans() << " plans for 8 parameter sets\n";
+        return 1;
+    }
+    // Наборы различаются побитно: 0.0 и -0.0 — два плана, два одинаковых NaN — один
+    {
+        std::vector<common::IntegralJob> signed_jobs(4);
+        signed_jobs[0].b = 0.0;
+        signed_jobs[1].b = -0.0;
+        signed_jobs[2].b = signed_jobs[3].b = std::nan("");
+        common::BatchPlan signed_plan(signed_jobs.data(), signed_jobs.size());
+        if (signed_plan.distinct_plans() != 3) {
+            std::cerr << "Batch built " << signed_plan.distinct_plans() << " plans for b = 0, -0, NaN, NaN\n";
+            return 1;
+        }
+    }
+    std::cout << "OK batch\n";
+
+    // Адаптивная квадратура против точного интеграла sum a^k (sin(w x1) - sin(w x0)) / w
+    // на несимметричном отрезке; без Филона — только при малом n. При n = 20 с порогом
+    // 8 Филон берёт все быстрые члены на первой же панели, поэтому при n >= 10 ещё два
+    // случая, где отрезок действительно дробится: порог 100 и Филон выключен на коротком
+    // отрезке у нуля (там округление x не шумит в старших членах)
+    struct AdaptiveCase {
+        std::size_t n;
+        double lo, hi;
+        bool filon;
+        double cutoff, tol;
+        bool refines;
+    };
+    for (const AdaptiveCase& c : {AdaptiveCase{3, 0.1, 0.73, false, 8.0, 1e-12, true},
+                                  AdaptiveCase{20, 0.1, 0.73, true, 8.0, 1e-12, false},
+                                  AdaptiveCase{20, 0.1, 0.73, true, 100.0, 1e-12, true},
+                                  AdaptiveCase{10, 1e-11, 1.1e-10, false, 8.0, 1e-22, true}}) {
+        auto aplan = common::weierstrass_plan(a, b, c.n);
+        double exact = common::weierstrass_integral(*aplan, c.lo, c.hi);
+        integral_adaptive::AdaptiveOptions opt;
+        opt.abs_tol = c.tol;
+        opt.filon = c.filon;
+        opt.filon_cutoff = c.cutoff;
+        integral_adaptive::AdaptiveResult ar = integral_adaptive::integrate_weierstrass_adaptive(*aplan, c.lo, c.hi, opt);
+        integral_parallel::ThreadPool apool(3);
+        integral_adaptive::AdaptiveResult ap =
+            integral_adaptive::integrate_weierstrass_adaptive(*aplan, c.lo, c.hi, opt, apool);
+        std::cout << "  adaptive n=" << c.n << " on [" << c.lo << ", " << c.hi << "]"
+                  << (c.filon ? ", filon cutoff " + std::to_string(static_cast<int>(c.cutoff)) : ", no filon")
+                  << ": |err| " << std::abs(ar.value - exact) << ", estimate " << ar.error << ", " << ar.evaluations
+                  << " points, " << ar.panels << " panels, " << ar.filon_terms << " filon terms\n";
+        if (!ar.converged || std::abs(ar.value - exact) > 10 * opt.abs_tol || ap.value != ar.value ||
+            ap.evaluations != ar.evaluations || ap.panels != ar.panels || ap.filon_terms != ar.filon_terms ||
+            (c.refines && ar.panels < 8)) {
+            std::cerr << "Adaptive n=" << c.n << ": " << ar.value << " / " << ap.value << " vs " << exact << "\n";
+            return 1;
+        }
+    }
+    std::cout << "OK adaptive\n";
+
+    // Прогрессивное утроение: последняя сетка совпадает с прямым счётом на ней,
+    // пул даёт то же, что один поток, обратный вызов — по разу на этап
+    {
+        auto pplan = common::weierstrass_plan(a, b, 3);
+        double lo = 0.1, hi = 0.73, exact = 0.0;
+        for (std::size_t k = 0; k < 3; ++k) {
+            double w = pplan->freq()[k];
+            exact += pplan->amp()[k] * (std::sin(w * hi) - std::sin(w * lo)) / w;
+        }
+        integral_adaptive::ProgressiveOptions opt;
+        opt.initial_steps = 101;
+        opt.abs_tol = 1e-12;
+        std::vector<integral_adaptive::ProgressiveStage> stages;
+        integral_adaptive::ProgressiveResult pr = integral_adaptive::integrate_weierstrass_progressive(
+            *pplan, lo, hi, opt, [&](const integral_adaptive::ProgressiveStage& s) {
+                stages.push_back(s);
+                return true;
+            });
+        integral_parallel::ThreadPool ppool(3);
+        integral_adaptive::ProgressiveResult pp =
+            integral_adaptive::integrate_weierstrass_progressive(*pplan, lo, hi, opt, ppool);
+        double direct = integral_single::integrate_weierstrass(*pplan, lo, hi, pr.steps);
+        std::cout << "  progressive: " << pr.stages << " stages, " << pr.steps << " steps, |err| "
+                  << std::abs(pr.value - exact) << ", |midpoint - direct| " << std::abs(stages.back().midpoint - direct)
+                  << "\n";
+        if (!pr.converged || stages.size() != pr.stages || pr.evaluations != pr.steps ||
+            std::abs(pr.value - exact) > 1e-11 || std::abs(stages.back().midpoint - direct) > 1e-12 ||
+            std::abs(pp.value - pr.value) > 1e-13 || pp.steps != pr.steps) {
+            std::cerr << "Progressive: " << pr.value << " / " << pp.value << " vs " << exact << "\n";
+            return 1;
+        }
+        // Остановка из обратного вызова
+        integral_adaptive::ProgressiveResult stop = integral_adaptive::integrate_weierstrass_progressive(
+            *pplan, lo, hi, opt, [](const integral_adaptive::ProgressiveStage& s) { return s.stage < 1; });
+        if (stop.stages != 2 || stop.converged) {
+            std::cerr << "Progressive callback did not stop the run\n";
+            return 1;
+        }
+    }
+    std::cout << "OK progressive\n";
+
+    // Обобщённые движки: произвольное ядро, WeierstrassN<N> и ядра с n во время компиляции
+    {
+        integral_parallel::ThreadPool gpool(3);
+        auto expf = [](double x) { return std::exp(x); };
+        double e1 = std::exp(1.0) - 1.0;
+        double es = integral_single::integrate(expf, 0.0, 1.0, 100000);
+        double ep = integral_parallel::integrate(expf, 0.0, 1.0, 100000, gpool);
+        if (std::abs(es - e1) > 1e-10 || std::abs(ep - es) > 1e-14) {
+            std::cerr << "Generic exp integral: " << es << " / " << ep << " vs " << e1 << "\n";
+            return 1;
+        }
+        // Воспроизводимый режим из precision() ядра: пул и один поток совпадают побитно
+        struct Repro {
+            common::PrecisionPolicy policy{common::Arithmetic::Fp64, common::Summation::Plain, true};
+            double operator()(double x) const { return 1.0 / (1.0 + x * x); }
+            const common::PrecisionPolicy& precision() const { return policy; }
+        } repro;
+        double rs = integral_single::integrate(repro, 0.0, 1.0, 50001);
+        double rp = integral_parallel::integrate(repro, 0.0, 1.0, 50001, gpool, 4096);
+        if (rs != rp || std::abs(4.0 * rs - common::PI) > 1e-9) {
+            std::cerr << "Generic reproducible: " << rs << " / " << rp << "\n";
+            return 1;
+        }
+
+        auto fplan = common::weierstrass_plan(a, b, 5);
+        common::WeierstrassN<5> w5(a, b);
+        for (double x : {0.0, 0.123, 0.5, 0.987654321}) {
+            if (w5(x) != (*fplan)(x)) {
+                std::cerr << "WeierstrassN<5>(" << x << ") = " << w5(x) << " vs plan " << (*fplan)(x) << "\n";
+                return 1;
+            }
+        }
+        common::FixedWeierstrass fixed(*fplan);
+        if (!fixed.specialized() || common::fixed_block_kernel(0) ||
+            common::fixed_block_kernel(common::MAX_FIXED_N + 1) || !common::fixed_block_kernel(common::MAX_FIXED_N)) {
+            std::cerr << "Fixed-n kernel table has wrong entries\n";
+            return 1;
+        }
+        // Ядро с n во время компиляции побитно совпадает с пакетным ядром плана,
+        // включая хвост блока и аргументы редукции Пэйна–Ханека
+        std::vector<double> fxs(13), fgot(13), fref(13);
+        for (std::size_t i = 0; i < fxs.size(); ++i) fxs[i] = 0.37 * static_cast<double>(i) - 2.0;
+        fxs[11] = 1e10;
+        fxs[12] = -3.5e15;
+        for (std::size_t fn_n : {std::size_t(1), std::size_t(5), std::size_t(17), common::MAX_FIXED_N}) {
+            auto p = common::weierstrass_plan(a, b, fn_n);
+            common::fixed_block_kernel(fn_n)(p->amp(), p->freq(), fxs.data(), fgot.data(), fxs.size());
+            common::weierstrass_batch(*p, fxs.data(), fref.data(), fxs.size());
+            if (fgot != fref) {
+                std::cerr << "Fixed-n kernel n=" << fn_n << " differs from the batch kernel\n";
+                return 1;
+            }
+        }
+        if (w5.midpoint_sum(x0, 1e-5, 3, 1000) != common::weierstrass_midpoint_sum(*fplan, x0, 1e-5, 3, 1000) ||
+            fixed.midpoint_sum(x0, 1e-5, 3, 1000) != common::weierstrass_midpoint_sum(*fplan, x0, 1e-5, 3, 1000)) {
+            std::cerr << "Fixed-n range sum differs from weierstrass_midpoint_sum\n";
+            return 1;
+        }
+        auto fplan32 = common::weierstrass_plan(a, b, 5, common::Reduction::Standard,
+                                                {common::Arithmetic::Fp32, common::Summation::Pairwise, false});
+        if (common::FixedWeierstrass(*fplan32).specialized()) {
+            std::cerr << "Fp32 plan took the fixed-n fp64 kernel\n";
+            return 1;
+        }
+        double fs = integral_parallel::integrate(fixed, x0, x1, steps, gpool);
+        double ns = integral_single::integrate(w5, x0, x1, steps);
+        double ps = integral_single::integrate_weierstrass(*fplan, x0, x1, steps);
+        std::cout << "  fixed n=5: |fixed - plan| " << std::abs(fs - ps) << ", |WeierstrassN - fixed| "
+                  << std::abs(ns - fs) << "\n";
+        if (std::abs(fs - ps) > 1e-10 || std::abs(ns - fs) > 1e-14) {
+            std::cerr << "Fixed-n integral: " << fs << " / " << ns << " vs plan " << ps << "\n";
+            return 1;
+        }
+    }
+    std::cout << "OK integrand\n";
+
+    // Таблица первообразной: значения в узлах против прямых интегралов, последний — весь отрезок;
+    // воспроизводимый план даёт одну таблицу на любом пуле, файл совпадает с буфером
+    {
+        const std::size_t count = 1000, per_point = 37;
+        auto cplan = common::weierstrass_plan(a, b, 5);
+        integral_parallel::ThreadPool cpool(3), one(1);
+        std::vector<double> table(count);
+        std::string cerror = integral_parallel::cumulative_weierstrass(*cplan, x0, x1, count, per_point, table.data(),
+                                                                       cpool);
+        double whole = integral_single::integrate_weierstrass(*cplan, x0, x1, count * per_point);
+        double worst = std::abs(table.back() - whole);
+        for (std::size_t j : {std::size_t(0), std::size_t(17), std::size_t(500), count - 2}) {
+            double xj = x0 + (x1 - x0) * static_cast<double>(j + 1) / static_cast<double>(count);
+            worst = std::max(worst, std::abs(table[j] - integral_single::integrate_weierstrass(*cplan, x0, xj,
+                                                                                             (j + 1) * per_point)));
+        }
+        std::vector<double> exps(count);
+        integral_parallel::cumulative([](double x) { return std::exp(x); }, 0.0, 1.0, count, 8, exps.data(), cpool);
+        double exp_err = 0.0;
+        for (std::size_t j = 0; j < count; ++j)
+            exp_err = std::max(exp_err, std::abs(exps[j] - std::expm1(static_cast<double>(j + 1) / count)));
+        std::cout << "  cumulative: |table - direct| " << worst << ", exp table error " << exp_err << "\n";
+        if (!cerror.empty() || worst > 1e-13 || exp_err > 3e-9) {
+            std::cerr << "Cumulative table off: " << cerror << " " << worst << ", " << exp_err << "\n";
+            return 1;
+        }
+
+        common::PrecisionPolicy rp;
+        rp.reproducible = true;
+        auto rplan = common::weierstrass_plan(a, b, 5, common::Reduction::Standard, rp);
+        std::vector<double> r1(count), r3(count);
+        integral_parallel::cumulative_weierstrass(*rplan, x0, x1, count, per_point, r1.data(), one);
+        integral_parallel::cumulative_weierstrass(*rplan, x0, x1, count, per_point, r3.data(), cpool);
+        if (r1 != r3) {
+            std::cerr << "Reproducible cumulative table depends on the pool\n";
+            return 1;
+        }
+
+        const char* path = "/tmp/weier_quick_test_cumulative.bin";
+        std::string error = integral_parallel::cumulative_weierstrass_file(*cplan, x0, x1, count, per_point, path, cpool);
+        std::vector<double> back(count);
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(back.data()), static_cast<std::streamsize>(count * sizeof(double)));
+        std::remove(path);
+        if (!error.empty() || !in || back != table) {
+            std::cerr << "Cumulative file: " << (error.empty() ? "contents differ" : error) << "\n";
+            return 1;
+        }
+
+        // Таблица без участков, участок без точек и переполненная сетка — ошибка;
+        // out не трогается, файл не создаётся
+        std::vector<double> untouched(2, 7.0);
+        bool rejected =
+            !integral_parallel::cumulative_weierstrass(*cplan, x0, x1, 2, 0, untouched.data(), cpool).empty() &&
+            !integral_parallel::cumulative_weierstrass(*cplan, x0, x1, 0, per_point, untouched.data(), cpool).empty() &&
+            !integral_parallel::cumulative_weierstrass(*cplan, x0, x1, 2, static_cast<std::size_t>(-1) / 2 + 1,
+                                                      untouched.data(), cpool).empty() &&
+            !integral_parallel::cumulative_weierstrass_file(*cplan, x0, x1, 0, per_point, path, cpool).empty();
+        if (!rejected || untouched != std::vector<double>(2, 7.0) || std::ifstream(path)) {
+            std::cerr << "Cumulative table accepted an empty grid\n";
+            return 1;
+        }
+    }
+    std::cout << "OK cumulative\n";
+
+    // Сетка значений: буфер побитно равен скалярной функции, файл целиком и окнами —
+    // буферу, поток по окнам — тоже; SIMD-ядро в пределах 1e-14
+    {
+        const std::size_t count = 100003;
+        auto splan = common::weierstrass_plan(a, b, 10);
+        integral_parallel::ThreadPool spool(3);
+        grid_sampling::SampleOptions sopt;
+        sopt.block = 1000;
+        std::vector<double> grid(count);
+        grid_sampling::sample_weierstrass(*splan, x0, x1, count, grid.data(), spool, sopt);
+        double h = grid_sampling::grid_step(x0, x1, count);
+        for (std::size_t i = 0; i < count; ++i) {
+            if (grid[i] != common::weierstrass(x0 + h * static_cast<double>(i), a, b, 10)) {
+                std::cerr << "Sample " << i << " differs from the scalar function\n";
+                return 1;
+            }
+        }
+        for (std::size_t window : {std::size_t(0), std::size_t(5000)}) {
+            const char* path = "/tmp/weier_quick_test_grid.bin";
+            sopt.window = window;
+            grid_sampling::SampleStats st = grid_sampling::sample_weierstrass_file(*splan, x0, x1, count, path, spool, sopt);
+            grid_sampling::SampleHeader header;
+            std::string error = st.error.empty() ? grid_sampling::read_sample_header(path, header) : st.error;
+            std::vector<double> back(count);
+            std::ifstream in(path, std::ios::binary);
+            in.seekg(static_cast<std::streamoff>(header.data_offset));
+            in.read(reinterpret_cast<char*>(back.data()), static_cast<std::streamsize>(count * sizeof(double)));
+            std::remove(path);
+            std::cout << "  grid file (window " << window << "): " << st.windows << " windows, " << st.gb_per_second
+                      << " GB/s" << (st.huge_pages ? ", huge pages" : "") << "\n";
+            if (!error.empty() || !in || back != grid || header.count != count || header.h != h || header.n != 10) {
+                std::cerr << "Grid file: " << (error.empty() ? "contents differ" : error) << "\n";
+                return 1;
+            }
+        }
+        std::vector<double> streamed;
+        sopt.window = 4096;
+        grid_sampling::SampleStats st = grid_sampling::sample_weierstrass_stream(
+            *splan, x0, x1, count, [&](const double* values, std::size_t first, std::size_t m) {
+                if (first != streamed.size() ||
+                    reinterpret_cast<std::uintptr_t>(values) % common::MappedFile::page_size() != 0)
+                    return false;
+                streamed.insert(streamed.end(), values, values + m);
+                return true;
+            }, spool, sopt);
+        std::size_t windows = 0;
+        grid_sampling::sample_weierstrass_stream(
+            *splan, x0, x1, count, [&](const double*, std::size_t, std::size_t) { return ++windows < 2; }, spool, sopt);
+        sopt.kernel = grid_sampling::SampleKernel::Batch;
+        std::vector<double> fast(count);
+        grid_sampling::sample_weierstrass(*splan, x0, x1, count, fast.data(), spool, sopt);
+        double worst = 0.0;
+        for (std::size_t i = 0; i < count; ++i) worst = std::max(worst, std::abs(fast[i] - grid[i]));
+        if (streamed != grid || st.windows != (count + 4095) / 4096 || windows != 2 || worst > 1e-14) {
+            std::cerr << "Grid stream / batch kernel: " << st.windows << " windows, batch off by " << worst << "\n";
+            return 1;
+        }
+    }
+    std::cout << "OK sampling\n";
+
+    // Эталон в замкнутом виде и оценка ошибки правила средних (weier_suite):
+    // оценка держит и сетки с наложением частот, и узкая там, где его нет
+    {
+        auto one = common::weierstrass_plan(a, b, 1);
+        double direct = (std::sin(common::PI * 0.7) - std::sin(common::PI * 0.1)) / common::PI;
+        if (std::abs(common::weierstrass_integral(*one, 0.1, 0.7) - direct) > 1e-15) {
+            std::cerr << "Closed form n=1: " << common::weierstrass_integral(*one, 0.1, 0.7) << " vs " << direct << "\n";
+            return 1;
+        }
+        struct Case { std::size_t n, steps; double x0, x1, tight; };
+        for (const Case& c : {Case{10, 10000, 0.0, 1.0, 0.1}, Case{30, 100000, 0.0, 1.0, 0.1},
+                              Case{5, 999983, 0.0, 0.7, 1e-5}, Case{20, 12345, -0.3, 0.4, 0.1}}) {
+            auto rplan = common::weierstrass_plan(a, b, c.n);
+            double exact = common::weierstrass_integral(*rplan, c.x0, c.x1);
+            double bound = common::midpoint_error_bound(*rplan, c.x0, c.x1, c.steps);
+            double err = std::abs(integral_single::integrate_weierstrass(*rplan, c.x0, c.x1, c.steps) - exact);
+            std::cout << "  analytic n=" << c.n << " steps=" << c.steps << ": |err| " << err << ", bound " << bound
+                      << "\n";
+            if (err > bound || bound > c.tight) {
+                std::cerr << "Analytic check n=" << c.n << ": error " << err << ", bound " << bound << "\n";
+                return 1;
+            }
+        }
+    }
+    std::cout << "OK analytic\n";
+
+    // Инструментирование: у каждого исполнителя пула своя запись, задачи
+    // учтены; выключенный профиль ничего не пишет
+    {
+        auto pplan = common::weierstrass_plan(a, b, n);
+        integral_parallel::ThreadPool pool(3);
+        common::set_profiling(true);
+        common::reset_profile();
+        integral_parallel::integrate_weierstrass_parallel(*pplan, x0, x1, steps, pool, 100);
+        integral_single::integrate_weierstrass(*pplan, x0, x1, steps);
+        common::set_profiling(false);
+        common::ProfileReport report = common::profile_report();
+        std::size_t tasks = 0;
+        for (const auto& w : report.workers)
+            if (w.group == "pool 3") tasks += w.tasks;
+        auto group = std::find_if(report.groups.begin(), report.groups.end(),
+                                  [](const common::GroupProfile& g) { return g.group == "pool 3"; });
+        bool single = std::any_of(report.groups.begin(), report.groups.end(),
+                                  [](const common::GroupProfile& g) { return g.group == "single 1"; });
+        if (group == report.groups.end() || group->workers != 3 || group->runs != 1 || tasks == 0 ||
+            group->busy <= 0.0 || group->imbalance < 1.0 || !single) {
+            std::cerr << "Profile:\n" << common::profile_text(report);
+            return 1;
+        }
+        integral_parallel::integrate_weierstrass_parallel(*pplan, x0, x1, steps, pool, 100);
+        if (common::profile_report().workers.size() != report.workers.size()) {
+            std::cerr << "Profile records while profiling is off\n";
+            return 1;
+        }
+        common::reset_profile();
+        std::cout << "  counters: " << report.counters << "\n";
+    }
+    std::cout << "OK profile\n";
+
+    // Гибрид CPU + устройство на подменном устройстве: планировщик раздаёт
+    // каждую точку ровно один раз и делит остаток по скоростям сторон
+    {
+        integral_hybrid::HybridOptions options;
+        options.min_chunk = 1000;
+        options.target_seconds = 0.01;
+        integral_hybrid::ChunkScheduler sched(100000, options);
+        std::size_t begin = 0, end = 0, covered = 0;
+        bool contiguous = true;
+        auto take = [&](int side) {
+            if (!sched.take(side, begin, end)) return false;
+            contiguous = contiguous && begin == covered;
+            covered = end;
+            return true;
+        };
+        using integral_hybrid::ChunkScheduler;
+        // Первые куски — замер скорости: по min_chunk
+        bool first = take(ChunkScheduler::CPU) && end - begin == 1000 && take(ChunkScheduler::Device) &&
+                     end - begin == 1000;
+        // 1e6 и 1e7 точек/с: по скорости куски 1e4 и 1e5, но не больше доли остатка (1/11 и 10/11)
+        sched.record(ChunkScheduler::CPU, 1000, 1e-3);
+        sched.record(ChunkScheduler::Device, 1000, 1e-4);
+        std::size_t cpu_chunk = static_cast<std::size_t>(98000.0 * (1e6 / 1.1e7));
+        std::size_t device_chunk = static_cast<std::size_t>((98000.0 - cpu_chunk) * (1e7 / 1.1e7));
+        bool sized = take(ChunkScheduler::CPU) && end - begin == cpu_chunk && take(ChunkScheduler::Device) &&
+                     end - begin == device_chunk;
+        sched.device_failed();   // CPU один: доля остатка — весь остаток
+        while (take(ChunkScheduler::CPU)) {}
+        if (!first || !sized || !contiguous || covered != 100000 || sched.take(ChunkScheduler::Device, begin, end)) {
+            std::cerr << "Hybrid scheduler: first " << first << ", sized " << sized << ", contiguous " << contiguous
+                      << ", covered " << covered << "\n";
+            return 1;
+        }
+
+        auto hplan = common::weierstrass_plan(a, b, n);
+        std::size_t hsteps = 200000;
+        double hh = (x1 - x0) / static_cast<double>(hsteps);
+        double reference = integral_single::integrate_weierstrass(*hplan, x0, x1, hsteps);
+        integral_parallel::ThreadPool pool(2);
+        // fail_at — номер вызова, на котором устройство ломается (0 — не ломается)
+        for (std::size_t fail_at : {0, 1, 3}) {
+            std::mutex mutex;
+            std::vector<char> seen(hsteps, 0);
+            std::size_t calls = 0;
+            bool twice = false;
+            integral_hybrid::DeviceSum device = [&](std::size_t lo, std::size_t hi, double& sum) -> std::string {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (++calls == fail_at) return "fake device lost";
+                    for (std::size_t i = lo; i < hi; ++i) twice = twice || seen[i]++;
+                }
+                sum = common::weierstrass_midpoint_sum_rotation(*hplan, x0, hh, lo, hi);
+                return "";
+            };
+            integral_hybrid::HybridStats stats;
+            double r = integral_hybrid::integrate_weierstrass_hybrid(*hplan, x0, x1, hsteps, device, pool, options,
+                                                                     &stats);
+            // Первый кусок всегда у устройства; до третьего вызова оно может не дойти
+            bool failed = fail_at != 0 && calls >= fail_at;
+            if (twice || std::abs(r - reference) > 1e-12 || stats.cpu_points + stats.device_points != hsteps ||
+                stats.device_error.empty() == failed || (fail_at == 1 && (!failed || stats.device_points != 0))) {
+                std::cerr << "Hybrid (device fails at call " << fail_at << "): " << r << " vs " << reference
+                          << ", cpu " << stats.cpu_points << ", device " << stats.device_points << ", error '"
+                          << stats.device_error << "'\n";
+                return 1;
+            }
+        }
+    }
+    std::cout << "OK hybrid scheduler\n";
+
+    // Арифметика варианта Mixed на хосте (константы и операции ядра): при b = 30
+    // аргументы старших слагаемых на [0, 1] выходят за 2^53, у x0 = 100.3 — раньше;
+    // среднее и худшее |mixed - double| в долях sum |a^k|. При a = 1 старшие
+    // слагаемые весят столько же, сколько младшие
+    {
+        double worst_mean = 0.0, worst_max = 0.0;
+        for (double ma : {a, 1.0}) {
+            for (std::size_t mn : {std::size_t(10), std::size_t(20), std::size_t(30)}) {
+                auto mplan = common::weierstrass_plan(ma, b, mn);
+                std::string src = integral_opencl::detail::specialized_source(*mplan, integral_opencl::Precision::Mixed, 4);
+                if (src.find("MIXED_LIMIT") == std::string::npos) {
+                    std::cerr << "Mixed kernel source has no double cos beyond the reduction range\n";
+                    return 1;
+                }
+                double scale = 0.0;
+                for (std::size_t k = 0; k < mn; ++k) scale += std::abs(mplan->amp()[k]);
+                for (double mx0 : {0.0, 100.3}) {
+                    const std::size_t points = 10007;
+                    double sum = 0.0, worst = 0.0;
+                    for (std::size_t i = 0; i < points; ++i) {
+                        double x = mx0 + (static_cast<double>(i) + 0.5) / points;
+                        double d = std::abs(integral_opencl::detail::mixed_point_host(*mplan, x) - (*mplan)(x));
+                        sum += d;
+                        worst = std::max(worst, d);
+                    }
+                    worst_mean = std::max(worst_mean, sum / points / scale);
+                    worst_max = std::max(worst_max, worst / scale);
+                }
+            }
+        }
+        std::cout << "  mixed emulation: mean |mixed - double| " << worst_mean << ", max " << worst_max
+                  << " of sum |a^k|\n";
+        if (worst_mean > 2e-7 || worst_max > 1e-6) {
+            std::cerr << "Mixed arithmetic deviates from double\n";
+            return 1;
+        }
+    }
+    std::cout << "OK mixed emulation\n";
+
+#ifdef ENABLE_OPENMP
+    // OpenMP: воспроизводимый интеграл побитно равен однопоточному при любом числе
+    // потоков и размещении, таблица — таблице пула; fp32, Kahan и пакет — как у пула
+    {
+        for (unsigned threads : {1u, 2u, 3u, 5u}) {
+            for (auto placement : {common::Placement::None, common::Placement::All}) {
+                integral_parallel_omp::OmpOptions omp;
+                omp.threads = threads;
+                omp.placement = placement;
+                double ro = integral_parallel_omp::integrate_weierstrass_parallel_omp(*rplan, x0, x1, 100000, omp);
+                if (ro != r1) {
+                    std::cerr << "Reproducible OpenMP sum differs: " << integral_parallel_omp::describe(omp) << ": "
+                              << ro << " vs " << r1 << "\n";
+                    return 1;
+                }
+            }
+        }
+
+        integral_parallel_omp::OmpOptions omp;
+        omp.threads = 3;
+        const std::size_t count = 1000, per_point = 37;
+        common::PrecisionPolicy rp;
+        rp.reproducible = true;
+        auto cplan = common::weierstrass_plan(a, b, 5, common::Reduction::Standard, rp);
+        integral_parallel::ThreadPool cpool(3);
+        std::vector<double> pool_table(count), omp_table(count), untouched(2, 7.0);
+        std::string perror = integral_parallel::cumulative_weierstrass(*cplan, x0, x1, count, per_point,
+                                                                       pool_table.data(), cpool);
+        std::string oerror = integral_parallel_omp::cumulative_weierstrass_omp(*cplan, x0, x1, count, per_point,
+                                                                               omp_table.data(), omp);
+        bool rejected =
+            !integral_parallel_omp::cumulative_weierstrass_omp(*cplan, x0, x1, 2, 0, untouched.data(), omp).empty();
+        if (!perror.empty() || !oerror.empty() || omp_table != pool_table || !rejected ||
+            untouched != std::vector<double>(2, 7.0)) {
+            std::cerr << "OpenMP cumulative table: " << oerror << (omp_table != pool_table ? " differs" : "") << "\n";
+            return 1;
+        }
+
+        common::PrecisionPolicy kahan;
+        kahan.summation = common::Summation::Kahan;
+        auto kplan = common::weierstrass_plan(a, b, 30, common::Reduction::Standard, kahan);
+        double o32 = integral_parallel_omp::integrate_weierstrass_parallel_omp(
+            *common::weierstrass_plan(a, b, 30, common::Reduction::Standard, fp32), x0, x1, steps, omp);
+        double ok = integral_parallel_omp::integrate_weierstrass_parallel_omp(*kplan, x0, x1, steps, omp);
+        double sk = integral_single::integrate_weierstrass(*kplan, x0, x1, steps);
+        if (std::abs(o32 - i32) > 1e-12 || std::abs(ok - sk) > 1e-12) {
+            std::cerr << "OpenMP precision: fp32 " << o32 << " vs " << i32 << ", kahan " << ok << " vs " << sk << "\n";
+            return 1;
+        }
+
+        std::vector<double> omp_batch(jobs.size());
+        integral_parallel_omp::integrate_weierstrass_batch_omp(jobs.data(), jobs.size(), omp_batch.data(), omp);
+        for (std::size_t j = 0; j < jobs.size(); ++j) {
+            if (std::abs(omp_batch[j] - single_batch[j]) > 1e-12) {
+                std::cerr << "OpenMP batch job " << j << ": " << omp_batch[j] << " vs " << single_batch[j] << "\n";
+                return 1;
+            }
+        }
+    }
+    std::cout << "OK openmp\n";
+#endif
+
+#ifdef ENABLE_OPENCL
+    // Настоящее устройство (на машине без GPU — CPU-рантайм вроде PoCL):
+    // движок и гибрид против однопоточного результата
+    {
+        std::string cl_error;
+        integral_opencl::OpenCLEngine* engine = integral_opencl::default_engine(cl_error);
+        if (!engine) {
+            std::cout << "SKIP opencl: " << cl_error << "\n";
+        } else {
+            auto cplan = common::weierstrass_plan(a, b, n);
+            std::size_t csteps = 1000000;
+            double reference = integral_single::integrate_weierstrass(*cplan, x0, x1, csteps);
+            integral_opencl::Result r = engine->integrate(*cplan, x0, x1, csteps);
+            if (!r.ok() || std::abs(r.value - reference) > 1e-6) {
+                std::cerr << "OpenCL (" << engine->device_name() << "): " << r.value << " vs " << reference << " "
+                          << r.error << "\n";
+                return 1;
+            }
+            // Пакет одним запуском weier_batch против однопоточного пакета
+            std::vector<double> cl_batch(jobs.size());
+            integral_opencl::Result br = engine->integrate_batch(jobs.data(), jobs.size(), cl_batch.data());
+            for (std::size_t j = 0; j < jobs.size() && br.ok(); ++j)
+                if (std::abs(cl_batch[j] - single_batch[j]) > 1e-6) br.error = "job " + std::to_string(j);
+            if (!br.ok()) {
+                std::cerr << "OpenCL batch (" << engine->device_name() << "): " << br.error << "\n";
+                return 1;
+            }
+            integral_hybrid::HybridOptions options;
+            options.min_chunk = 1 << 12;
+            integral_hybrid::HybridStats stats;
+            double hr = integral_hybrid::integrate_weierstrass_hybrid(*cplan, x0, x1, csteps, *engine,
+                                                                      integral_parallel::default_pool(), options,
+                                                                      &stats);
+            if (!stats.device_error.empty() || std::abs(hr - reference) > 1e-6 ||
+                stats.cpu_points + stats.device_points != csteps) {
+                std::cerr << "Hybrid (" << engine->device_name() << "): " << hr << " vs " << reference << ", cpu "
+                          << stats.cpu_points << ", device " << stats.device_points << " " << stats.device_error
+                          << "\n";
+                return 1;
+            }
+            std::cout << "  hybrid on " << engine->device_name() << ": cpu " << stats.cpu_points << ", device "
+                      << stats.device_points << " points\n";
+            std::cout << "OK opencl\n";
+        }
+    }
+#endif
     return 0;
 }
@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../common/common.hpp"
+#include "../common/profile.hpp"
+#include "../integral_single/single.hpp"
+#include "../integral_parallel/parallel.hpp"
+#include "../integral_parallel/thread_pool.hpp"
+#ifdef ENABLE_OPENMP
+#include "../integral_parallel_omp/omp_parallel.hpp"
+#endif
+#ifdef ENABLE_OPENCL
+#include "../integral_opencl/opencl_impl.hpp"
+#endif
+
+// Набор замеров: сетка (бэкенд, n, steps, потоки) из файла настроек и/или
+// командной строки, прогрев и повторы, медиана / p95, оценки в секунду,
+// параллельная эффективность. Проверка — по интегралу конечной суммы в
+// замкнутом виде (common::weierstrass_integral), без однопоточного прогона.
+// Результаты — CSV или JSON в stdout либо в файл, ход работы — в stderr.
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    const char* USAGE =
+        "usage: weier_suite [--config FILE] [--KEY VALUE | --KEY=VALUE]...\n"
+        "keys (also KEY = VALUE lines of the config file, # starts a comment):\n"
+        "  backends  single,parallel,openmp,opencl or all   (default: all built)\n"
+        "  n         list of term counts                     (default: 10,20,30)\n"
+        "  steps     list of midpoint counts, 1e6 accepted   (default: 1e4,1e5,1e6)\n"
+        "  threads   thread counts for parallel and openmp   (default: 1,2,4,... up to the pool size)\n"
+        "  warmup    untimed runs per case                   (default: 1)\n"
+        "  reps      timed runs per case                     (default: 5)\n"
+        "  format    csv or json                             (default: csv)\n"
+        "  output    result file, - for stdout               (default: -)\n"
+        "  profile   1: per-case instrumentation report      (default: WEIER_PROFILE)\n"
+        "  a, b      Weierstrass parameters                  (default: 0.5, 30)\n"
+        "  x0, x1    integration interval                    (default: 0, 1)\n";
+
+    struct SuiteOptions {
+        std::vector<std::string> backends;
+        std::vector<std::size_t> ns = {10, 20, 30};
+        std::vector<std::size_t> steps = {10000, 100000, 1000000};
+        std::vector<unsigned> threads;
+        std::size_t warmup = 1;
+        std::size_t reps = 5;
+        std::string format = "csv";
+        std::string output = "-";
+        double a = common::WEIER_A;
+        double b = common::WEIER_B;
+        double x0 = common::INTEGRAL_X0;
+        double x1 = common::INTEGRAL_X1;
+        bool profile = common::profiling();
+    };
+
+    // Один случай сетки и его статистика
+    struct CaseResult {
+        std::string backend;
+        std::size_t n = 0, steps = 0;
+        unsigned threads = 0;          // 0 — не зависит от потоков CPU (OpenCL)
+        std::vector<double> times;
+        double median = 0.0, p95 = 0.0, min = 0.0, mean = 0.0;
+        double speedup = std::numeric_limits<double>::quiet_NaN();
+        double efficiency = std::numeric_limits<double>::quiet_NaN();
+        double result = 0.0, exact = 0.0, error = 0.0, bound = 0.0;
+        bool ok = false;
+        std::string note;              // вариант ядра OpenCL или причина ошибки
+        common::ProfileReport profile; // повторов, если профиль включён
+    };
+
+    std::vector<std::string> available_backends() {
+        std::vector<std::string> list = {"single", "parallel"};
+#ifdef ENABLE_OPENMP
+        list.push_back("openmp");
+#endif
+#ifdef ENABLE_OPENCL
+        list.push_back("opencl");
+#endif
+        return list;
+    }
+
+    bool threaded(const std::string& backend) { return backend == "parallel" || backend == "openmp"; }
+
+    std::string trim(const std::string& s) {
+        std::size_t lo = s.find_first_not_of(" \t\r");
+        if (lo == std::string::npos) return "";
+        return s.substr(lo, s.find_last_not_of(" \t\r") - lo + 1);
+    }
+
+    std::vector<std::string> split(const std::string& s) {
+        std::vector<std::string> items;
+        std::stringstream in(s);
+        std::string item;
+        while (std::getline(in, item, ',')) {
+            item = trim(item);
+            if (!item.empty()) items.push_back(item);
+        }
+        return items;
+    }
+
+    std::string parse_number(const std::string& key, const std::string& text, double& value) {
+        char* end = nullptr;
+        value = std::strtod(text.c_str(), &end);
+        if (text.empty() || *end != '\0' || !std::isfinite(value)) return key + ": not a number: " + text;
+        return "";
+    }
+
+    // Целые списки принимают и запись 1e6
+    template <class T>
+    std::string parse_counts(const std::string& key, const std::string& text, std::vector<T>& out, double min) {
+        out.clear();
+        for (const std::string& item : split(text)) {
+            double v = 0.0;
+            std::string error = parse_number(key, item, v);
+            if (!error.empty()) return error;
+            if (v < min || v != std::floor(v)) return key + ": expected an integer >= " + std::to_string(int(min)) + ": " + item;
+            out.push_back(static_cast<T>(v));
+        }
+        if (out.empty()) return key + ": empty list";
+        return "";
+    }
+
+    std::string set_option(SuiteOptions& o, const std::string& key, const std::string& value) {
+        if (key == "backends") {
+            o.backends.clear();
+            std::vector<std::string> known = available_backends();
+            for (const std::string& name : split(value)) {
+                if (name == "all") {
+                    o.backends.insert(o.backends.end(), known.begin(), known.end());
+                } else if (std::find(known.begin(), known.end(), name) != known.end()) {
+                    o.backends.push_back(name);
+                } else {
+                    return "backends: " + name + " is unknown or not built";
+                }
+            }
+            if (o.backends.empty()) return "backends: empty list";
+            return "";
+        }
+        if (key == "n") return parse_counts(key, value, o.ns, 1);
+        if (key == "steps") return parse_counts(key, value, o.steps, 1);
+        if (key == "threads") return parse_counts(key, value, o.threads, 1);
+        if (key == "warmup" || key == "reps") {
+            std::vector<std::size_t> v;
+            std::string error = parse_counts(key, value, v, key == "reps" ? 1 : 0);
+            if (error.empty() && v.size() != 1) error = key + ": expected one value";
+            if (error.empty()) (key == "reps" ? o.reps : o.warmup) = v[0];
+            return error;
+        }
+        if (key == "format") {
+            if (value != "csv" && value != "json") return "format: expected csv or json: " + value;
+            o.format = value;
+            return "";
+        }
+        if (key == "output") { o.output = value; return ""; }
+        if (key == "profile") {
+            if (value != "0" && value != "1") return "profile: expected 0 or 1: " + value;
+            o.profile = value == "1";
+            return "";
+        }
+        if (key == "a") return parse_number(key, value, o.a);
+        if (key == "b") return parse_number(key, value, o.b);
+        if (key == "x0") return parse_number(key, value, o.x0);
+        if (key == "x1") return parse_number(key, value, o.x1);
+        return "unknown key: " + key;
+    }
+
+    std::string read_config(SuiteOptions& o, const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return "cannot open " + path;
+        std::string line;
+        for (std::size_t number = 1; std::getline(in, line); ++number) {
+            line = trim(line.substr(0, line.find('#')));
+            if (line.empty()) continue;
+            std::size_t eq = line.find('=');
+            if (eq == std::string::npos) return path + ":" + std::to_string(number) + ": expected KEY = VALUE";
+            std::string error = set_option(o, trim(line.substr(0, eq)), trim(line.substr(eq + 1)));
+            if (!error.empty()) return path + ":" + std::to_string(number) + ": " + error;
+        }
+        return "";
+    }
+
+    // Ключи командной строки применяются по порядку, --config читается на своём месте
+    std::string parse_args(SuiteOptions& o, int argc, char** argv, bool& help) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "-h" || arg == "--help") {
+                help = true;
+                return "";
+            }
+            if (arg.compare(0, 2, "--") != 0) return "unexpected argument: " + arg;
+            std::string key = arg.substr(2), value;
+            std::size_t eq = key.find('=');
+            if (eq != std::string::npos) {
+                value = key.substr(eq + 1);
+                key = key.substr(0, eq);
+            } else if (i + 1 < argc) {
+                value = argv[++i];
+            } else {
+                return "missing value for --" + key;
+            }
+            std::string error = key == "config" ? read_config(o, value) : set_option(o, key, value);
+            if (!error.empty()) return error;
+        }
+        return "";
+    }
+
+    // 1, 2, 4, ... до размера пула по умолчанию (WEIER_THREADS), и сам размер
+    std::vector<unsigned> default_threads() {
+        unsigned top = std::max(integral_parallel::default_pool().size(), 1u);
+        std::vector<unsigned> list;
+        for (unsigned t = 1; t < top; t *= 2) list.push_back(t);
+        list.push_back(top);
+        return list;
+    }
+
+    // Ранг по ближайшему значению: p-квантиль отсортированной выборки
+    double percentile(const std::vector<double>& sorted, double p) {
+        std::size_t rank = static_cast<std::size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+        return sorted[std::min(std::max<std::size_t>(rank, 1), sorted.size()) - 1];
+    }
+
+    void summarize(CaseResult& r) {
+        std::vector<double> sorted = r.times;
+        std::sort(sorted.begin(), sorted.end());
+        std::size_t m = sorted.size();
+        r.median = m % 2 ? sorted[m / 2] : 0.5 * (sorted[m / 2 - 1] + sorted[m / 2]);
+        r.p95 = percentile(sorted, 0.95);
+        r.min = sorted.front();
+        double total = 0.0;
+        for (double t : sorted) total += t;
+        r.mean = total / static_cast<double>(m);
+    }
+
+    // Ускорение и эффективность относительно того же бэкенда на одном потоке,
+    // а без такого замера — относительно single
+    void scaling(std::vector<CaseResult>& results) {
+        for (CaseResult& r : results) {
+            if (!threaded(r.backend) || r.median <= 0.0) continue;
+            const CaseResult* base = nullptr;
+            for (const CaseResult& q : results) {
+                if (q.n != r.n || q.steps != r.steps || q.median <= 0.0) continue;
+                if (q.backend == r.backend && q.threads == 1) base = &q;
+                else if (!base && q.backend == "single") base = &q;
+            }
+            if (!base) continue;
+            r.speedup = base->median / r.median;
+            r.efficiency = r.speedup / static_cast<double>(r.threads);
+        }
+    }
+
+    std::string number(double v) {
+        if (!std::isfinite(v)) return "";
+        std::ostringstream out;
+        out << std::setprecision(std::abs(v) >= 1e-3 && std::abs(v) < 1e15 ? 10 : 6) << v;
+        return out.str();
+    }
+
+    std::string exact_number(double v) {
+        std::ostringstream out;
+        out << std::setprecision(17) << v;
+        return out.str();
+    }
+
+    std::string json_string(const std::string& s) {
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            if (static_cast<unsigned char>(c) >= 0x20) out += c;
+        }
+        return out + "\"";
+    }
+
+    std::string json_number(double v) {
+        std::string s = number(v);
+        return s.empty() ? "null" : s;
+    }
+
+    void write_csv(std::ostream& out, const std::vector<CaseResult>& results) {
+        out << "backend,n,steps,threads,reps,median_s,p95_s,min_s,mean_s,points_per_s,terms_per_s,"
+               "speedup,efficiency,result,exact,error,bound,ok,busy_s,idle_s,imbalance,ipc,note\n";
+        for (const CaseResult& r : results) {
+            double points = r.median > 0.0 ? static_cast<double>(r.steps) / r.median : 0.0;
+            std::string note = r.note;
+            std::replace(note.begin(), note.end(), ',', ';');
+            out << r.backend << ',' << r.n << ',' << r.steps << ',' << r.threads << ',' << r.times.size() << ','
+                << number(r.median) << ',' << number(r.p95) << ',' << number(r.min) << ',' << number(r.mean) << ','
+                << number(points) << ',' << number(points * static_cast<double>(r.n)) << ','
+                << number(r.speedup) << ',' << number(r.efficiency) << ',' << exact_number(r.result) << ','
+                << exact_number(r.exact) << ',' << number(r.error) << ',' << number(r.bound) << ','
+                << (r.ok ? "true" : "false") << ',';
+            // Сводка профиля: суммы по группам исполнителей, худший дисбаланс
+            if (!r.profile.groups.empty()) {
+                common::GroupProfile total;
+                for (const common::GroupProfile& g : r.profile.groups) {
+                    total.busy += g.busy;
+                    total.idle += g.idle;
+                    total.imbalance = std::max(total.imbalance, g.imbalance);
+                    total.cycles += g.cycles;
+                    total.instructions += g.instructions;
+                }
+                out << number(total.busy) << ',' << number(total.idle) << ',' << number(total.imbalance) << ','
+                    << (total.cycles ? number(total.ipc()) : "");
+            } else {
+                out << ",,,";
+            }
+            out << ',' << note << '\n';
+        }
+    }
+
+    void write_json(std::ostream& out, const SuiteOptions& o, const std::vector<CaseResult>& results,
+                    const std::string& device) {
+        out << "{\n  \"meta\": {\"batch_kernel\": " << json_string(common::batch_kernel_name())
+            << ", \"precision\": " << json_string(common::precision_name(common::default_precision()))
+            << ", \"pool\": " << json_string(integral_parallel::default_pool().describe())
+            << ", \"opencl_device\": " << json_string(device) << ", \"warmup\": " << o.warmup
+            << ", \"reps\": " << o.reps << ", \"a\": " << exact_number(o.a) << ", \"b\": " << exact_number(o.b)
+            << ", \"x0\": " << exact_number(o.x0) << ", \"x1\": " << exact_number(o.x1) << "},\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const CaseResult& r = results[i];
+            double points = r.median > 0.0 ? static_cast<double>(r.steps) / r.median : 0.0;
+            out << (i ? ",\n" : "\n") << "    {\"backend\": " << json_string(r.backend) << ", \"n\": " << r.n
+                << ", \"steps\": " << r.steps << ", \"threads\": " << r.threads << ", \"times_s\": [";
+            for (std::size_t j = 0; j < r.times.size(); ++j) out << (j ? ", " : "") << json_number(r.times[j]);
+            out << "], \"median_s\": " << json_number(r.median) << ", \"p95_s\": " << json_number(r.p95)
+                << ", \"min_s\": " << json_number(r.min) << ", \"mean_s\": " << json_number(r.mean)
+                << ", \"points_per_s\": " << json_number(points)
+                << ", \"terms_per_s\": " << json_number(points * static_cast<double>(r.n))
+                << ", \"speedup\": " << json_number(r.speedup) << ", \"efficiency\": " << json_number(r.efficiency)
+                << ", \"result\": " << exact_number(r.result) << ", \"exact\": " << exact_number(r.exact)
+                << ", \"error\": " << json_number(r.error) << ", \"bound\": " << json_number(r.bound)
+                << ", \"ok\": " << (r.ok ? "true" : "false") << ", \"note\": " << json_string(r.note);
+            if (o.profile) out << ", \"profile\": " << common::profile_json(r.profile);
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    SuiteOptions options;
+    options.backends = available_backends();
+    bool help = false;
+    std::string error = parse_args(options, argc, argv, help);
+    if (help) {
+        std::cout << USAGE;
+        return 0;
+    }
+    if (!error.empty()) {
+        std::cerr << "weier_suite: " << error << "\n" << USAGE;
+        return 2;
+    }
+    if (options.threads.empty()) options.threads = default_threads();
+    // До создания движка OpenCL: профилирование очереди задаётся при создании
+    common::set_profiling(options.profile);
+
+    // Пулы на каждое число потоков создаются один раз, с размещением WEIER_PLACEMENT
+    std::map<unsigned, std::unique_ptr<integral_parallel::ThreadPool>> pools;
+    std::string device;
+#ifdef ENABLE_OPENCL
+    integral_opencl::OpenCLEngine* engine = nullptr;
+    if (std::find(options.backends.begin(), options.backends.end(), "opencl") != options.backends.end()) {
+        std::string cl_error;
+        engine = integral_opencl::default_engine(cl_error);
+        if (engine) device = engine->device_name() + " (" + engine->platform_name() + ")";
+        else std::cerr << "OpenCL error: " << cl_error << "\n";
+    }
+#endif
+
+    std::vector<CaseResult> results;
+    for (std::size_t n : options.ns) {
+        auto plan = common::weierstrass_plan(options.a, options.b, n);
+        double exact = common::weierstrass_integral(*plan, options.x0, options.x1);
+        for (std::size_t steps : options.steps) {
+            double bound = common::midpoint_error_bound(*plan, options.x0, options.x1, steps);
+            for (const std::string& backend : options.backends) {
+                std::vector<unsigned> sweep = threaded(backend) ? options.threads : std::vector<unsigned>{1};
+                for (unsigned threads : sweep) {
+                    CaseResult r;
+                    r.backend = backend;
+                    r.n = n;
+                    r.steps = steps;
+                    r.threads = threads;
+                    r.exact = exact;
+                    r.bound = bound;
+                    // Один прогон бэкенда; false — бэкенд недоступен (причина в r.note)
+                    auto run = [&](double& value) {
+                        if (backend == "single") {
+                            value = integral_single::integrate_weierstrass(*plan, options.x0, options.x1, steps);
+                            return true;
+                        }
+                        if (backend == "parallel") {
+                            auto& pool = pools[threads];
+                            if (!pool)
+                                pool.reset(new integral_parallel::ThreadPool(threads, common::default_placement()));
+                            value = integral_parallel::integrate_weierstrass_parallel(*plan, options.x0, options.x1,
+                                                                                      steps, *pool);
+                            return true;
+                        }
+#ifdef ENABLE_OPENMP
+                        if (backend == "openmp") {
+                            integral_parallel_omp::OmpOptions omp = integral_parallel_omp::default_options();
+                            omp.threads = threads;
+                            value = integral_parallel_omp::integrate_weierstrass_parallel_omp(*plan, options.x0,
+                                                                                              options.x1, steps, omp);
+                            return true;
+                        }
+#endif
+#ifdef ENABLE_OPENCL
+                        if (backend == "opencl") {
+                            if (!engine) {
+                                r.note = "no OpenCL device";
+                                return false;
+                            }
+                            integral_opencl::Result cl = engine->integrate(*plan, options.x0, options.x1, steps);
+                            value = cl.value;
+                            r.note = cl.ok() ? cl.variant : cl.error;
+                            return cl.ok();
+                        }
+#endif
+                        return false;
+                    };
+
+                    bool ran = true;
+                    for (std::size_t i = 0; i < options.warmup && ran; ++i) ran = run(r.result);
+                    common::reset_profile();
+                    for (std::size_t i = 0; i < options.reps && ran; ++i) {
+                        auto t = Clock::now();
+                        ran = run(r.result);
+                        r.times.push_back(std::chrono::duration<double>(Clock::now() - t).count());
+                    }
+                    if (options.profile) r.profile = common::profile_report();
+                    if (ran) {
+                        summarize(r);
+#ifdef ENABLE_OPENCL
+                        // Смешанная точность OpenCL (cos во float) принимается с допуском mixed_tolerance на точку
+                        if (backend == "opencl" && r.note.find(" mixed ") != std::string::npos) {
+                            double amp = 0.0;
+                            for (std::size_t k = 0; k < n; ++k) amp += std::fabs(plan->amp()[k]);
+                            r.bound += integral_opencl::options_from_env().mixed_tolerance * amp *
+                                       std::fabs(options.x1 - options.x0);
+                        }
+#endif
+                        r.error = std::fabs(r.result - r.exact);
+                        r.ok = r.error <= r.bound;
+                    } else {
+                        r.times.clear();
+                        r.result = std::numeric_limits<double>::quiet_NaN();
+                        r.error = std::numeric_limits<double>::quiet_NaN();
+                    }
+                    std::cerr << backend << " n=" << n << " steps=" << steps << " threads=" << threads << ": "
+                              << (ran ? number(r.median) + "s, error " + number(r.error) + " (bound " +
+                                            number(r.bound) + ")" + (r.ok ? "" : " FAIL")
+                                      : "skipped, " + r.note)
+                              << "\n";
+                    results.push_back(r);
+                }
+            }
+        }
+    }
+    scaling(results);
+
+    std::ofstream file;
+    if (options.output != "-") {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "weier_suite: cannot open " << options.output << "\n";
+            return 2;
+        }
+    }
+    std::ostream& out = options.output == "-" ? std::cout : file;
+    if (options.format == "json") write_json(out, options, results, device);
+    else write_csv(out, results);
+
+    // Код 1, если хоть один запущенный случай вышел за оценку ошибки
+    for (const CaseResult& r : results)
+        if (!r.times.empty() && !r.ok) return 1;
+    return 0;
+}
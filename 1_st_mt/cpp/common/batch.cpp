@@ -0,0 +1,159 @@
+#include "common.hpp"
+#include "kernels.hpp"
+#include "exact.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+// Блочное вычисление функции Вейерштрасса с выбором SIMD-ядра во время выполнения.
+namespace common {
+    namespace {
+        using detail::BlockFn;
+
+        // Скалярное ядро: побитно совпадает с common::weierstrass
+        void weierstrass_block_scalar(const double* amp, const double* freq, std::size_t n,
+                                      const double* xs, std::size_t xs_stride, double* out, std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) {
+                double sum = 0.0;
+                for (std::size_t k = 0; k < n; ++k) {
+                    sum += amp[k] * std::cos(freq[k] * xs[k * xs_stride + i]);
+                }
+                out[i] = sum;
+            }
+        }
+
+        // Скалярное ядро с n = N во время компиляции: то же сложение, что выше
+        template <std::size_t N>
+        void fixed_block_scalar(const double* amp, const double* freq, const double* xs, double* out,
+                                std::size_t count) {
+            for (std::size_t i = 0; i < count; ++i) {
+                double sum = 0.0;
+                for (std::size_t k = 0; k < N; ++k) sum += amp[k] * std::cos(freq[k] * xs[i]);
+                out[i] = sum;
+            }
+        }
+
+        template <std::size_t... I>
+        constexpr std::array<FixedBlockFn, sizeof...(I) + 1> fixed_scalar_table(std::index_sequence<I...>) {
+            return {nullptr, &fixed_block_scalar<I + 1>...};
+        }
+
+        FixedBlockFn fixed_block_scalar_n(std::size_t n) {
+            static constexpr auto table = fixed_scalar_table(std::make_index_sequence<MAX_FIXED_N>());
+            return n < table.size() ? table[n] : nullptr;
+        }
+
+        // Скалярный рекуррентный поворот: цепочка по точкам для каждого слагаемого
+        void weierstrass_rotate_scalar(const double* amp, const double* c0, const double* s0,
+                                       const double* sc, const double* ss, std::size_t m,
+                                       double* out, std::size_t count) {
+            for (std::size_t k = 0; k < m; ++k) {
+                double c = c0[k], s = s0[k];
+                for (std::size_t j = 0; j < count; ++j) {
+                    out[j] += amp[k] * c;
+                    double nc = c * sc[k] - s * ss[k];
+                    s = s * sc[k] + c * ss[k];
+                    c = nc;
+                }
+            }
+        }
+
+        void weierstrass_sincos_scalar(const double* args, double* c, double* s, std::size_t m) {
+            for (std::size_t k = 0; k < m; ++k) {
+                c[k] = std::cos(args[k]);
+                s[k] = std::sin(args[k]);
+            }
+        }
+
+        struct Kernel {
+            BlockFn fn;
+            BlockFn fn32;   // Arithmetic::Fp32
+            detail::RotateFn rotate;
+            detail::SinCosFn sincos;
+            FixedBlockFn (*fixed)(std::size_t n);
+            const char* name;
+        };
+
+        // Выбираем лучшее ядро, поддерживаемое CPU; WEIER_SIMD может только понизить выбор
+        Kernel select_kernel() {
+            const char* env = std::getenv("WEIER_SIMD");
+            std::string cap = env ? env : "";
+#ifdef WEIER_SIMD_X86
+            __builtin_cpu_init();
+            if (cap != "scalar" && cap != "avx2" && __builtin_cpu_supports("avx512f"))
+                return {detail::weierstrass_block_avx512, detail::weierstrass_block_f32_avx512,
+                        detail::weierstrass_rotate_avx512,
+                        detail::weierstrass_sincos_avx512, detail::fixed_block_avx512, "avx512"};
+            if (cap != "scalar" && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+                return {detail::weierstrass_block_avx2, detail::weierstrass_block_f32_avx2,
+                        detail::weierstrass_rotate_avx2,
+                        detail::weierstrass_sincos_avx2, detail::fixed_block_avx2, "avx2"};
+#endif
+            return {weierstrass_block_scalar, weierstrass_block_scalar, weierstrass_rotate_scalar,
+                    weierstrass_sincos_scalar, fixed_block_scalar_n, "scalar"};
+        }
+
+        const Kernel& kernel() {
+            static const Kernel k = select_kernel();
+            return k;
+        }
+    }
+
+    void weierstrass_batch(const WeierstrassPlan& plan, const double* xs, double* out, std::size_t count) {
+        if (plan.exact_reduction()) {
+            detail::weierstrass_block_exact(plan, xs, out, count);
+            return;
+        }
+        detail::selected_block_kernel(plan.precision().arithmetic)(plan.amp(), plan.freq(), plan.n(), xs, 0, out, count);
+    }
+
+    void weierstrass_batch(const double* xs, double* out, std::size_t count, double a, double b, std::size_t n) {
+        weierstrass_batch(*weierstrass_plan(a, b, n), xs, out, count);
+    }
+
+    double weierstrass_midpoint_sum(const WeierstrassPlan& plan, double x0, double h,
+                                    std::size_t begin, std::size_t end) {
+        BlockFn fn = detail::selected_block_kernel(plan.precision().arithmetic);
+
+        double xs[BATCH_BLOCK];
+        double vals[BATCH_BLOCK];
+        RunningSum sum(plan.precision().summation);
+        for (std::size_t i = begin; i < end; ) {
+            std::size_t count = std::min(BATCH_BLOCK, end - i);
+            for (std::size_t j = 0; j < count; ++j) {
+                xs[j] = x0 + h * (static_cast<double>(i + j) + 0.5);
+            }
+            if (plan.exact_reduction()) {
+                detail::weierstrass_block_exact(plan, xs, vals, count);
+            } else {
+                fn(plan.amp(), plan.freq(), plan.n(), xs, 0, vals, count);
+            }
+            // Складываем в порядке возрастания i с суммированием из политики плана
+            sum.add(vals, count);
+            i += count;
+        }
+        return sum.value();
+    }
+
+    double weierstrass_midpoint_sum(double a, double b, std::size_t n, double x0, double h,
+                                    std::size_t begin, std::size_t end) {
+        return weierstrass_midpoint_sum(*weierstrass_plan(a, b, n), x0, h, begin, end);
+    }
+
+    FixedBlockFn fixed_block_kernel(std::size_t n) { return kernel().fixed(n); }
+
+    const char* batch_kernel_name() { return kernel().name; }
+
+    detail::BlockFn detail::selected_block_kernel() { return kernel().fn; }
+
+    detail::BlockFn detail::selected_block_kernel(Arithmetic arithmetic) {
+        return arithmetic == Arithmetic::Fp32 ? kernel().fn32 : kernel().fn;
+    }
+
+    detail::RotateFn detail::selected_rotation_kernel() { return kernel().rotate; }
+
+    detail::SinCosFn detail::selected_sincos_kernel() { return kernel().sincos; }
+}
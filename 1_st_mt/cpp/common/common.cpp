@@ -1,4 +1,5 @@
 #include "common.hpp"
+#include <algorithm>
 #include <cmath>
 
 namespace common {
@@ -9,4 +10,51 @@ namespace common {
         }
         return sum;
     }
+
+    double weierstrass_integral(const WeierstrassPlan& plan, double x0, double x1) {
+        double c = 0.5 * (x0 + x1), r = 0.5 * (x1 - x0);
+        double sum = 0.0;
+        for (std::size_t k = 0; k < plan.n(); ++k) {
+            double f = plan.freq()[k];
+            if (f == 0.0) {
+                sum += plan.amp()[k] * (x1 - x0);
+                continue;
+            }
+            // sin(f*x1) - sin(f*x0) = 2 cos(f*c) sin(f*r) — без вычитания близких чисел
+            sum += plan.amp()[k] * 2.0 * std::cos(f * c) * std::sin(f * r) / f;
+        }
+        return sum;
+    }
+
+    double midpoint_error_bound(const WeierstrassPlan& plan, double x0, double x1, std::size_t steps) {
+        if (steps == 0) return 0.0;
+        double w = std::fabs(x1 - x0);
+        double h = w / static_cast<double>(steps);
+        double xmax = std::max(std::fabs(x0), std::fabs(x1));
+        double u = plan.precision().arithmetic == Arithmetic::Fp32 ? std::ldexp(1.0, -24) : std::ldexp(1.0, -53);
+        double reseed = static_cast<double>(ROTATION_RESEED);
+        double bound = 0.0, amp_sum = 0.0;
+        for (std::size_t k = 0; k < plan.n(); ++k) {
+            double amp = std::fabs(plan.amp()[k]);
+            double f = std::fabs(plan.freq()[k]);
+            amp_sum += amp;
+            // Ошибка вычисления слагаемого по точкам (путь с поворотом)
+            double evaluation = w * amp * u * (5.0 * reseed + f * (4.0 * xmax + reseed * h));
+            // Разрешённое слагаемое: ошибка правила средних
+            double resolved = w * amp * h * h * f * f / 24.0 + evaluation;
+            double term = resolved;
+            if (f > 0.0) {
+                // Любое слагаемое: |сумма| <= |a^k| w, |интеграл| <= 2 |a^k| / f
+                term = std::min(term, amp * (w * (1.0 + 8.0 * u) + 2.0 / f));
+                // Частота между наложениями сетки: сумма средних точек — ядро Дирихле,
+                // |h * sum cos| <= h / |sin(f h / 2)|; delta — погрешность самого sin(theta)
+                double theta = 0.5 * f * h;
+                double delta = std::ldexp(1.0, -53) * (5.0 * theta + 1.0);
+                double s = std::fabs(std::sin(theta)) - delta;
+                if (s > 0.0) term = std::min(term, amp * (h / s + 2.0 / f) + evaluation);
+            }
+            bound += term;
+        }
+        return bound + static_cast<double>(steps) * u * w * amp_sum;
+    }
 }
@@ -1,5 +1,9 @@
 #pragma once
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace common {
     static constexpr double WEIER_A = 0.5;
@@ -9,5 +13,215 @@ namespace common {
 
     static constexpr double PI = 3.141592653589793238462643383279502884;
 
+    // Number of points the integrators hand to weierstrass_batch per call
+    static constexpr std::size_t BATCH_BLOCK = 256;
+    // Grid points between exact re-seeds in weierstrass_midpoint_sum_rotation
+    static constexpr std::size_t ROTATION_RESEED = 64;
+    // Grid points per block of the reproducible reduction (PrecisionPolicy::reproducible)
+    static constexpr std::size_t REPRO_BLOCK = 2048;
+
     double weierstrass(double x, double a, double b, std::size_t n);
+
+    // How cos(PI * b^k * x) is reduced:
+    //  Standard — cos(freq[k] * x) on the rounded double argument, as weierstrass() does;
+    //  Exact    — for integer b, b^k * x mod 2 is computed exactly in integer arithmetic
+    //             and only a small-argument cos is evaluated. This is the true value at
+    //             the double x, and it differs from Standard once PI * b^k * x exceeds
+    //             ~2^53 (where Standard's argument is already off by more than 2*pi).
+    //             Falls back to Standard when b is not an integer below 2^63, and per
+    //             point for |x| < 2^-75 or non-finite x.
+    enum class Reduction { Standard, Exact };
+
+    // Arithmetic of the batch kernel:
+    //  Fp64 — all in double;
+    //  Fp32 — the cos argument and its reduction to [-pi/4, pi/4] stay in double
+    //         (Payne–Hanek keeps only the 2/pi bits the term's amplitude needs),
+    //         the sin/cos polynomials run in float on twice the SIMD lanes, and
+    //         terms are weighted and added in double. Per point the deviation from
+    //         Fp64 is below 1e-7 * sum |a^k| (5e-8 measured), so integrals move by
+    //         at most that times (x1 - x0); the rotated low terms of
+    //         weierstrass_midpoint_sum_rotation stay in double. The scalar kernel
+    //         and exact_reduction() plans ignore Fp32.
+    enum class Arithmetic { Fp64, Fp32 };
+
+    // How integrators add point values and partial sums; error bounds for N
+    // values v_i with eps = 2^-53:
+    //  Plain    — left to right, (N - 1) * eps * sum |v_i|;
+    //  Kahan    — compensated, 2 * eps * sum |v_i| + O(N * eps^2) * sum |v_i|;
+    //  Neumaier — Kahan that stays compensated when a value outgrows the sum;
+    //  Pairwise — binary tree over blocks, ~log2(N) * eps * sum |v_i|.
+    // At 1e9 steps the n = 5 integral over [0, 1] (exactly 0) is off by 4e-13
+    // with Plain and by 4e-16 with the others. Pairwise has no serial chain of
+    // adds and is the fastest of the four, hence the default. It moves the last
+    // digits of every integral against the left-to-right sum of earlier
+    // versions (~1e-14 at 1e6 steps, ~1e-13 at 1e8); Plain keeps that order.
+    enum class Summation { Plain, Kahan, Neumaier, Pairwise };
+
+    // reproducible: the CPU and MPI integrators cut the grid into REPRO_BLOCK-point
+    // blocks at fixed global indices, sum each block sequentially and combine the
+    // block sums over a fixed tree (reproducible_tree_sum). The result is then
+    // bit-identical for any thread count, rank count or schedule, and equal
+    // across single, parallel, OpenMP and MPI. Off: partial sums are combined
+    // in whatever order the workers finish, which moves the last bits.
+    struct PrecisionPolicy {
+        Arithmetic arithmetic = Arithmetic::Fp64;
+        Summation summation = Summation::Pairwise;
+        bool reproducible = false;
+    };
+
+    // WEIER_PRECISION=fp64|fp32, WEIER_SUMMATION=plain|kahan|neumaier|pairwise
+    // and WEIER_REPRODUCIBLE=1|0 from the environment; unset or unknown values
+    // keep the PrecisionPolicy defaults
+    PrecisionPolicy default_precision();
+    // e.g. "fp32, neumaier, reproducible"
+    std::string precision_name(const PrecisionPolicy& precision);
+
+    // Running sum in one Summation mode. add(values, count) takes a block of
+    // point values, add(value) a single value or partial sum. One per thread.
+    class RunningSum {
+    public:
+        explicit RunningSum(Summation mode = Summation::Pairwise) : mode_(mode) {}
+
+        void add(double value);
+        void add(const double* values, std::size_t count);
+        double value() const;
+        Summation mode() const { return mode_; }
+
+    private:
+        Summation mode_;
+        double sum_ = 0.0;
+        double comp_ = 0.0;        // Kahan / Neumaier correction
+        double levels_[64];        // Pairwise: levels_[l] sums 2^l leaves, bit l of leaves_ set
+        std::uint64_t leaves_ = 0;
+    };
+
+    // Term tables for fixed (a, b, n): amp()[k] = a^k, freq()[k] = PI * b^k,
+    // computed once with the same expressions as weierstrass(), so every
+    // evaluation through a plan is bit-compatible with the scalar function
+    // (with Arithmetic::Fp64). Both tables start on a cache line and are padded
+    // to whole lines. The precision policy is honoured by every integrator
+    // that takes the plan.
+    class WeierstrassPlan {
+    public:
+        static constexpr std::size_t ALIGN = 64;
+
+        WeierstrassPlan(double a, double b, std::size_t n, Reduction reduction = Reduction::Standard,
+                        PrecisionPolicy precision = PrecisionPolicy());
+
+        double a() const { return a_; }
+        double b() const { return b_; }
+        std::size_t n() const { return n_; }
+        const double* amp() const { return amp_; }
+        const double* freq() const { return freq_; }
+        // Requested reduction, and whether the exact one actually applies to this b
+        Reduction reduction() const { return reduction_; }
+        bool exact_reduction() const { return !residues_.empty(); }
+        // |b|^k mod 2^128 as (low, high) 64-bit pairs; empty unless exact_reduction()
+        const std::uint64_t* residues() const { return residues_.data(); }
+        const PrecisionPolicy& precision() const { return precision_; }
+
+        // Scalar evaluation at one point
+        double operator()(double x) const;
+
+    private:
+        struct AlignedDelete { void operator()(double* p) const; };
+
+        double a_, b_;
+        std::size_t n_;
+        Reduction reduction_;
+        PrecisionPolicy precision_;
+        std::unique_ptr<double[], AlignedDelete> storage_;
+        std::vector<std::uint64_t> residues_;
+        double* amp_;
+        double* freq_;
+    };
+
+    // Returns a shared plan for (a, b, n) from a process-wide cache, so repeated
+    // integrals with the same parameters skip the table setup. Thread-safe.
+    std::shared_ptr<const WeierstrassPlan> weierstrass_plan(double a, double b, std::size_t n,
+                                                            Reduction reduction = Reduction::Standard,
+                                                            PrecisionPolicy precision = default_precision());
+
+    // out[i] = weierstrass(xs[i], a, b, n) for i < count. The kernel (AVX-512,
+    // AVX2+FMA or scalar) is picked for the running CPU on first use;
+    // WEIER_SIMD=scalar|avx2|avx512 in the environment caps the choice.
+    // Plans with exact_reduction() use the exact-reduction evaluator instead.
+    void weierstrass_batch(const WeierstrassPlan& plan, const double* xs, double* out, std::size_t count);
+    void weierstrass_batch(const double* xs, double* out, std::size_t count, double a, double b, std::size_t n);
+
+    // Largest n with a fixed-n block kernel
+    static constexpr std::size_t MAX_FIXED_N = 32;
+    // out[i] = sum_k amp[k] * cos(freq[k] * xs[i]), i < count, over the n terms
+    // the kernel was built for
+    using FixedBlockFn = void (*)(const double* amp, const double* freq, const double* xs, double* out,
+                                  std::size_t count);
+    // The batch kernel for the running CPU instantiated with n fixed at compile
+    // time: the term loop is the inner one with a constant trip count and the
+    // sum of a vector of points stays in a register. Values are bit-identical
+    // to weierstrass_batch with an Fp64 plan. nullptr outside 1 <= n <= MAX_FIXED_N.
+    FixedBlockFn fixed_block_kernel(std::size_t n);
+
+    // Sum of weierstrass(x0 + h*(i + 0.5)) over i in [begin, end), evaluated
+    // in BATCH_BLOCK-sized blocks through the batch kernel and accumulated with
+    // the plan's precision policy
+    double weierstrass_midpoint_sum(const WeierstrassPlan& plan, double x0, double h,
+                                    std::size_t begin, std::size_t end);
+    double weierstrass_midpoint_sum(double a, double b, std::size_t n, double x0, double h,
+                                    std::size_t begin, std::size_t end);
+
+    // Same sum, but each term with PI * |b^k| * |x| < 2^47 is stepped along the
+    // grid by the complex rotation (cos(freq*h), sin(freq*h)) instead of calling
+    // cos at every point. The grid is cut into ROTATION_RESEED-point segments
+    // aligned to global i; each segment starts from exact cos/sin, so point values
+    // do not depend on how [0, steps) is split between workers. Higher terms go
+    // through the batch kernel; exact_reduction() plans fall back to
+    // weierstrass_midpoint_sum.
+    //
+    // Error bound per rotated term, j < ROTATION_RESEED steps past a seed, against
+    // the scalar path (eps = 2^-53):
+    //   |a^k| * (5*j*eps + eps * |freq_k| * (4*|x| + j*h))
+    // The first part is rounding in the complex multiplies and in the step cos/sin,
+    // the second is argument rounding that the scalar path itself carries. With the
+    // 2^47 cut-off the second part stays below |a^k| * 0.07. For a = 0.5, b = 30
+    // and h = 1/10007 the measured pointwise deviation is ~4e-11 at n = 5 and
+    // ~2e-5 at n >= 10 on [0, 1] (the terms just below the cut-off dominate),
+    // ~4e-9 and ~1.3e-5 on [100.3, 101.3]; errors of different points largely
+    // cancel: the integrals of the default configurations move by <= 2.5e-9.
+    double weierstrass_midpoint_sum_rotation(const WeierstrassPlan& plan, double x0, double h,
+                                             std::size_t begin, std::size_t end);
+
+    // Reproducible reduction over [begin, end). Block j covers the grid points
+    // [j * REPRO_BLOCK, (j + 1) * REPRO_BLOCK) clipped to the range, so which
+    // points form a block never depends on how the range is split further.
+    // Blocks are numbered from begin / REPRO_BLOCK.
+    std::size_t reproducible_block_count(std::size_t begin, std::size_t end);
+    // out[j - first] = sum of block j, j in [first, last), through
+    // weierstrass_midpoint_sum_rotation (sequential inside the block)
+    void weierstrass_block_sums(const WeierstrassPlan& plan, double x0, double h, std::size_t begin, std::size_t end,
+                                std::size_t first, std::size_t last, double* out);
+    // Sum over a tree whose shape depends only on count: the left subtree
+    // takes the largest power of two below count
+    double reproducible_tree_sum(const double* sums, std::size_t count);
+    // Block sums and tree on the calling thread, for the single-threaded path
+    double weierstrass_midpoint_sum_reproducible(const WeierstrassPlan& plan, double x0, double h,
+                                                 std::size_t begin, std::size_t end);
+
+    // Integral of the plan's finite sum over [x0, x1] in closed form,
+    // sum a^k * (sin(freq_k * x1) - sin(freq_k * x0)) / freq_k: the reference
+    // of the benchmark suite, O(n) instead of a run of the integrator
+    double weierstrass_integral(const WeierstrassPlan& plan, double x0, double x1);
+    // Bound on |midpoint rule with steps points - weierstrass_integral| for the
+    // CPU integrators. Term by term, with E = (x1 - x0) * |a^k| * u * (5 *
+    // ROTATION_RESEED + freq_k * (4 * |x| + ROTATION_RESEED * h)) the evaluation
+    // error of the rotation path, the smallest of
+    //   (x1 - x0) * |a^k| * h^2 * freq_k^2 / 24 + E     (resolved terms),
+    //   |a^k| * (h / |sin(freq_k * h / 2)| + 2 / freq_k) + E   (Dirichlet kernel of the grid),
+    //   |a^k| * (x1 - x0 + 2 / freq_k)                  (any term),
+    // plus steps * u * (x1 - x0) * sum |a^k| for the summation; u is the unit
+    // roundoff of the plan's arithmetic. Only terms the grid aliases exactly
+    // (b^k * h / 2 an integer) are left with the last, loose form.
+    double midpoint_error_bound(const WeierstrassPlan& plan, double x0, double x1, std::size_t steps);
+
+    // Name of the selected batch kernel: "avx512", "avx2" or "scalar"
+    const char* batch_kernel_name();
 }
@@ -0,0 +1,103 @@
+#include "common.hpp"
+#include "exact.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// Точная редукция аргумента для целого b.
+// x = m * 2^-s (m — 53-битная мантисса), поэтому
+//   b^k * x mod 2 = ((b^k mod 2^(s+1)) * m mod 2^(s+1)) * 2^-s,
+// и при s + 1 <= 128 всё считается в 128-битной арифметике без округлений
+// (до перевода в double, который отбрасывает биты ниже 2^-63).
+// Остаток t в [-1, 1) даёт cos(PI * b^k * x) = cos(PI * t) — малый аргумент,
+// который считается тем же векторным ядром без дорогой редукции.
+namespace common { namespace detail {
+#ifdef __SIZEOF_INT128__
+    namespace {
+        using u128 = unsigned __int128;
+        constexpr double TWO_M63 = 1.0 / 9223372036854775808.0;   // 2^-63
+
+        // Разложение |x| = m * 2^-s; false, если точная редукция неприменима
+        bool split(double x, std::uint64_t &m, int &s) {
+            std::uint64_t bits;
+            std::memcpy(&bits, &x, sizeof bits);
+            int biased = static_cast<int>((bits >> 52) & 0x7FF);
+            if (biased == 0 || biased == 0x7FF) return false;   // 0, субнормали, inf, NaN
+            m = (bits & 0x000FFFFFFFFFFFFFULL) | (1ULL << 52);
+            s = 1075 - biased;
+            return s < 128;
+        }
+    }
+
+    std::vector<std::uint64_t> power_residues(double b, std::size_t n) {
+        double ab = std::fabs(b);
+        if (!(ab < 9223372036854775808.0) || ab != std::floor(ab)) return {};
+        std::vector<std::uint64_t> res(2 * n);
+        u128 p = 1;
+        for (std::size_t k = 0; k < n; ++k) {
+            res[2 * k] = static_cast<std::uint64_t>(p);
+            res[2 * k + 1] = static_cast<std::uint64_t>(p >> 64);
+            p *= static_cast<std::uint64_t>(ab);   // по модулю 2^128
+        }
+        return res;
+    }
+
+    void weierstrass_block_exact(const WeierstrassPlan &plan, const double *xs, double *out, std::size_t count) {
+        const double *amp = plan.amp();
+        const double *freq = plan.freq();
+        const std::uint64_t *res = plan.residues();
+        std::size_t n = plan.n();
+        BlockFn fn = selected_block_kernel();
+
+        // Остатки t считаются скалярно в целых числах, а cos(PI * t) —
+        // векторным ядром: слагаемое k берёт точки из ts[k * SUB ...]
+        constexpr std::size_t SUB = 64;
+        thread_local std::vector<double> ts, pis;
+        ts.resize(n * SUB);
+        pis.assign(n, PI);
+
+        for (std::size_t base = 0; base < count; base += SUB) {
+            std::size_t cnt = std::min(SUB, count - base);
+            bool fallback[SUB] = {};
+            for (std::size_t i = 0; i < cnt; ++i) {
+                std::uint64_t m;
+                int s;
+                if (!split(xs[base + i], m, s)) {
+                    fallback[i] = true;
+                    for (std::size_t k = 0; k < n; ++k) ts[k * SUB + i] = 0.0;
+                } else if (s < 0) {
+                    // x — чётное целое: b^k * x mod 2 == 0
+                    for (std::size_t k = 0; k < n; ++k) ts[k * SUB + i] = 0.0;
+                } else {
+                    // Сдвиг на 127 - s оставляет ровно b^k * m mod 2^(s+1) в старших
+                    // битах; старшие 64 бита как знаковое число — это t * 2^63 с t в [-1, 1)
+                    for (std::size_t k = 0; k < n; ++k) {
+                        u128 bk = (u128(res[2 * k + 1]) << 64) | res[2 * k];
+                        u128 y = (bk * m) << (127 - s);
+                        auto top = static_cast<std::int64_t>(static_cast<std::uint64_t>(y >> 64));
+                        ts[k * SUB + i] = static_cast<double>(top) * TWO_M63;
+                    }
+                }
+            }
+            fn(amp, pis.data(), n, ts.data(), SUB, out + base, cnt);
+
+            // Вне области точной редукции — обычный путь
+            for (std::size_t i = 0; i < cnt; ++i) {
+                if (!fallback[i]) continue;
+                double x = xs[base + i];
+                double sum = 0.0;
+                for (std::size_t k = 0; k < n; ++k) sum += amp[k] * std::cos(freq[k] * x);
+                out[base + i] = sum;
+            }
+        }
+    }
+#else
+    // Без 128-битных целых точная редукция недоступна: планы остаются в режиме Standard
+    std::vector<std::uint64_t> power_residues(double, std::size_t) { return {}; }
+
+    void weierstrass_block_exact(const WeierstrassPlan &plan, const double *xs, double *out, std::size_t count) {
+        for (std::size_t i = 0; i < count; ++i) out[i] = plan(xs[i]);
+    }
+#endif
+}}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Внутренний заголовок точной редукции аргумента (Reduction::Exact).
+namespace common {
+    class WeierstrassPlan;
+
+    namespace detail {
+        // |b|^k mod 2^128 для k < n парами (low, high); пусто, если b не целое
+        // меньше 2^63 или компилятор не поддерживает 128-битные целые
+        std::vector<std::uint64_t> power_residues(double b, std::size_t n);
+
+        // out[i] = W(xs[i]) для плана с exact_reduction()
+        void weierstrass_block_exact(const WeierstrassPlan &plan, const double *xs, double *out, std::size_t count);
+    }
+}
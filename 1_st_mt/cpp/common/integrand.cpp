@@ -0,0 +1,73 @@
+#include "integrand.hpp"
+#include <vector>
+
+// Обобщённые подынтегральные функции: сумма диапазона через ядро с n во время
+// компиляции, блоки воспроизводимого режима для любой суммы диапазона и куски
+// таблицы первообразной
+namespace common {
+    double fixed_midpoint_sum(FixedBlockFn fn, const double* amp, const double* freq, double x0, double h,
+                              std::size_t begin, std::size_t end, Summation mode) {
+        double xs[BATCH_BLOCK];
+        double vals[BATCH_BLOCK];
+        RunningSum sum(mode);
+        for (std::size_t i = begin; i < end; i += BATCH_BLOCK) {
+            std::size_t count = std::min(BATCH_BLOCK, end - i);
+            for (std::size_t j = 0; j < count; ++j) xs[j] = x0 + h * (static_cast<double>(i + j) + 0.5);
+            fn(amp, freq, xs, vals, count);
+            sum.add(vals, count);
+        }
+        return sum.value();
+    }
+
+    void block_sums(const RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end,
+                    std::size_t first, std::size_t last, double* out) {
+        std::size_t base = begin / REPRO_BLOCK;
+        for (std::size_t j = first; j < last; ++j) {
+            std::size_t lo = std::max(begin, (base + j) * REPRO_BLOCK);
+            std::size_t hi = std::min(end, (base + j + 1) * REPRO_BLOCK);
+            out[j - first] = sum(x0, h, lo, hi);
+        }
+    }
+
+    double midpoint_sum_reproducible(const RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end) {
+        std::vector<double> sums(reproducible_block_count(begin, end));
+        block_sums(sum, x0, h, begin, end, 0, sums.size(), sums.data());
+        return reproducible_tree_sum(sums.data(), sums.size());
+    }
+
+    std::string cumulative_check(std::size_t count, std::size_t steps_per_point) {
+        if (count == 0) return "cumulative: count must be positive";
+        if (steps_per_point == 0) return "cumulative: steps_per_point must be positive";
+        if (steps_per_point > static_cast<std::size_t>(-1) / count)
+            return "cumulative: count * steps_per_point overflows";
+        return "";
+    }
+
+    double cumulative_chunk(const RangeSum& sum, const PrecisionPolicy& precision, double x0, double h,
+                            std::size_t steps_per_point, std::size_t first, std::size_t last, double* out) {
+        RunningSum running(precision.summation);
+        for (std::size_t j = first; j < last; ++j) {
+            running.add(sum(x0, h, j * steps_per_point, (j + 1) * steps_per_point));
+            out[j - first] = running.value();
+        }
+        return running.value();
+    }
+
+    std::size_t cumulative_grain(const PrecisionPolicy& precision, std::size_t count, std::size_t steps_per_point,
+                                 unsigned threads, std::size_t grain) {
+        if (grain == 0) {
+            grain = precision.reproducible ? REPRO_BLOCK / std::max<std::size_t>(steps_per_point, 1)
+                                           : count / (std::max(threads, 1u) * std::size_t(8));
+        }
+        return std::max<std::size_t>(grain, 1);
+    }
+
+    void cumulative_offsets(const PrecisionPolicy& precision, const double* totals, std::size_t chunks,
+                            double* offsets) {
+        RunningSum running(precision.summation);
+        for (std::size_t c = 0; c < chunks; ++c) {
+            offsets[c] = running.value();
+            running.add(totals[c]);
+        }
+    }
+}
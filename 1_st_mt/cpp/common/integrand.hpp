@@ -0,0 +1,191 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include "common.hpp"
+
+namespace common {
+    // Sum of an integrand at x0 + h*(i + 0.5), i in [begin, end), without the
+    // factor h. The engines cut the grid into ranges (pool tasks, OpenMP blocks,
+    // MPI shares) and make one RangeSum call per range, so the point loop is
+    // compiled with the integrand inlined and only the range call is indirect.
+    using RangeSum = std::function<double(double x0, double h, std::size_t begin, std::size_t end)>;
+
+    // Integrands of the generic engines (integral_single::integrate,
+    // integral_parallel::integrate, integral_parallel_omp::integrate_omp,
+    // integral_mpi::integrate_mpi) are callables double(double). Optional members:
+    //   double midpoint_sum(double x0, double h, std::size_t begin, std::size_t end) const
+    //       — own range sum, used instead of the point loop (see PlanIntegrand);
+    //   const PrecisionPolicy& precision() const
+    //       — summation mode and reproducibility; PrecisionPolicy() otherwise.
+    // Integrands are called concurrently and must not modify shared state.
+    namespace detail {
+        template <class F, class = void>
+        struct HasMidpointSum : std::false_type {};
+        template <class F>
+        struct HasMidpointSum<F, std::void_t<decltype(std::declval<const F&>().midpoint_sum(
+                                     0.0, 0.0, std::size_t(0), std::size_t(0)))>> : std::true_type {};
+
+        template <class F, class = void>
+        struct HasPrecision : std::false_type {};
+        template <class F>
+        struct HasPrecision<F, std::void_t<decltype(std::declval<const F&>().precision())>> : std::true_type {};
+    }
+
+    template <class F>
+    PrecisionPolicy precision_of(const F& f) {
+        if constexpr (detail::HasPrecision<F>::value) return f.precision();
+        else return PrecisionPolicy();
+    }
+
+    namespace detail {
+        // Point loop of midpoint_sum: BATCH_BLOCK blocks added in mode
+        template <class F>
+        double point_midpoint_sum(const F& f, double x0, double h, std::size_t begin, std::size_t end,
+                                  Summation mode) {
+            RunningSum sum(mode);
+            double values[BATCH_BLOCK];
+            for (std::size_t lo = begin; lo < end; lo += BATCH_BLOCK) {
+                std::size_t count = std::min(BATCH_BLOCK, end - lo);
+                for (std::size_t j = 0; j < count; ++j) values[j] = f(x0 + h * (static_cast<double>(lo + j) + 0.5));
+                sum.add(values, count);
+            }
+            return sum.value();
+        }
+    }
+
+    // Range sum of any integrand: its own midpoint_sum when it has one, else
+    // the points in BATCH_BLOCK blocks added in the given summation mode
+    template <class F>
+    double midpoint_sum(const F& f, double x0, double h, std::size_t begin, std::size_t end,
+                        Summation mode = Summation::Pairwise) {
+        if constexpr (detail::HasMidpointSum<F>::value) return f.midpoint_sum(x0, h, begin, end);
+        else return detail::point_midpoint_sum(f, x0, h, begin, end, mode);
+    }
+
+    // RangeSum over f in f's summation mode; f must outlive the result
+    template <class F>
+    RangeSum range_sum(const F& f) {
+        Summation mode = precision_of(f).summation;
+        return [&f, mode](double x0, double h, std::size_t begin, std::size_t end) {
+            return midpoint_sum(f, x0, h, begin, end, mode);
+        };
+    }
+
+    // Reproducible reduction over any RangeSum, with the blocks of
+    // weierstrass_block_sums: out[j - first] = sum of block j, j in [first, last)
+    void block_sums(const RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end,
+                    std::size_t first, std::size_t last, double* out);
+    // Block sums and reproducible_tree_sum on the calling thread
+    double midpoint_sum_reproducible(const RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end);
+
+    // Cumulative tables (integral_parallel::cumulative and the OpenMP variant):
+    // the grid is cut into sections of steps_per_point points, and a chunk of
+    // sections [first, last) is one task. out[j - first] = sum of sections
+    // [first, j], without the factor h; returns the chunk's total.
+    // cumulative_check returns "" or why count and steps_per_point give no grid
+    // (either is zero, or their product overflows).
+    std::string cumulative_check(std::size_t count, std::size_t steps_per_point);
+    double cumulative_chunk(const RangeSum& sum, const PrecisionPolicy& precision, double x0, double h,
+                            std::size_t steps_per_point, std::size_t first, std::size_t last, double* out);
+    // Sections per chunk: grain when nonzero; for reproducible policies a fixed
+    // REPRO_BLOCK worth of points, so the table does not depend on the thread
+    // count; else count / (threads * 8)
+    std::size_t cumulative_grain(const PrecisionPolicy& precision, std::size_t count, std::size_t steps_per_point,
+                                 unsigned threads, std::size_t grain);
+    // offsets[c] = sum of totals[0, c) in the policy's summation mode (exclusive scan)
+    void cumulative_offsets(const PrecisionPolicy& precision, const double* totals, std::size_t chunks,
+                            double* offsets);
+
+    // Plan as an integrand: ranges go through weierstrass_midpoint_sum_rotation
+    // (rotation and SIMD kernel), the precision policy is the plan's. The
+    // integrate_weierstrass* functions of the backends are this integrand.
+    class PlanIntegrand {
+    public:
+        explicit PlanIntegrand(const WeierstrassPlan& plan) : plan_(plan) {}
+
+        double operator()(double x) const { return plan_(x); }
+        double midpoint_sum(double x0, double h, std::size_t begin, std::size_t end) const {
+            return weierstrass_midpoint_sum_rotation(plan_, x0, h, begin, end);
+        }
+        const PrecisionPolicy& precision() const { return plan_.precision(); }
+
+    private:
+        const WeierstrassPlan& plan_;
+    };
+
+    // Range sum through a fixed_block_kernel: the points of
+    // weierstrass_midpoint_sum in BATCH_BLOCK blocks, added in mode
+    double fixed_midpoint_sum(FixedBlockFn fn, const double* amp, const double* freq, double x0, double h,
+                              std::size_t begin, std::size_t end, Summation mode);
+
+    // Weierstrass function with n = N fixed at compile time. Tables use the
+    // expressions of WeierstrassPlan: operator() is bit-identical to the plan's
+    // scalar operator() with Reduction::Standard, and midpoint_sum runs
+    // fixed_block_kernel(N), bit-identical to weierstrass_midpoint_sum of an
+    // Fp64 plan. For N > MAX_FIXED_N ranges are summed point by point. Values
+    // are double whatever the policy's arithmetic.
+    template <std::size_t N>
+    class WeierstrassN {
+        static_assert(N > 0, "WeierstrassN needs at least one term");
+
+    public:
+        explicit WeierstrassN(double a = WEIER_A, double b = WEIER_B, PrecisionPolicy precision = PrecisionPolicy())
+            : precision_(precision) {
+            for (std::size_t k = 0; k < N; ++k) {
+                amp_[k] = std::pow(a, static_cast<double>(k));
+                freq_[k] = PI * std::pow(b, static_cast<double>(k));
+            }
+        }
+
+        double operator()(double x) const {
+            double sum = 0.0;
+            for (std::size_t k = 0; k < N; ++k) sum += amp_[k] * std::cos(freq_[k] * x);
+            return sum;
+        }
+        double midpoint_sum(double x0, double h, std::size_t begin, std::size_t end) const {
+            if (FixedBlockFn fn = fixed_block_kernel(N)) {
+                return fixed_midpoint_sum(fn, amp_.data(), freq_.data(), x0, h, begin, end, precision_.summation);
+            }
+            return detail::point_midpoint_sum(*this, x0, h, begin, end, precision_.summation);
+        }
+        const PrecisionPolicy& precision() const { return precision_; }
+
+    private:
+        std::array<double, N> amp_, freq_;
+        PrecisionPolicy precision_;
+    };
+
+    // Plan whose ranges go through fixed_block_kernel(plan.n()) on the plan's
+    // tables. Plans outside the kernel table, Fp32 plans and exact_reduction()
+    // plans fall back to weierstrass_midpoint_sum.
+    class FixedWeierstrass {
+    public:
+        explicit FixedWeierstrass(const WeierstrassPlan& plan)
+            : plan_(plan),
+              fn_(plan.exact_reduction() || plan.precision().arithmetic != Arithmetic::Fp64
+                      ? nullptr
+                      : fixed_block_kernel(plan.n())) {}
+
+        double operator()(double x) const { return plan_(x); }
+        double midpoint_sum(double x0, double h, std::size_t begin, std::size_t end) const {
+            if (fn_) {
+                return fixed_midpoint_sum(fn_, plan_.amp(), plan_.freq(), x0, h, begin, end,
+                                          plan_.precision().summation);
+            }
+            return weierstrass_midpoint_sum(plan_, x0, h, begin, end);
+        }
+        const PrecisionPolicy& precision() const { return plan_.precision(); }
+        // Whether a fixed-n kernel serves this plan
+        bool specialized() const { return fn_ != nullptr; }
+
+    private:
+        const WeierstrassPlan& plan_;
+        FixedBlockFn fn_;
+    };
+}
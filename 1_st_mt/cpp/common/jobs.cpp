@@ -0,0 +1,81 @@
+#include "jobs.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <tuple>
+
+// Общая подготовка пакета интегралов: планы строятся по разу на различные
+// (a, b, n), задания раскладываются в сквозную сетку, которую бэкенды режут
+// на куски, не пересекающие границы заданий.
+namespace common {
+    namespace {
+        // Параметры сравниваются побитно, как в кэше weierstrass_plan:
+        // -0.0 и 0.0 — разные наборы, одинаковые NaN — один
+        std::uint64_t bits(double v) {
+            std::uint64_t u;
+            std::memcpy(&u, &v, sizeof u);
+            return u;
+        }
+    }
+
+    BatchPlan::BatchPlan(const IntegralJob* jobs, std::size_t count, Reduction reduction, PrecisionPolicy precision)
+        : jobs_(jobs), count_(count), plans_(count), h_(count), offset_(count + 1, 0) {
+        // Кэш weierstrass_plan берёт блокировку на каждый вызов — здесь по одному на набор
+        std::map<std::tuple<std::uint64_t, std::uint64_t, std::size_t>, std::shared_ptr<const WeierstrassPlan>> seen;
+        for (std::size_t j = 0; j < count; ++j) {
+            const IntegralJob& job = jobs[j];
+            auto& plan = seen[std::make_tuple(bits(job.a), bits(job.b), job.n)];
+            if (!plan) plan = weierstrass_plan(job.a, job.b, job.n, reduction, precision);
+            plans_[j] = plan;
+            h_[j] = job.steps ? (job.x1 - job.x0) / static_cast<double>(job.steps) : 0.0;
+            offset_[j + 1] = offset_[j] + job.steps;
+        }
+        distinct_ = seen.size();
+    }
+
+    std::vector<BatchPiece> BatchPlan::pieces(std::size_t lo, std::size_t hi, std::size_t grain) const {
+        std::vector<BatchPiece> out;
+        hi = std::min(hi, points());
+        if (lo >= hi) return out;
+        grain = grain == 0 ? points() : (grain + BATCH_BLOCK - 1) / BATCH_BLOCK * BATCH_BLOCK;
+        // Первое задание, заканчивающееся правее lo
+        std::size_t j = static_cast<std::size_t>(std::upper_bound(offset_.begin(), offset_.end(), lo) -
+                                                 offset_.begin()) - 1;
+        for (; j < count_ && offset_[j] < hi; ++j) {
+            if (jobs_[j].steps == 0) continue;
+            if (plans_[j]->precision().reproducible) {
+                if (offset_[j] >= lo) out.push_back(BatchPiece{j, 0, jobs_[j].steps});
+                continue;
+            }
+            std::size_t from = std::max(lo, offset_[j]) - offset_[j];
+            std::size_t to = std::min(hi, offset_[j + 1]) - offset_[j];
+            for (std::size_t p = from; p < to; p += grain) out.push_back(BatchPiece{j, p, std::min(p + grain, to)});
+        }
+        return out;
+    }
+
+    double BatchPlan::sum(const BatchPiece& piece) const {
+        const WeierstrassPlan& plan = *plans_[piece.job];
+        double x0 = jobs_[piece.job].x0;
+        double h = h_[piece.job];
+        return plan.precision().reproducible
+                   ? weierstrass_midpoint_sum_reproducible(plan, x0, h, piece.begin, piece.end)
+                   : weierstrass_midpoint_sum_rotation(plan, x0, h, piece.begin, piece.end);
+    }
+
+    void BatchPlan::job_sums(const std::vector<BatchPiece>& pieces, const double* piece_sums, double* out) const {
+        std::fill(out, out + count_, 0.0);
+        // Куски одного задания идут подряд
+        for (std::size_t p = 0; p < pieces.size();) {
+            std::size_t j = pieces[p].job;
+            RunningSum total(plans_[j]->precision().summation);
+            for (; p < pieces.size() && pieces[p].job == j; ++p) total.add(piece_sums[p]);
+            out[j] = total.value();
+        }
+    }
+
+    void BatchPlan::scale(const double* sums, double* results) const {
+        for (std::size_t j = 0; j < count_; ++j) results[j] = sums[j] * h_[j];
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "common.hpp"
+
+namespace common {
+    // One integral of a batch: parameters of the function, the interval and
+    // the number of midpoint steps
+    struct IntegralJob {
+        double a = WEIER_A;
+        double b = WEIER_B;
+        std::size_t n = 0;
+        double x0 = INTEGRAL_X0;
+        double x1 = INTEGRAL_X1;
+        std::size_t steps = 0;
+    };
+
+    // Grid points [begin, end) of one job of a batch
+    struct BatchPiece {
+        std::size_t job;
+        std::size_t begin;
+        std::size_t end;
+    };
+
+    // Setup shared by all backends' batch calls: one plan per distinct (a, b, n)
+    // (a and b compared bitwise, like the weierstrass_plan cache),
+    // h and the offset of every job in the batch's concatenated grid. Jobs with
+    // steps == 0 integrate to 0. The jobs array must outlive the BatchPlan.
+    class BatchPlan {
+    public:
+        BatchPlan(const IntegralJob* jobs, std::size_t count, Reduction reduction = Reduction::Standard,
+                  PrecisionPolicy precision = default_precision());
+
+        std::size_t size() const { return count_; }
+        const IntegralJob& job(std::size_t j) const { return jobs_[j]; }
+        const WeierstrassPlan& plan(std::size_t j) const { return *plans_[j]; }
+        double h(std::size_t j) const { return h_[j]; }
+        // Grid points of all jobs, and how many plans the batch needed
+        std::size_t points() const { return offset_.back(); }
+        std::size_t distinct_plans() const { return distinct_; }
+
+        // Pieces covering the concatenated grid points [lo, hi) in order, each
+        // within one job and at most grain points long (grain is rounded up to
+        // BATCH_BLOCK; 0: no limit). Jobs with reproducible plans are never cut:
+        // such a job comes whole from the range that holds its first point, so
+        // its result does not depend on how the batch is split.
+        std::vector<BatchPiece> pieces(std::size_t lo, std::size_t hi, std::size_t grain) const;
+        // Sum of the integrand over a piece, without the factor h
+        double sum(const BatchPiece& piece) const;
+        // out[j] = sum of piece_sums over the pieces of job j, in piece order and
+        // in the plan's summation mode; jobs without pieces get 0
+        void job_sums(const std::vector<BatchPiece>& pieces, const double* piece_sums, double* out) const;
+        // results[j] = sums[j] * h(j)
+        void scale(const double* sums, double* results) const;
+
+    private:
+        const IntegralJob* jobs_;
+        std::size_t count_;
+        std::vector<std::shared_ptr<const WeierstrassPlan>> plans_;
+        std::vector<double> h_;
+        std::vector<std::size_t> offset_;     // count + 1 entries
+        std::size_t distinct_ = 0;
+    };
+}
@@ -0,0 +1,108 @@
+// Собирается с -mavx2 -mfma; вызывается только после проверки CPU в batch.cpp.
+#include "kernels.hpp"
+#include "simd_kernel.hpp"
+#include <immintrin.h>
+#include <cstdint>
+
+namespace common { namespace detail {
+    namespace {
+        // Примитивы AVX2 (4 x double) для шаблонов из simd_kernel.hpp
+        struct Avx2 {
+            using V = __m256d;
+            using M = __m256d;
+            static constexpr std::size_t WIDTH = 4;
+
+            static V set1(double v) { return _mm256_set1_pd(v); }
+            static V loadu(const double *p) { return _mm256_loadu_pd(p); }
+            static void storeu(double *p, V v) { _mm256_storeu_pd(p, v); }
+            static V add(V a, V b) { return _mm256_add_pd(a, b); }
+            static V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+            static V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+            static V fmadd(V a, V b, V c) { return _mm256_fmadd_pd(a, b, c); }
+            static V fnmadd(V a, V b, V c) { return _mm256_fnmadd_pd(a, b, c); }
+            static V min(V a, V b) { return _mm256_min_pd(a, b); }
+            static V max(V a, V b) { return _mm256_max_pd(a, b); }
+            static V round(V a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static V floor(V a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+            static V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+
+            static M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+            static M le(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+            static M ge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+            static M eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+            static V select(M m, V t, V f) { return _mm256_blendv_pd(f, t, m); }
+            static bool all(M m) { return _mm256_movemask_pd(m) == 0xF; }
+
+            // Целое значение v (0 <= v < 2^52) в виде int64 через "магическое" 2^52
+            static __m256i to_int(V v) {
+                return _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(v, _mm256_set1_pd(4503599627370496.0))),
+                                        _mm256_castpd_si256(_mm256_set1_pd(4503599627370496.0)));
+            }
+            static V from_int(__m256i i) {
+                return _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(i, _mm256_castpd_si256(_mm256_set1_pd(4503599627370496.0)))),
+                                     _mm256_set1_pd(4503599627370496.0));
+            }
+            // Смещённая экспонента как double
+            static V exponent_field(V a) {
+                return from_int(_mm256_srli_epi64(_mm256_castpd_si256(a), 52));
+            }
+            // Мантисса нормализованного a как целое в [2^52, 2^53)
+            static V mantissa_int(V a) {
+                __m256i bits = _mm256_and_si256(_mm256_castpd_si256(a), _mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL));
+                return _mm256_castsi256_pd(_mm256_or_si256(bits, _mm256_set1_epi64x(0x4330000000000000LL)));
+            }
+            // 2^e для целого e из нормального диапазона
+            static V pow2(V e) {
+                return _mm256_castsi256_pd(_mm256_slli_epi64(to_int(_mm256_add_pd(e, _mm256_set1_pd(1023.0))), 52));
+            }
+            static V gather(const double *base, V idx) {
+                return _mm256_i64gather_pd(base, to_int(idx), 8);
+            }
+        };
+
+        // Примитивы AVX2 (8 x float) для run_block_f32: пара векторов Avx2 на вектор
+        struct Avx2F {
+            using V = __m256;
+            using M = __m256;
+
+            static V set1(float v) { return _mm256_set1_ps(v); }
+            static V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+            static V fmadd(V a, V b, V c) { return _mm256_fmadd_ps(a, b, c); }
+            static V fnmadd(V a, V b, V c) { return _mm256_fnmadd_ps(a, b, c); }
+            static V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+            static M lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static M eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+            static V select(M m, V t, V f) { return _mm256_blendv_ps(f, t, m); }
+
+            static V narrow(__m256d lo, __m256d hi) { return _mm256_set_m128(_mm256_cvtpd_ps(hi), _mm256_cvtpd_ps(lo)); }
+            static __m256d widen_lo(V v) { return _mm256_cvtps_pd(_mm256_castps256_ps128(v)); }
+            static __m256d widen_hi(V v) { return _mm256_cvtps_pd(_mm256_extractf128_ps(v, 1)); }
+        };
+    }
+
+    void weierstrass_block_avx2(const double *amp, const double *freq, std::size_t n,
+                                const double *xs, std::size_t xs_stride, double *out, std::size_t count) {
+        run_block<Avx2>(amp, freq, n, xs, xs_stride, out, count);
+    }
+
+    void weierstrass_block_f32_avx2(const double *amp, const double *freq, std::size_t n,
+                                    const double *xs, std::size_t xs_stride, double *out, std::size_t count) {
+        run_block_f32<Avx2, Avx2F>(amp, freq, n, xs, xs_stride, out, count);
+    }
+
+    FixedBlockFn fixed_block_avx2(std::size_t n) {
+        static constexpr auto table = fixed_block_table<Avx2>(std::make_index_sequence<MAX_FIXED_N>());
+        return n < table.size() ? table[n] : nullptr;
+    }
+
+    void weierstrass_rotate_avx2(const double *amp, const double *c0, const double *s0,
+                              const double *sc, const double *ss, std::size_t m,
+                              double *out, std::size_t count) {
+        run_rotation<Avx2>(amp, c0, s0, sc, ss, m, out, count);
+    }
+
+    void weierstrass_sincos_avx2(const double *args, double *c, double *s, std::size_t m) {
+        run_sincos<Avx2>(args, c, s, m);
+    }
+}}
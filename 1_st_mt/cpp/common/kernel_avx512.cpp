@@ -0,0 +1,128 @@
+// Собирается с -mavx512f; вызывается только после проверки CPU в batch.cpp.
+#include "kernels.hpp"
+#include "simd_kernel.hpp"
+// GCC 12 заполняет неиспользуемый сквозной операнд интринсиков (_mm512_min_pd,
+// _mm512_roundscale_pd и др.) через _mm512_undefined_pd() — "__Y = __Y", и с
+// -Wall -O2 выдаёт на каждом встраивании -Wmaybe-uninitialized. Значение операнда
+// не читается (маска — все дорожки), поэтому предупреждение глушится только в заголовке
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#include <cstdint>
+
+namespace common { namespace detail {
+    namespace {
+        // Примитивы AVX-512F (8 x double) для шаблонов из simd_kernel.hpp
+        struct Avx512 {
+            using V = __m512d;
+            using M = __mmask8;
+            static constexpr std::size_t WIDTH = 8;
+
+            static V set1(double v) { return _mm512_set1_pd(v); }
+            static V loadu(const double *p) { return _mm512_loadu_pd(p); }
+            static void storeu(double *p, V v) { _mm512_storeu_pd(p, v); }
+            static V add(V a, V b) { return _mm512_add_pd(a, b); }
+            static V sub(V a, V b) { return _mm512_sub_pd(a, b); }
+            static V mul(V a, V b) { return _mm512_mul_pd(a, b); }
+            static V fmadd(V a, V b, V c) { return _mm512_fmadd_pd(a, b, c); }
+            static V fnmadd(V a, V b, V c) { return _mm512_fnmadd_pd(a, b, c); }
+            static V min(V a, V b) { return _mm512_min_pd(a, b); }
+            static V max(V a, V b) { return _mm512_max_pd(a, b); }
+            static V round(V a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static V floor(V a) { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+            static V abs(V a) {
+                return _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL)));
+            }
+
+            static M lt(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+            static M le(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+            static M ge(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ); }
+            static M eq(V a, V b) { return _mm512_cmp_pd_mask(a, b, _CMP_EQ_OQ); }
+            static V select(M m, V t, V f) { return _mm512_mask_blend_pd(m, f, t); }
+            static bool all(M m) { return m == 0xFF; }
+
+            // Целое значение v (0 <= v < 2^52) в виде int64 через "магическое" 2^52
+            static __m512i to_int(V v) {
+                return _mm512_sub_epi64(_mm512_castpd_si512(_mm512_add_pd(v, _mm512_set1_pd(4503599627370496.0))),
+                                        _mm512_castpd_si512(_mm512_set1_pd(4503599627370496.0)));
+            }
+            static V from_int(__m512i i) {
+                return _mm512_sub_pd(_mm512_castsi512_pd(_mm512_or_si512(i, _mm512_castpd_si512(_mm512_set1_pd(4503599627370496.0)))),
+                                     _mm512_set1_pd(4503599627370496.0));
+            }
+            // Смещённая экспонента как double
+            static V exponent_field(V a) {
+                return from_int(_mm512_srli_epi64(_mm512_castpd_si512(a), 52));
+            }
+            // Мантисса нормализованного a как целое в [2^52, 2^53)
+            static V mantissa_int(V a) {
+                __m512i bits = _mm512_and_si512(_mm512_castpd_si512(a), _mm512_set1_epi64(0x000FFFFFFFFFFFFFLL));
+                return _mm512_castsi512_pd(_mm512_or_si512(bits, _mm512_set1_epi64(0x4330000000000000LL)));
+            }
+            // 2^e для целого e из нормального диапазона
+            static V pow2(V e) {
+                return _mm512_castsi512_pd(_mm512_slli_epi64(to_int(_mm512_add_pd(e, _mm512_set1_pd(1023.0))), 52));
+            }
+            static V gather(const double *base, V idx) {
+                return _mm512_i64gather_pd(to_int(idx), base, 8);
+            }
+        };
+
+        // Примитивы AVX-512F (16 x float) для run_block_f32: пара векторов Avx512 на вектор
+        struct Avx512F {
+            using V = __m512;
+            using M = __mmask16;
+
+            static V set1(float v) { return _mm512_set1_ps(v); }
+            static V sub(V a, V b) { return _mm512_sub_ps(a, b); }
+            static V mul(V a, V b) { return _mm512_mul_ps(a, b); }
+            static V fmadd(V a, V b, V c) { return _mm512_fmadd_ps(a, b, c); }
+            static V fnmadd(V a, V b, V c) { return _mm512_fnmadd_ps(a, b, c); }
+            static V abs(V a) { return _mm512_abs_ps(a); }
+            static M lt(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+            static M eq(V a, V b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+            static V select(M m, V t, V f) { return _mm512_mask_blend_ps(m, f, t); }
+
+            // Без AVX512DQ: половины склеиваются как 4 x double
+            static V narrow(__m512d lo, __m512d hi) {
+                __m512d joined = _mm512_insertf64x4(_mm512_castps_pd(_mm512_castps256_ps512(_mm512_cvtpd_ps(lo))),
+                                                    _mm256_castps_pd(_mm512_cvtpd_ps(hi)), 1);
+                return _mm512_castpd_ps(joined);
+            }
+            static __m512d widen_lo(V v) { return _mm512_cvtps_pd(_mm512_castps512_ps256(v)); }
+            static __m512d widen_hi(V v) {
+                return _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(v), 1)));
+            }
+        };
+    }
+
+    void weierstrass_block_avx512(const double *amp, const double *freq, std::size_t n,
+                                  const double *xs, std::size_t xs_stride, double *out, std::size_t count) {
+        run_block<Avx512>(amp, freq, n, xs, xs_stride, out, count);
+    }
+
+    void weierstrass_block_f32_avx512(const double *amp, const double *freq, std::size_t n,
+                                      const double *xs, std::size_t xs_stride, double *out, std::size_t count) {
+        run_block_f32<Avx512, Avx512F>(amp, freq, n, xs, xs_stride, out, count);
+    }
+
+    FixedBlockFn fixed_block_avx512(std::size_t n) {
+        static constexpr auto table = fixed_block_table<Avx512>(std::make_index_sequence<MAX_FIXED_N>());
+        return n < table.size() ? table[n] : nullptr;
+    }
+
+    void weierstrass_rotate_avx512(const double *amp, const double *c0, const double *s0,
+                              const double *sc, const double *ss, std::size_t m,
+                              double *out, std::size_t count) {
+        run_rotation<Avx512>(amp, c0, s0, sc, ss, m, out, count);
+    }
+
+    void weierstrass_sincos_avx512(const double *args, double *c, double *s, std::size_t m) {
+        run_sincos<Avx512>(args, c, s, m);
+    }
+}}
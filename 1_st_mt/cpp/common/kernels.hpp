@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include "common.hpp"
+
+// Внутренние блочные ядра для weierstrass_batch (не часть публичного API).
+// out[i] = sum_k amp[k] * cos(freq[k] * xs[k * xs_stride + i]), i < count;
+// при xs_stride == 0 все слагаемые берут одни и те же точки.
+namespace common { namespace detail {
+    using BlockFn = void (*)(const double *amp, const double *freq, std::size_t n,
+                             const double *xs, std::size_t xs_stride, double *out, std::size_t count);
+
+    void weierstrass_block_avx2(const double *amp, const double *freq, std::size_t n,
+                                const double *xs, std::size_t xs_stride, double *out, std::size_t count);
+    void weierstrass_block_avx512(const double *amp, const double *freq, std::size_t n,
+                                  const double *xs, std::size_t xs_stride, double *out, std::size_t count);
+
+    // То же с многочленами cos во float (Arithmetic::Fp32), см. run_block_f32
+    void weierstrass_block_f32_avx2(const double *amp, const double *freq, std::size_t n,
+                                    const double *xs, std::size_t xs_stride, double *out, std::size_t count);
+    void weierstrass_block_f32_avx512(const double *amp, const double *freq, std::size_t n,
+                                      const double *xs, std::size_t xs_stride, double *out, std::size_t count);
+
+    // out[j] += sum_k amp[k] * cos(phi_k + j*theta_k), j < count (count кратно 8);
+    // (c0, s0) = cos/sin phi_k, (sc, ss) = cos/sin theta_k
+    using RotateFn = void (*)(const double *amp, const double *c0, const double *s0,
+                              const double *sc, const double *ss, std::size_t m,
+                              double *out, std::size_t count);
+
+    void weierstrass_rotate_avx2(const double *amp, const double *c0, const double *s0,
+                                 const double *sc, const double *ss, std::size_t m,
+                                 double *out, std::size_t count);
+    void weierstrass_rotate_avx512(const double *amp, const double *c0, const double *s0,
+                                   const double *sc, const double *ss, std::size_t m,
+                                   double *out, std::size_t count);
+
+    // Ядра run_block_fixed для n слагаемых; nullptr вне 1 <= n <= MAX_FIXED_N
+    FixedBlockFn fixed_block_avx2(std::size_t n);
+    FixedBlockFn fixed_block_avx512(std::size_t n);
+
+    // c[k] = cos(args[k]), s[k] = sin(args[k]), k < m
+    using SinCosFn = void (*)(const double *args, double *c, double *s, std::size_t m);
+
+    void weierstrass_sincos_avx2(const double *args, double *c, double *s, std::size_t m);
+    void weierstrass_sincos_avx512(const double *args, double *c, double *s, std::size_t m);
+
+    // Ядра, выбранные для текущего CPU (см. batch.cpp); для Fp32 без SIMD —
+    // то же скалярное ядро в double
+    BlockFn selected_block_kernel();
+    BlockFn selected_block_kernel(Arithmetic arithmetic);
+    RotateFn selected_rotation_kernel();
+    SinCosFn selected_sincos_kernel();
+}}
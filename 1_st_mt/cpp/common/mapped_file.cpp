@@ -0,0 +1,94 @@
+#include "mapped_file.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Выходной файл, отображённый в память: результат пишется прямо в страничный кэш
+namespace common {
+    namespace {
+        std::string failure(const char* what, const std::string& path) {
+            return std::string(what) + " " + path + ": " + std::strerror(errno);
+        }
+    }
+
+    MappedFile::~MappedFile() { close(); }
+
+    std::size_t MappedFile::page_size() {
+        static const std::size_t size = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    std::string MappedFile::open(const std::string& path, std::size_t bytes) {
+        close();
+        path_ = path;
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) return failure("cannot open", path);
+        if (::ftruncate(fd_, static_cast<off_t>(bytes)) != 0) {
+            std::string error = failure("cannot resize", path);
+            close();
+            return error;
+        }
+        return "";
+    }
+
+    std::string MappedFile::map(std::size_t offset, std::size_t bytes) {
+        unmap();
+        // Пустое окно не отображается: mmap длины 0 — ошибка
+        if (bytes == 0) return "";
+        void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(offset));
+        if (p == MAP_FAILED) return failure("cannot map", path_);
+        data_ = p;
+        size_ = bytes;
+        offset_ = offset;
+        return "";
+    }
+
+    std::string MappedFile::create(const std::string& path, std::size_t bytes) {
+        std::string error = open(path, bytes);
+        if (error.empty()) error = map(0, bytes);
+        if (!error.empty()) close();
+        return error;
+    }
+
+    std::string MappedFile::write(std::size_t offset, const void* data, std::size_t bytes) {
+        const char* p = static_cast<const char*>(data);
+        while (bytes > 0) {
+            ssize_t done = ::pwrite(fd_, p, bytes, static_cast<off_t>(offset));
+            if (done < 0 && errno == EINTR) continue;
+            if (done <= 0) return failure("cannot write", path_);
+            p += done;
+            offset += static_cast<std::size_t>(done);
+            bytes -= static_cast<std::size_t>(done);
+        }
+        return "";
+    }
+
+    bool MappedFile::advise_huge_pages() {
+#ifdef MADV_HUGEPAGE
+        return data_ && ::madvise(data_, size_, MADV_HUGEPAGE) == 0;
+#else
+        return false;
+#endif
+    }
+
+    std::string MappedFile::sync(bool wait) {
+        if (data_ && ::msync(data_, size_, wait ? MS_SYNC : MS_ASYNC) != 0)
+            return std::string("msync: ") + std::strerror(errno);
+        return "";
+    }
+
+    void MappedFile::unmap() {
+        if (data_) ::munmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+        offset_ = 0;
+    }
+
+    void MappedFile::close() {
+        unmap();
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+}
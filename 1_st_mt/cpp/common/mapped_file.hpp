@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+namespace common {
+    // Output file mapped read-write with MAP_SHARED: stores to data() land in
+    // the page cache of the file, sync() writes them back, and close() or the
+    // destructor unmaps it. A window of the file can be mapped instead of all
+    // of it, to bound resident memory. Errors are returned as messages, "" on success.
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // Creates or truncates path to bytes and maps all of it
+        std::string create(const std::string& path, std::size_t bytes);
+        // Creates or truncates path to bytes without mapping it
+        std::string open(const std::string& path, std::size_t bytes);
+        // Replaces the mapping by bytes of the file from offset, a multiple of page_size()
+        std::string map(std::size_t offset, std::size_t bytes);
+        // pwrite outside the mapping, e.g. a header before the mapped windows
+        std::string write(std::size_t offset, const void* data, std::size_t bytes);
+        // madvise(MADV_HUGEPAGE) on the mapping; false where the kernel or the
+        // file system does not take the hint
+        bool advise_huge_pages();
+        // msync of the mapping; wait == false only schedules the write-back
+        std::string sync(bool wait = true);
+        void unmap();
+        void close();
+
+        void* data() const { return data_; }
+        std::size_t size() const { return size_; }
+        std::size_t offset() const { return offset_; }
+
+        static std::size_t page_size();
+
+    private:
+        int fd_ = -1;
+        std::string path_;
+        void* data_ = nullptr;
+        std::size_t size_ = 0;
+        std::size_t offset_ = 0;
+    };
+}
@@ -0,0 +1,74 @@
+#include "common.hpp"
+#include "exact.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <new>
+#include <tuple>
+
+// План вычисления: таблицы коэффициентов для фиксированных (a, b, n)
+namespace common {
+    namespace {
+        // Кэш планов по побитному ключу (a, b, n, режим редукции, точность)
+        using PlanKey = std::tuple<std::uint64_t, std::uint64_t, std::size_t, Reduction, Arithmetic, Summation, bool>;
+        // Не даём кэшу расти без ограничений при переборе параметров
+        constexpr std::size_t PLAN_CACHE_LIMIT = 64;
+
+        std::mutex g_plan_mutex;
+        std::map<PlanKey, std::shared_ptr<const WeierstrassPlan>> g_plans;
+
+        std::uint64_t bits_of(double v) {
+            std::uint64_t u;
+            std::memcpy(&u, &v, sizeof u);
+            return u;
+        }
+    }
+
+    void WeierstrassPlan::AlignedDelete::operator()(double* p) const {
+        ::operator delete[](p, std::align_val_t(ALIGN));
+    }
+
+    WeierstrassPlan::WeierstrassPlan(double a, double b, std::size_t n, Reduction reduction, PrecisionPolicy precision)
+        : a_(a), b_(b), n_(n), reduction_(reduction), precision_(precision) {
+        // Каждая таблица занимает целое число кэш-линий
+        constexpr std::size_t per_line = ALIGN / sizeof(double);
+        std::size_t stride = (n + per_line - 1) / per_line * per_line;
+        if (stride == 0) stride = per_line;
+        storage_.reset(static_cast<double*>(::operator new[](2 * stride * sizeof(double), std::align_val_t(ALIGN))));
+        amp_ = storage_.get();
+        freq_ = amp_ + stride;
+        for (std::size_t k = 0; k < stride; ++k) {
+            amp_[k] = k < n ? std::pow(a, static_cast<double>(k)) : 0.0;
+            freq_[k] = k < n ? PI * std::pow(b, static_cast<double>(k)) : 0.0;
+        }
+        if (reduction == Reduction::Exact) residues_ = detail::power_residues(b, n);
+    }
+
+    double WeierstrassPlan::operator()(double x) const {
+        if (exact_reduction()) {
+            double out;
+            detail::weierstrass_block_exact(*this, &x, &out, 1);
+            return out;
+        }
+        double sum = 0.0;
+        for (std::size_t k = 0; k < n_; ++k) {
+            sum += amp_[k] * std::cos(freq_[k] * x);
+        }
+        return sum;
+    }
+
+    std::shared_ptr<const WeierstrassPlan> weierstrass_plan(double a, double b, std::size_t n, Reduction reduction,
+                                                            PrecisionPolicy precision) {
+        PlanKey key{bits_of(a), bits_of(b), n, reduction, precision.arithmetic, precision.summation,
+                    precision.reproducible};
+        std::lock_guard<std::mutex> lock(g_plan_mutex);
+        auto it = g_plans.find(key);
+        if (it != g_plans.end()) return it->second;
+        if (g_plans.size() >= PLAN_CACHE_LIMIT) g_plans.clear();
+        auto plan = std::make_shared<const WeierstrassPlan>(a, b, n, reduction, precision);
+        g_plans.emplace(key, plan);
+        return plan;
+    }
+}
@@ -0,0 +1,309 @@
+#include "profile.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <utility>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// Инструментирование: записи исполнителей и фаз копятся под одним мьютексом —
+// он берётся раз за прогон, а не на задачу, и только при включённом профиле
+namespace common {
+    namespace detail {
+        std::atomic<bool> profiling_flag{[] {
+            const char* env = std::getenv("WEIER_PROFILE");
+            return env && *env && std::string(env) != "0";
+        }()};
+    }
+
+    namespace {
+        using Clock = RunProfile::Clock;
+
+        double seconds(Clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+        struct Store {
+            std::mutex mutex;
+            std::map<std::pair<std::string, unsigned>, WorkerProfile> workers;
+            std::vector<PhaseProfile> phases;
+            std::string counters;      // первая причина, по которой счётчики недоступны
+        };
+
+        Store& store() {
+            static Store s;
+            return s;
+        }
+
+        // Группа счётчиков потока: лидер — такты, второй — инструкции, чтение обоих одним read()
+        struct ThreadCounters {
+            int leader = -1, member = -1;
+            bool tried = false;
+
+            ~ThreadCounters() {
+#ifdef __linux__
+                if (member >= 0) ::close(member);
+                if (leader >= 0) ::close(leader);
+#endif
+            }
+
+            void open() {
+                tried = true;
+#ifdef __linux__
+                auto event = [](std::uint64_t config, int group) {
+                    perf_event_attr attr;
+                    std::memset(&attr, 0, sizeof attr);
+                    attr.size = sizeof attr;
+                    attr.type = PERF_TYPE_HARDWARE;
+                    attr.config = config;
+                    attr.read_format = PERF_FORMAT_GROUP;
+                    // Только пользовательский режим: так хватает perf_event_paranoid <= 2
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+                };
+                leader = event(PERF_COUNT_HW_CPU_CYCLES, -1);
+                if (leader >= 0) member = event(PERF_COUNT_HW_INSTRUCTIONS, leader);
+                if (leader < 0 || member < 0) {
+                    std::string reason = std::string("perf_event_open: ") + std::strerror(errno);
+                    if (leader >= 0) ::close(leader);
+                    leader = member = -1;
+                    Store& s = store();
+                    std::lock_guard<std::mutex> lock(s.mutex);
+                    if (s.counters.empty()) s.counters = reason;
+                }
+#else
+                Store& s = store();
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (s.counters.empty()) s.counters = "hardware counters need Linux perf_event_open";
+#endif
+            }
+        };
+
+        thread_local ThreadCounters thread_counters;
+
+        std::string number(double v) {
+            char buf[32];
+            std::snprintf(buf, sizeof buf, "%.6g", v);
+            return buf;
+        }
+    }
+
+    void set_profiling(bool on) { detail::profiling_flag.store(on, std::memory_order_relaxed); }
+
+    CounterSample read_counters() {
+        CounterSample sample;
+        if (!thread_counters.tried) thread_counters.open();
+#ifdef __linux__
+        if (thread_counters.leader < 0) return sample;
+        std::uint64_t data[3] = {0, 0, 0};   // число счётчиков, такты, инструкции
+        if (::read(thread_counters.leader, data, sizeof data) != static_cast<ssize_t>(sizeof data) || data[0] != 2)
+            return sample;
+        sample.cycles = data[1];
+        sample.instructions = data[2];
+        sample.valid = true;
+#endif
+        return sample;
+    }
+
+    std::string counters_status() {
+        Store& s = store();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        return s.counters.empty() ? "perf_event_open" : s.counters;
+    }
+
+    void add_worker_profile(const WorkerProfile& worker) {
+        Store& s = store();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        WorkerProfile& w = s.workers[{worker.group, worker.worker}];
+        w.group = worker.group;
+        w.worker = worker.worker;
+        w.runs += worker.runs;
+        w.tasks += worker.tasks;
+        w.busy += worker.busy;
+        w.idle += worker.idle;
+        w.startup += worker.startup;
+        w.cycles += worker.cycles;
+        w.instructions += worker.instructions;
+    }
+
+    void add_phase(const std::string& name, double seconds, std::size_t count) {
+        Store& s = store();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto it = std::find_if(s.phases.begin(), s.phases.end(),
+                               [&](const PhaseProfile& p) { return p.name == name; });
+        if (it == s.phases.end()) it = s.phases.insert(s.phases.end(), PhaseProfile{name, 0, 0.0});
+        it->count += count;
+        it->seconds += seconds;
+    }
+
+    ProfileReport profile_report() {
+        ProfileReport report;
+        report.counters = counters_status();
+        Store& s = store();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        report.phases = s.phases;
+        for (const auto& entry : s.workers) report.workers.push_back(entry.second);
+        report.groups = profile_groups(report.workers);
+        return report;
+    }
+
+    std::vector<GroupProfile> profile_groups(const std::vector<WorkerProfile>& workers) {
+        std::vector<GroupProfile> groups;
+        for (const WorkerProfile& w : workers) {
+            auto it = std::find_if(groups.begin(), groups.end(),
+                                   [&](const GroupProfile& g) { return g.group == w.group; });
+            if (it == groups.end()) {
+                it = groups.insert(groups.end(), GroupProfile());
+                it->group = w.group;
+            }
+            ++it->workers;
+            it->runs = std::max(it->runs, w.runs);
+            it->busy += w.busy;
+            it->idle += w.idle;
+            it->startup += w.startup;
+            it->cycles += w.cycles;
+            it->instructions += w.instructions;
+            it->imbalance = std::max(it->imbalance, w.busy);   // пока — максимум busy
+        }
+        for (GroupProfile& g : groups) g.imbalance = g.busy > 0.0 ? g.imbalance * g.workers / g.busy : 0.0;
+        return groups;
+    }
+
+    void reset_profile() {
+        Store& s = store();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        s.workers.clear();
+        s.phases.clear();
+    }
+
+    std::string profile_json(const ProfileReport& report) {
+        std::ostringstream out;
+        out << "{\"counters\": \"" << report.counters << "\", \"groups\": [";
+        for (std::size_t i = 0; i < report.groups.size(); ++i) {
+            const GroupProfile& g = report.groups[i];
+            out << (i ? ", " : "") << "{\"group\": \"" << g.group << "\", \"workers\": " << g.workers
+                << ", \"runs\": " << g.runs << ", \"busy_s\": " << number(g.busy) << ", \"idle_s\": " << number(g.idle)
+                << ", \"startup_s\": " << number(g.startup) << ", \"imbalance\": " << number(g.imbalance)
+                << ", \"cycles\": " << g.cycles << ", \"instructions\": " << g.instructions
+                << ", \"ipc\": " << (g.cycles ? number(g.ipc()) : "null") << "}";
+        }
+        out << "], \"workers\": [";
+        for (std::size_t i = 0; i < report.workers.size(); ++i) {
+            const WorkerProfile& w = report.workers[i];
+            double ipc = w.cycles ? static_cast<double>(w.instructions) / static_cast<double>(w.cycles) : 0.0;
+            out << (i ? ", " : "") << "{\"group\": \"" << w.group << "\", \"worker\": " << w.worker
+                << ", \"runs\": " << w.runs << ", \"tasks\": " << w.tasks << ", \"busy_s\": " << number(w.busy)
+                << ", \"idle_s\": " << number(w.idle) << ", \"startup_s\": " << number(w.startup)
+                << ", \"cycles\": " << w.cycles << ", \"instructions\": " << w.instructions
+                << ", \"ipc\": " << (w.cycles ? number(ipc) : "null") << "}";
+        }
+        out << "], \"phases\": [";
+        for (std::size_t i = 0; i < report.phases.size(); ++i) {
+            const PhaseProfile& p = report.phases[i];
+            out << (i ? ", " : "") << "{\"name\": \"" << p.name << "\", \"count\": " << p.count
+                << ", \"seconds\": " << number(p.seconds) << "}";
+        }
+        out << "]}";
+        return out.str();
+    }
+
+    std::string profile_text(const ProfileReport& report) {
+        std::ostringstream out;
+        out << "Profile (counters: " << report.counters << ")\n";
+        for (const GroupProfile& g : report.groups) {
+            out << "  " << g.group << ": " << g.workers << " workers, " << g.runs << " runs, busy " << number(g.busy)
+                << "s, idle " << number(g.idle) << "s, startup " << number(g.startup) << "s, imbalance "
+                << number(g.imbalance);
+            if (g.cycles) out << ", IPC " << number(g.ipc());
+            out << "\n";
+            for (const WorkerProfile& w : report.workers) {
+                if (w.group != g.group) continue;
+                out << "    " << w.worker << ": busy " << number(w.busy) << "s, idle " << number(w.idle)
+                    << "s, startup " << number(w.startup) << "s, " << w.tasks << " tasks";
+                if (w.cycles)
+                    out << ", IPC " << number(static_cast<double>(w.instructions) / static_cast<double>(w.cycles));
+                out << "\n";
+            }
+        }
+        for (const PhaseProfile& p : report.phases)
+            out << "  " << p.name << ": " << number(p.seconds) << "s in " << p.count << "\n";
+        return out.str();
+    }
+
+    // Строка кэша исполнителя: пишет только он сам, владелец читает после прогона
+    struct alignas(64) RunProfile::Slot {
+        bool entered = false;
+        double startup = 0.0, busy = 0.0;
+        std::size_t tasks = 0;
+        CounterSample counters;      // при входе, после leave() — разность
+    };
+
+    RunProfile::RunProfile(const char* name, unsigned workers) {
+        if (!profiling() || workers == 0) return;
+        group_ = std::string(name) + " " + std::to_string(workers);
+        workers_ = workers;
+        start_ = Clock::now();
+        slots_.reset(new Slot[workers]);
+    }
+
+    RunProfile::~RunProfile() = default;
+
+    void RunProfile::enter(unsigned worker) {
+        if (!slots_) return;
+        Slot& s = slots_[worker];
+        s.entered = true;
+        s.startup = seconds(Clock::now() - start_);
+        s.counters = read_counters();
+    }
+
+    void RunProfile::busy(unsigned worker, Clock::time_point since, std::size_t tasks) {
+        if (!slots_) return;
+        Slot& s = slots_[worker];
+        s.busy += seconds(Clock::now() - since);
+        s.tasks += tasks;
+    }
+
+    void RunProfile::leave(unsigned worker) {
+        if (!slots_) return;
+        Slot& s = slots_[worker];
+        CounterSample end = read_counters();
+        if (s.counters.valid && end.valid) {
+            s.counters.cycles = end.cycles - s.counters.cycles;
+            s.counters.instructions = end.instructions - s.counters.instructions;
+        } else {
+            s.counters = CounterSample();
+        }
+    }
+
+    void RunProfile::finish() {
+        if (!slots_) return;
+        double total = seconds(Clock::now() - start_);
+        for (unsigned id = 0; id < workers_; ++id) {
+            const Slot& s = slots_[id];
+            WorkerProfile w;
+            w.group = group_;
+            w.worker = id;
+            w.runs = 1;
+            w.tasks = s.tasks;
+            w.busy = s.busy;
+            // Не успевший войти исполнитель простоял весь прогон
+            w.startup = s.entered ? s.startup : total;
+            w.idle = std::max(total - s.busy, 0.0);
+            w.cycles = s.counters.valid ? s.counters.cycles : 0;
+            w.instructions = s.counters.valid ? s.counters.instructions : 0;
+            add_worker_profile(w);
+        }
+        slots_.reset();
+    }
+
+    ScopedPhase::~ScopedPhase() {
+        if (name_) add_phase(name_, seconds(RunProfile::Clock::now() - start_));
+    }
+}
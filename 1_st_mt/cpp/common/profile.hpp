@@ -0,0 +1,133 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace common {
+    // Opt-in instrumentation shared by the backends: per-worker busy / idle
+    // time of pool runs and OpenMP regions, per-rank MPI compute vs collective
+    // time, OpenCL event profiling and, on Linux, hardware counters of the
+    // worker threads. WEIER_PROFILE=1 in the environment or set_profiling(true)
+    // turns it on; while it is off every hook is one relaxed load and a branch.
+    // Records accumulate process-wide until reset_profile().
+    namespace detail {
+        extern std::atomic<bool> profiling_flag;
+    }
+
+    inline bool profiling() { return detail::profiling_flag.load(std::memory_order_relaxed); }
+    // OpenCL engines only profile if this was on when they were created
+    void set_profiling(bool on);
+
+    // Cycles and instructions in user space of the calling thread since its
+    // first read_counters() (perf_event_open, one counter group per thread,
+    // opened on first use); valid == false where the counters are unavailable
+    struct CounterSample {
+        std::uint64_t cycles = 0;
+        std::uint64_t instructions = 0;
+        bool valid = false;
+    };
+    CounterSample read_counters();
+    // "perf_event_open", or why the counters are unavailable
+    std::string counters_status();
+
+    // One worker of a group (a pool, OpenMP, MPI ranks) summed over runs
+    struct WorkerProfile {
+        std::string group;             // "pool 4", "openmp 4", "single 1", "mpi"
+        unsigned worker = 0;           // worker, OpenMP thread or rank
+        std::size_t runs = 0;          // runs the worker was part of
+        std::size_t tasks = 0;         // tasks, loop iterations or MPI chunks
+        double busy = 0.0;             // seconds in tasks; MPI: in the engine
+        double idle = 0.0;             // rest of the run: wake-up, stealing, barriers; MPI: collectives
+        double startup = 0.0;          // seconds from run start to the worker's arrival
+        std::uint64_t cycles = 0;      // while in the run, if the counters are available
+        std::uint64_t instructions = 0;
+    };
+
+    // Summary of a group: imbalance = max busy / mean busy over its workers
+    struct GroupProfile {
+        std::string group;
+        unsigned workers = 0;
+        std::size_t runs = 0;
+        double busy = 0.0, idle = 0.0, startup = 0.0;
+        double imbalance = 0.0;
+        std::uint64_t cycles = 0, instructions = 0;
+        double ipc() const { return cycles ? static_cast<double>(instructions) / static_cast<double>(cycles) : 0.0; }
+    };
+
+    // Named interval: "opencl build", "opencl kernel", "opencl read", "mpi compute", ...
+    struct PhaseProfile {
+        std::string name;
+        std::size_t count = 0;
+        double seconds = 0.0;
+    };
+
+    struct ProfileReport {
+        std::vector<WorkerProfile> workers;   // by group, then worker
+        std::vector<GroupProfile> groups;
+        std::vector<PhaseProfile> phases;     // in order of first record
+        std::string counters;                 // counters_status()
+    };
+
+    // Merged into the record of (group, worker); phases by name
+    void add_worker_profile(const WorkerProfile& worker);
+    void add_phase(const std::string& name, double seconds, std::size_t count = 1);
+    ProfileReport profile_report();
+    void reset_profile();
+    // Group summaries of worker records, in order of first appearance; for
+    // reports assembled by hand, e.g. integral_mpi::gather_profile
+    std::vector<GroupProfile> profile_groups(const std::vector<WorkerProfile>& workers);
+    // One JSON object; a plain-text table for the console
+    std::string profile_json(const ProfileReport& report);
+    std::string profile_text(const ProfileReport& report);
+
+    // Workers of one parallel run (a pool run(), an OpenMP region). Inactive
+    // unless profiling() at construction; then each worker calls enter(),
+    // adds its task time with busy() and calls leave(), touching only its own
+    // cache line, and the owner calls finish() once the run is over, which
+    // turns the rest of the run into idle time and records the workers.
+    class RunProfile {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // Records go to group "<name> <workers>"
+        RunProfile(const char* name, unsigned workers);
+        ~RunProfile();
+        RunProfile(const RunProfile&) = delete;
+        RunProfile& operator=(const RunProfile&) = delete;
+
+        bool active() const { return slots_ != nullptr; }
+        // Start of a timed interval; Clock::time_point() when inactive
+        Clock::time_point clock() const { return active() ? Clock::now() : Clock::time_point(); }
+
+        void enter(unsigned worker);
+        void busy(unsigned worker, Clock::time_point since, std::size_t tasks = 1);
+        void leave(unsigned worker);
+        void finish();
+
+    private:
+        struct Slot;
+        std::string group_;
+        unsigned workers_ = 0;
+        Clock::time_point start_;
+        std::unique_ptr<Slot[]> slots_;
+    };
+
+    // Adds the lifetime of the scope to a phase while profiling() is on
+    class ScopedPhase {
+    public:
+        explicit ScopedPhase(const char* name) : name_(profiling() ? name : nullptr) {
+            if (name_) start_ = RunProfile::Clock::now();
+        }
+        ~ScopedPhase();
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    private:
+        const char* name_;
+        RunProfile::Clock::time_point start_;
+    };
+}
@@ -0,0 +1,84 @@
+#include "common.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Вычисление суммы по равномерной сетке средних точек рекуррентным поворотом:
+// cos/sin слагаемого в точке i+1 получаются из точки i умножением на
+// фиксированный комплексный множитель (cos(freq*h), sin(freq*h)).
+namespace common {
+    namespace {
+        // Вращаются только слагаемые с аргументом меньше 2^47 на сегменте.
+        // Выше скалярный путь сам округляет аргумент cos на ~1e-2 рад и больше,
+        // рекуррентная фаза с ним расходится — такие слагаемые считаются напрямую.
+        constexpr double ROTATION_ARG_LIMIT = 140737488355328.0;   // 2^47
+    }
+
+    double weierstrass_midpoint_sum_rotation(const WeierstrassPlan& plan, double x0, double h,
+                                             std::size_t begin, std::size_t end) {
+        // Точная редукция сохраняет свою семантику — без рекуррентного поворота
+        if (plan.exact_reduction() || begin >= end) return weierstrass_midpoint_sum(plan, x0, h, begin, end);
+
+        constexpr std::size_t R = ROTATION_RESEED;
+        std::size_t n = plan.n();
+        const double* amp = plan.amp();
+        const double* freq = plan.freq();
+        detail::BlockFn fn = detail::selected_block_kernel(plan.precision().arithmetic);
+        detail::RotateFn rotate = detail::selected_rotation_kernel();
+        detail::SinCosFn sincos = detail::selected_sincos_kernel();
+
+        // Множители поворота на шаг h для всех слагаемых
+        thread_local std::vector<double> step_arg, step_c, step_s;
+        step_arg.resize(n);
+        step_c.resize(n);
+        step_s.resize(n);
+        for (std::size_t k = 0; k < n; ++k) step_arg[k] = freq[k] * h;
+        sincos(step_arg.data(), step_c.data(), step_s.data(), n);
+
+        // Сжатые массивы на сегмент: вращаемые (ra, rc, rs, seed, c, s) и прямые (da, df) слагаемые
+        thread_local std::vector<double> ra, rc, rs, seed, c, s, da, df;
+        double xs[R];
+        double vals[R];
+        RunningSum sum(plan.precision().summation);
+
+        // Сегменты выровнены по глобальному индексу i и всегда считаются целиком,
+        // поэтому значение в каждой точке не зависит от того, как [0, steps)
+        // поделён между потоками; суммируется только пересечение с [begin, end)
+        for (std::size_t seg = begin - begin % R; seg < end; seg += R) {
+            for (std::size_t j = 0; j < R; ++j) xs[j] = x0 + h * (static_cast<double>(seg + j) + 0.5);
+            double xmax = std::max(std::abs(xs[0]), std::abs(xs[R - 1]));
+
+            ra.clear(); rc.clear(); rs.clear(); seed.clear();
+            da.clear(); df.clear();
+            for (std::size_t k = 0; k < n; ++k) {
+                if (std::abs(freq[k]) * xmax < ROTATION_ARG_LIMIT) {
+                    ra.push_back(amp[k]);
+                    rc.push_back(step_c[k]);
+                    rs.push_back(step_s[k]);
+                    seed.push_back(freq[k] * xs[0]);
+                } else {
+                    da.push_back(amp[k]);
+                    df.push_back(freq[k]);
+                }
+            }
+            // Пересев: точные cos/sin в первой точке сегмента
+            c.resize(seed.size());
+            s.resize(seed.size());
+            sincos(seed.data(), c.data(), s.data(), seed.size());
+
+            // Прямые слагаемые — SIMD-ядром, вращаемые добавляются поверх
+            if (!da.empty()) {
+                fn(da.data(), df.data(), da.size(), xs, 0, vals, R);
+            } else {
+                std::fill(vals, vals + R, 0.0);
+            }
+            rotate(ra.data(), c.data(), s.data(), rc.data(), rs.data(), ra.size(), vals, R);
+
+            std::size_t lo = std::max(seg, begin) - seg;
+            std::size_t hi = std::min(seg + R, end) - seg;
+            sum.add(vals + lo, hi - lo);
+        }
+        return sum.value();
+    }
+}
@@ -0,0 +1,364 @@
+#pragma once
+// Внутренний заголовок: подключается только из kernel_*.cpp, которые
+// собираются с флагами конкретного набора инструкций (см. CMakeLists.txt).
+// Всё объявлено во внутреннем пространстве имён, чтобы версии для разных
+// ISA не смешивались при компоновке.
+#include <array>
+#include <cstddef>
+#include <utility>
+
+namespace common { namespace detail { namespace {
+    // Биты 2/pi по 24 на элемент (таблица ipio2 из fdlibm); 48 элементов
+    // достаточно для редукции любого конечного double.
+    constexpr double TWO_OVER_PI_24[48] = {
+        0xA2F983, 0x6E4E44, 0x1529FC, 0x2757D1, 0xF534DD, 0xC0DB62,
+        0x95993C, 0x439041, 0xFE5163, 0xABDEBB, 0xC561B7, 0x246E3A,
+        0x424DD2, 0xE00649, 0x2EEA09, 0xD1921C, 0xFE1DEB, 0x1CB129,
+        0xA73EE8, 0x8235F5, 0x2EBB44, 0x84E99C, 0x7026B4, 0x5F7E41,
+        0x3991D6, 0x398353, 0x39F49C, 0x845F8B, 0xBDF928, 0x3B1FF8,
+        0x97FFDE, 0x05980F, 0xEF2F11, 0x8B5A0A, 0x6D1F6D, 0x367ECF,
+        0x27CB09, 0xB74F46, 0x3F669E, 0x5FEA2D, 0x7527BA, 0xC7EBE5,
+        0xF17B3D, 0x0739F7, 0x8A5292, 0xEA6BFB, 0x5FB11F, 0x8D5D08,
+    };
+
+    constexpr double TWO_OVER_PI = 0.6366197723675814;
+    // pi/2 = PIO2_1 + PIO2_2 + PIO2_3 (редукция Коди–Уэйта через FMA)
+    constexpr double PIO2_1 = 1.5707963267948966;
+    constexpr double PIO2_2 = 6.123233995736766e-17;
+    constexpr double PIO2_3 = -1.4973849048591698e-33;
+    // До этой границы редукция Коди–Уэйта точна до ~1e-16 (q < 2^48),
+    // выше используется редукция Пэйна–Ханека по таблице 2/pi.
+    constexpr double CW_LIMIT = 281474976710656.0;   // 2^48
+    constexpr double TWO_M24 = 1.0 / 16777216.0;     // 2^-24
+
+    // Коэффициенты __kernel_sin / __kernel_cos из fdlibm, |r| <= pi/4
+    constexpr double S1 = -1.66666666666666324348e-01, S2 = 8.33333333332248946124e-03,
+                     S3 = -1.98412698298579493134e-04, S4 = 2.75573137070700676789e-06,
+                     S5 = -2.50507602534068634195e-08, S6 = 1.58969099521155010221e-10;
+    constexpr double C1 = 4.16666666666666019037e-02, C2 = -1.38888888888741095749e-03,
+                     C3 = 2.48015872894767294178e-05, C4 = -2.75573143513906633035e-07,
+                     C5 = 2.08757232129817482790e-09, C6 = -1.13596475577881948265e-11;
+
+    // Коэффициенты sinf / cosf из Cephes, |r| <= pi/4, ошибка ~1e-7
+    constexpr float FS1 = -1.6666654611e-1f, FS2 = 8.3321608736e-3f, FS3 = -1.9515295891e-4f;
+    constexpr float FC1 = 4.166664568298827e-2f, FC2 = -1.388731625493765e-3f, FC3 = 2.443315711809948e-5f;
+
+    // Кусков 2/pi в редукции Пэйна–Ханека: хвост после j кусков меньше
+    // 2^(79 - 24j) четвертей оборота. Шесть — точность double; для fp32
+    // пяти хватает при любой амплитуде, четырёх (хвост ~1e-5 рад) — когда
+    // амплитуда слагаемого не больше F32_LOW_AMP
+    constexpr int PH_PIECES = 6;
+    constexpr double F32_LOW_AMP = 1.0 / 1024.0;
+
+    // Векторный косинус поверх примитивов S (см. kernel_avx2.cpp / kernel_avx512.cpp).
+    // Точность ~1e-16 абсолютной ошибки на всём диапазоне double.
+    template <class S>
+    struct VecCos {
+        using V = typename S::V;
+
+        // x mod 4 в [0, 4) для целых x
+        static V mod4(V x) {
+            return S::fnmadd(S::set1(4.0), S::floor(S::mul(x, S::set1(0.25))), x);
+        }
+
+        // x mod 4 в [-2, 2]; вычитание точное для любого double
+        static V rem4(V x) {
+            return S::fnmadd(S::set1(4.0), S::round(S::mul(x, S::set1(0.25))), x);
+        }
+
+        // Выбор sin/cos и знака по квадранту q (0..3): cos(r + q*pi/2)
+        static V finish(V r, V q) {
+            V z = S::mul(r, r);
+            V ps = S::fmadd(z, S::set1(S6), S::set1(S5));
+            ps = S::fmadd(z, ps, S::set1(S4));
+            ps = S::fmadd(z, ps, S::set1(S3));
+            ps = S::fmadd(z, ps, S::set1(S2));
+            ps = S::fmadd(z, ps, S::set1(S1));
+            V sinr = S::fmadd(S::mul(r, z), ps, r);
+
+            V pc = S::fmadd(z, S::set1(C6), S::set1(C5));
+            pc = S::fmadd(z, pc, S::set1(C4));
+            pc = S::fmadd(z, pc, S::set1(C3));
+            pc = S::fmadd(z, pc, S::set1(C2));
+            pc = S::fmadd(z, pc, S::set1(C1));
+            V hz = S::mul(S::set1(0.5), z);
+            V w = S::sub(S::set1(1.0), hz);
+            V corr = S::fmadd(S::mul(z, z), pc, S::sub(S::sub(S::set1(1.0), w), hz));
+            V cosr = S::add(w, corr);
+
+            V half = S::floor(S::mul(q, S::set1(0.5)));
+            auto odd = S::eq(S::fnmadd(S::set1(2.0), half, q), S::set1(1.0));
+            auto neg = S::ge(mod4(S::add(q, S::set1(1.0))), S::set1(2.0));
+            V res = S::select(odd, sinr, cosr);
+            return S::select(neg, S::sub(S::set1(0.0), res), res);
+        }
+
+        // ax = |x| < CW_LIMIT: x = q*pi/2 + r.
+        // Coarse (для fp32): без PIO2_3, k*PIO2_3 < 5e-19
+        template <bool Coarse = false>
+        static V reduce_small(V ax, V &q) {
+            V k = S::round(S::mul(ax, S::set1(TWO_OVER_PI)));
+            V r = S::fnmadd(k, S::set1(PIO2_1), ax);
+            r = S::fnmadd(k, S::set1(PIO2_2), r);
+            if (!Coarse) r = S::fnmadd(k, S::set1(PIO2_3), r);
+            q = mod4(k);
+            return r;
+        }
+
+        // Пэйн–Ханек: ax = M * 2^e, ax*2/pi mod 4 = sum_j M*c_j*2^(e-24j) mod 4.
+        // Слагаемые с e-24j >= 2 кратны 4 и отбрасываются; берём шесть
+        // следующих кусков, хвост меньше 2^-66. Каждое произведение M*c_j
+        // раскладывается точно через FMA и суммируется two-sum'ом.
+        // Coarse (для fp32): pieces кусков и простое сложение — ошибка
+        // сумматора ~2^-45 четверти оборота вместо ~2^-66
+        template <bool Coarse = false>
+        static V reduce_large(V ax, V &q, int pieces = PH_PIECES) {
+            V e = S::sub(S::exponent_field(ax), S::set1(1075.0));
+            V idx = S::floor(S::mul(S::max(S::sub(e, S::set1(2.0)), S::set1(0.0)), S::set1(1.0 / 24.0)));
+            V scale = S::pow2(S::fnmadd(S::set1(24.0), S::add(idx, S::set1(1.0)), e));
+            V m = S::mantissa_int(ax);
+
+            V sh = S::set1(0.0), sl = S::set1(0.0);
+            for (int j = 0; j < pieces; ++j) {
+                V c = S::gather(TWO_OVER_PI_24, S::add(idx, S::set1(static_cast<double>(j))));
+                V ph = S::mul(m, c);
+                V pl = S::fmadd(m, c, S::sub(S::set1(0.0), ph));
+                V parts[2] = {rem4(S::mul(ph, scale)), rem4(S::mul(pl, scale))};
+                for (V p : parts) {
+                    if (Coarse) {
+                        sh = S::add(sh, p);
+                        continue;
+                    }
+                    V s = S::add(sh, p);
+                    V bb = S::sub(s, sh);
+                    V err = S::add(S::sub(sh, S::sub(s, bb)), S::sub(p, bb));
+                    sh = s;
+                    sl = S::add(sl, err);
+                }
+                scale = S::mul(scale, S::set1(TWO_M24));
+            }
+            sh = rem4(sh);
+            V k = S::round(sh);
+            V f = S::add(S::sub(sh, k), sl);
+            q = mod4(k);
+            return S::fmadd(f, S::set1(PIO2_1), S::mul(f, S::set1(PIO2_2)));
+        }
+
+        // |x| = q*pi/2 + r с выбором редукции по величине аргумента
+        template <bool Coarse = false>
+        static V reduce(V ax, V &q, int pieces = PH_PIECES) {
+            auto small = S::lt(ax, S::set1(CW_LIMIT));
+            if (S::all(small)) return reduce_small<Coarse>(ax, q);
+
+            V qs, ql;
+            V rs = reduce_small<Coarse>(S::min(ax, S::set1(CW_LIMIT)), qs);
+            V rl = reduce_large<Coarse>(S::max(ax, S::set1(CW_LIMIT)), ql, pieces);
+            q = S::select(small, qs, ql);
+            return S::select(small, rs, rl);
+        }
+
+        // inf/NaN -> NaN, как у std::cos
+        static V fix_nonfinite(V ax, V res) {
+            auto finite = S::le(ax, S::set1(1.7976931348623157e308));
+            return S::select(finite, res, S::sub(ax, ax));
+        }
+
+        static V cos(V x) {
+            V ax = S::abs(x);
+            V q;
+            V r = reduce(ax, q);
+            return fix_nonfinite(ax, finish(r, q));
+        }
+
+        // cos и sin с одной редукцией: sin(y) = cos(y + 3*pi/2)
+        static void sincos(V x, V &c, V &s) {
+            V ax = S::abs(x);
+            V q;
+            V r = reduce(ax, q);
+            c = fix_nonfinite(ax, finish(r, q));
+            V sa = finish(r, mod4(S::add(q, S::set1(3.0))));
+            V sign = S::sub(x, ax);   // 0 при x >= 0, -2|x| при x < 0
+            s = fix_nonfinite(ax, S::select(S::lt(sign, S::set1(0.0)), S::sub(S::set1(0.0), sa), sa));
+        }
+    };
+
+    // cos(r + q*pi/2) во float-примитивах F: r в [-pi/4, pi/4], q — целое 0..3
+    template <class F>
+    typename F::V finish_f32(typename F::V r, typename F::V q) {
+        using FV = typename F::V;
+        FV z = F::mul(r, r);
+        FV ps = F::fmadd(F::fmadd(z, F::set1(FS3), F::set1(FS2)), z, F::set1(FS1));
+        FV sinr = F::fmadd(F::mul(r, z), ps, r);
+        FV pc = F::fmadd(F::fmadd(z, F::set1(FC3), F::set1(FC2)), z, F::set1(FC1));
+        FV cosr = F::fmadd(F::mul(z, z), pc, F::fnmadd(F::set1(0.5f), z, F::set1(1.0f)));
+        // q = 1, 3: sin; q = 1, 2: со знаком минус
+        auto odd = F::eq(F::abs(F::sub(q, F::set1(2.0f))), F::set1(1.0f));
+        auto neg = F::lt(F::abs(F::sub(q, F::set1(1.5f))), F::set1(1.0f));
+        FV res = F::select(odd, sinr, cosr);
+        return F::select(neg, F::sub(F::set1(0.0f), res), res);
+    }
+
+    // out[i] = sum_k amp[k] * cos(freq[k] * xs[k * xs_stride + i]), i < count.
+    // Цикл по слагаемым снаружи: amp[k] и freq[k] держатся в регистрах
+    // на весь блок, out[] остаётся в L1. Порядок сложения слагаемых в
+    // каждой точке тот же, что в common::weierstrass.
+    template <class S>
+    void run_block(const double *amp, const double *freq, std::size_t n,
+                   const double *xs, std::size_t xs_stride, double *out, std::size_t count) {
+        using V = typename S::V;
+        constexpr std::size_t W = S::WIDTH;
+        std::size_t full = count - count % W;
+        double tail_x[W] = {};
+        double tail_out[W] = {};
+
+        for (std::size_t i = 0; i < count; ++i) out[i] = 0.0;
+        for (std::size_t k = 0; k < n; ++k) {
+            const double *xk = xs + k * xs_stride;
+            if (k == 0 || xs_stride != 0) {
+                for (std::size_t i = full; i < count; ++i) tail_x[i - full] = xk[i];
+            }
+            V va = S::set1(amp[k]);
+            V vf = S::set1(freq[k]);
+            for (std::size_t i = 0; i < full; i += W) {
+                V c = VecCos<S>::cos(S::mul(vf, S::loadu(xk + i)));
+                S::storeu(out + i, S::add(S::loadu(out + i), S::mul(va, c)));
+            }
+            if (full < count) {
+                V c = VecCos<S>::cos(S::mul(vf, S::loadu(tail_x)));
+                S::storeu(tail_out, S::add(S::loadu(tail_out), S::mul(va, c)));
+            }
+        }
+        for (std::size_t i = full; i < count; ++i) out[i] = tail_out[i - full];
+    }
+
+    // run_block с n = N во время компиляции и общими точками (xs_stride == 0):
+    // слагаемые — внутренний цикл с постоянным числом итераций, сумма вектора
+    // точек держится в регистре, а не в out[]. Порядок сложения тот же, что в
+    // run_block, значения совпадают побитно.
+    template <class S, std::size_t N>
+    void run_block_fixed(const double *amp, const double *freq, const double *xs, double *out, std::size_t count) {
+        using V = typename S::V;
+        constexpr std::size_t W = S::WIDTH;
+        std::size_t full = count - count % W;
+
+        auto terms = [amp, freq](V x) {
+            V sum = S::set1(0.0);
+            for (std::size_t k = 0; k < N; ++k) {
+                sum = S::add(sum, S::mul(S::set1(amp[k]), VecCos<S>::cos(S::mul(S::set1(freq[k]), x))));
+            }
+            return sum;
+        };
+        for (std::size_t i = 0; i < full; i += W) S::storeu(out + i, terms(S::loadu(xs + i)));
+        if (full < count) {
+            double tail[W] = {};
+            for (std::size_t i = full; i < count; ++i) tail[i - full] = xs[i];
+            S::storeu(tail, terms(S::loadu(tail)));
+            for (std::size_t i = full; i < count; ++i) out[i] = tail[i - full];
+        }
+    }
+
+    // Элемент n — run_block_fixed<S, n>, элемент 0 пуст
+    template <class S, std::size_t... I>
+    constexpr std::array<FixedBlockFn, sizeof...(I) + 1> fixed_block_table(std::index_sequence<I...>) {
+        return {nullptr, &run_block_fixed<S, I + 1>...};
+    }
+
+    // То же для Arithmetic::Fp32: аргумент и его редукция к [-pi/4, pi/4] — в double
+    // (S), многочлены sin/cos — во float (F, вдвое больше дорожек), произведение
+    // на amp[k] и сумма — снова в double. F::narrow собирает два вектора S в один
+    // вектор F, F::widen_lo/widen_hi разбирают обратно.
+    template <class S, class F>
+    void run_block_f32(const double *amp, const double *freq, std::size_t n,
+                       const double *xs, std::size_t xs_stride, double *out, std::size_t count) {
+        using V = typename S::V;
+        constexpr std::size_t W = S::WIDTH;
+        constexpr std::size_t W2 = 2 * W;
+        std::size_t full = count - count % W2;
+        double tail_x[W2] = {};
+        double tail_out[W2] = {};
+
+        auto add_terms = [](V va, V vf, int pieces, const double *x, double *o) {
+            V alo = S::abs(S::mul(vf, S::loadu(x)));
+            V ahi = S::abs(S::mul(vf, S::loadu(x + W)));
+            V qlo, qhi;
+            V rlo = VecCos<S>::template reduce<true>(alo, qlo, pieces);
+            V rhi = VecCos<S>::template reduce<true>(ahi, qhi, pieces);
+            typename F::V c = finish_f32<F>(F::narrow(rlo, rhi), F::narrow(qlo, qhi));
+            V clo = VecCos<S>::fix_nonfinite(alo, F::widen_lo(c));
+            V chi = VecCos<S>::fix_nonfinite(ahi, F::widen_hi(c));
+            S::storeu(o, S::add(S::loadu(o), S::mul(va, clo)));
+            S::storeu(o + W, S::add(S::loadu(o + W), S::mul(va, chi)));
+        };
+
+        for (std::size_t i = 0; i < count; ++i) out[i] = 0.0;
+        for (std::size_t k = 0; k < n; ++k) {
+            const double *xk = xs + k * xs_stride;
+            if (k == 0 || xs_stride != 0) {
+                for (std::size_t i = full; i < count; ++i) tail_x[i - full] = xk[i];
+            }
+            int pieces = (amp[k] < 0 ? -amp[k] : amp[k]) <= F32_LOW_AMP ? 4 : 5;
+            V va = S::set1(amp[k]);
+            V vf = S::set1(freq[k]);
+            for (std::size_t i = 0; i < full; i += W2) add_terms(va, vf, pieces, xk + i, out + i);
+            if (full < count) add_terms(va, vf, pieces, tail_x, tail_out);
+        }
+        for (std::size_t i = full; i < count; ++i) out[i] = tail_out[i - full];
+    }
+
+    // out[j] += sum_k amp[k] * cos(phi_k + j*theta_k), j < count (count кратно WIDTH).
+    // (c0, s0) — cos/sin phi_k, (sc, ss) — cos/sin theta_k. Соседние точки
+    // раскладываются по дорожкам, а весь вектор поворачивается на WIDTH шагов.
+    template <class S>
+    void run_rotation(const double *amp, const double *c0, const double *s0,
+                      const double *sc, const double *ss, std::size_t m,
+                      double *out, std::size_t count) {
+        using V = typename S::V;
+        constexpr std::size_t W = S::WIDTH;
+        for (std::size_t k = 0; k < m; ++k) {
+            // Затравка дорожек: точки 0..W-1 последовательным поворотом
+            double lc[W], ls[W];
+            lc[0] = c0[k];
+            ls[0] = s0[k];
+            for (std::size_t l = 1; l < W; ++l) {
+                lc[l] = lc[l - 1] * sc[k] - ls[l - 1] * ss[k];
+                ls[l] = ls[l - 1] * sc[k] + lc[l - 1] * ss[k];
+            }
+            // Поворот на W шагов: (sc + i*ss)^W возведением в квадрат
+            double wc = sc[k], ws = ss[k];
+            for (std::size_t p = 1; p < W; p *= 2) {
+                double t = wc * wc - ws * ws;
+                ws = 2.0 * wc * ws;
+                wc = t;
+            }
+            V va = S::set1(amp[k]);
+            V vwc = S::set1(wc), vws = S::set1(ws);
+            V c = S::loadu(lc), s = S::loadu(ls);
+            for (std::size_t j = 0; j < count; j += W) {
+                S::storeu(out + j, S::add(S::loadu(out + j), S::mul(va, c)));
+                V nc = S::fnmadd(s, vws, S::mul(c, vwc));
+                s = S::fmadd(c, vws, S::mul(s, vwc));
+                c = nc;
+            }
+        }
+    }
+
+    // c[k] = cos(args[k]), s[k] = sin(args[k]), k < m
+    template <class S>
+    void run_sincos(const double *args, double *c, double *s, std::size_t m) {
+        using V = typename S::V;
+        constexpr std::size_t W = S::WIDTH;
+        for (std::size_t k = 0; k < m; k += W) {
+            double buf[W] = {}, bc[W], bs[W];
+            std::size_t cnt = m - k < W ? m - k : W;
+            for (std::size_t l = 0; l < cnt; ++l) buf[l] = args[k + l];
+            V vc, vs;
+            VecCos<S>::sincos(S::loadu(buf), vc, vs);
+            S::storeu(bc, vc);
+            S::storeu(bs, vs);
+            for (std::size_t l = 0; l < cnt; ++l) {
+                c[k + l] = bc[l];
+                s[k + l] = bs[l];
+            }
+        }
+    }
+}}}
\ No newline at end of file
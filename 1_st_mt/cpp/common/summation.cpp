@@ -0,0 +1,159 @@
+#include "common.hpp"
+#include "integrand.hpp"
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// Политика точности и компенсированное суммирование
+namespace common {
+    namespace {
+        // Попарная сумма блока: ошибка растёт как log2(count), а не как count
+        double pairwise(const double* v, std::size_t count) {
+            if (count <= 8) {
+                double s = 0.0;
+                for (std::size_t i = 0; i < count; ++i) s += v[i];
+                return s;
+            }
+            std::size_t half = count / 2;
+            return pairwise(v, half) + pairwise(v + half, count - half);
+        }
+
+        // Шаг Kahan (c — накопленная ошибка со знаком минус) и Neumaier (c — поправка)
+        inline void kahan_step(double& s, double& c, double v) {
+            double y = v - c;
+            double t = s + y;
+            c = (t - s) - y;
+            s = t;
+        }
+
+        inline void neumaier_step(double& s, double& c, double v) {
+            double t = s + v;
+            c += std::fabs(s) >= std::fabs(v) ? (s - t) + v : (v - t) + s;
+            s = t;
+        }
+
+        // Блок в LANES независимых цепочек: задержка сложения не сериализует цикл
+        constexpr std::size_t LANES = 4;
+
+        template <class Step>
+        void compensated_lanes(const double* v, std::size_t count, double (&s)[LANES], double (&c)[LANES], Step step) {
+            std::size_t full = count - count % LANES;
+            for (std::size_t i = 0; i < full; i += LANES) {
+                for (std::size_t l = 0; l < LANES; ++l) step(s[l], c[l], v[i + l]);
+            }
+            for (std::size_t i = full; i < count; ++i) step(s[i - full], c[i - full], v[i]);
+        }
+    }
+
+    PrecisionPolicy default_precision() {
+        PrecisionPolicy p;
+        if (const char* env = std::getenv("WEIER_PRECISION")) {
+            std::string s(env);
+            if (s == "fp64") p.arithmetic = Arithmetic::Fp64;
+            if (s == "fp32") p.arithmetic = Arithmetic::Fp32;
+        }
+        if (const char* env = std::getenv("WEIER_SUMMATION")) {
+            std::string s(env);
+            if (s == "plain") p.summation = Summation::Plain;
+            if (s == "kahan") p.summation = Summation::Kahan;
+            if (s == "neumaier") p.summation = Summation::Neumaier;
+            if (s == "pairwise") p.summation = Summation::Pairwise;
+        }
+        if (const char* env = std::getenv("WEIER_REPRODUCIBLE")) {
+            std::string s(env);
+            if (s == "1") p.reproducible = true;
+            if (s == "0") p.reproducible = false;
+        }
+        return p;
+    }
+
+    std::string precision_name(const PrecisionPolicy& precision) {
+        static const char* const sums[] = {"plain", "kahan", "neumaier", "pairwise"};
+        return std::string(precision.arithmetic == Arithmetic::Fp32 ? "fp32" : "fp64") + ", "
+               + sums[static_cast<int>(precision.summation)] + (precision.reproducible ? ", reproducible" : "");
+    }
+
+    std::size_t reproducible_block_count(std::size_t begin, std::size_t end) {
+        if (begin >= end) return 0;
+        return (end + REPRO_BLOCK - 1) / REPRO_BLOCK - begin / REPRO_BLOCK;
+    }
+
+    void weierstrass_block_sums(const WeierstrassPlan& plan, double x0, double h, std::size_t begin, std::size_t end,
+                                std::size_t first, std::size_t last, double* out) {
+        PlanIntegrand f(plan);
+        block_sums(range_sum(f), x0, h, begin, end, first, last, out);
+    }
+
+    double reproducible_tree_sum(const double* sums, std::size_t count) {
+        if (count == 0) return 0.0;
+        if (count == 1) return sums[0];
+        std::size_t left = 1;
+        while (left * 2 < count) left *= 2;
+        return reproducible_tree_sum(sums, left) + reproducible_tree_sum(sums + left, count - left);
+    }
+
+    double weierstrass_midpoint_sum_reproducible(const WeierstrassPlan& plan, double x0, double h,
+                                                 std::size_t begin, std::size_t end) {
+        PlanIntegrand f(plan);
+        return midpoint_sum_reproducible(range_sum(f), x0, h, begin, end);
+    }
+
+    void RunningSum::add(double value) {
+        switch (mode_) {
+            case Summation::Plain:
+                sum_ += value;
+                break;
+            case Summation::Kahan:
+                kahan_step(sum_, comp_, value);
+                break;
+            case Summation::Neumaier:
+                neumaier_step(sum_, comp_, value);
+                break;
+            case Summation::Pairwise: {
+                // Двоичный счётчик листьев: равные по размеру поддеревья сливаются
+                std::size_t level = 0;
+                while (leaves_ >> level & 1) value = levels_[level++] + value;
+                levels_[level] = value;
+                ++leaves_;
+                break;
+            }
+        }
+    }
+
+    void RunningSum::add(const double* values, std::size_t count) {
+        switch (mode_) {
+            case Summation::Plain:
+                for (std::size_t i = 0; i < count; ++i) sum_ += values[i];
+                break;
+            case Summation::Pairwise:
+                if (count > 0) add(pairwise(values, count));
+                break;
+            default: {
+                // Цепочки сливаются в основную сумму; поправки цепочек
+                // имеют тот же смысл, что comp_, и просто прибавляются к нему
+                double s[LANES] = {}, c[LANES] = {};
+                if (mode_ == Summation::Kahan) {
+                    compensated_lanes(values, count, s, c, kahan_step);
+                } else {
+                    compensated_lanes(values, count, s, c, neumaier_step);
+                }
+                for (std::size_t l = 0; l < LANES; ++l) {
+                    add(s[l]);
+                    comp_ += c[l];
+                }
+                break;
+            }
+        }
+    }
+
+    double RunningSum::value() const {
+        if (mode_ == Summation::Kahan) return sum_ - comp_;
+        if (mode_ != Summation::Pairwise) return sum_ + comp_;
+        double total = 0.0;
+        for (std::size_t level = 0; level < 64; ++level) {
+            if (leaves_ >> level & 1) total += levels_[level];
+        }
+        return total;
+    }
+}
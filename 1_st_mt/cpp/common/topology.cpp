@@ -0,0 +1,230 @@
+#include "topology.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#ifdef __linux__
+#include <dirent.h>
+#include <sched.h>
+#endif
+#ifdef WEIER_HWLOC
+#include <hwloc.h>
+#endif
+
+// Топология CPU: какие логические процессоры доступны процессу, к каким
+// ядрам, сокетам и NUMA-узлам они относятся, и закрепление потоков за ними.
+namespace common {
+    namespace {
+#ifdef __linux__
+        // Маска процесса: процессы в cgroup/taskset видят только свои CPU
+        bool allowed_cpus(cpu_set_t& set) {
+            CPU_ZERO(&set);
+            return sched_getaffinity(0, sizeof set, &set) == 0;
+        }
+
+        int read_int(const std::string& path, int fallback) {
+            std::ifstream in(path);
+            int v;
+            return (in >> v) ? v : fallback;
+        }
+
+        // NUMA-узел CPU — ссылка nodeM в каталоге cpuN
+        int sysfs_node(int cpu) {
+            std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+            DIR* d = opendir(dir.c_str());
+            if (!d) return 0;
+            int node = 0;
+            while (dirent* e = readdir(d)) {
+                if (std::strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+                    node = std::atoi(e->d_name + 4);
+                    break;
+                }
+            }
+            closedir(d);
+            return node;
+        }
+
+        bool read_sysfs(std::vector<CpuInfo>& cpus) {
+            cpu_set_t set;
+            if (!allowed_cpus(set)) return false;
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (!CPU_ISSET(cpu, &set)) continue;
+                std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+                cpus.push_back({cpu, read_int(base + "core_id", cpu), read_int(base + "physical_package_id", 0),
+                                sysfs_node(cpu), 0});
+            }
+            return !cpus.empty();
+        }
+#endif
+
+#ifdef WEIER_HWLOC
+        bool read_hwloc(std::vector<CpuInfo>& cpus) {
+            hwloc_topology_t topo;
+            if (hwloc_topology_init(&topo) != 0) return false;
+            if (hwloc_topology_load(topo) != 0) {
+                hwloc_topology_destroy(topo);
+                return false;
+            }
+#ifdef __linux__
+            cpu_set_t set;
+            bool have_mask = allowed_cpus(set);
+#endif
+            int count = hwloc_get_nbobjs_by_type(topo, HWLOC_OBJ_PU);
+            for (int i = 0; i < count; ++i) {
+                hwloc_obj_t pu = hwloc_get_obj_by_type(topo, HWLOC_OBJ_PU, i);
+                int cpu = static_cast<int>(pu->os_index);
+#ifdef __linux__
+                if (have_mask && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &set))) continue;
+#endif
+                hwloc_obj_t core = hwloc_get_ancestor_obj_by_type(topo, HWLOC_OBJ_CORE, pu);
+                hwloc_obj_t package = hwloc_get_ancestor_obj_by_type(topo, HWLOC_OBJ_PACKAGE, pu);
+                int node = pu->nodeset ? hwloc_bitmap_first(pu->nodeset) : 0;
+                cpus.push_back({cpu, core ? static_cast<int>(core->logical_index) : cpu,
+                                package ? static_cast<int>(package->logical_index) : 0, node < 0 ? 0 : node, 0});
+            }
+            hwloc_topology_destroy(topo);
+            return !cpus.empty();
+        }
+#endif
+
+        // Плотная нумерация узлов, индексы SMT внутри ядра и порядок (node, package, core, smt)
+        int normalize(std::vector<CpuInfo>& cpus) {
+            std::map<int, int> nodes;
+            for (const auto& c : cpus) nodes.emplace(c.node, 0);
+            int next = 0;
+            for (auto& kv : nodes) kv.second = next++;
+            for (auto& c : cpus) c.node = nodes[c.node];
+
+            std::sort(cpus.begin(), cpus.end(), [](const CpuInfo& l, const CpuInfo& r) {
+                return std::tie(l.node, l.package, l.core, l.cpu) < std::tie(r.node, r.package, r.core, r.cpu);
+            });
+            for (std::size_t i = 0; i < cpus.size(); ++i) {
+                bool same_core = i > 0 && cpus[i - 1].package == cpus[i].package && cpus[i - 1].core == cpus[i].core
+                                 && cpus[i - 1].node == cpus[i].node;
+                cpus[i].smt = same_core ? cpus[i - 1].smt + 1 : 0;
+            }
+            return next;
+        }
+    }
+
+    Placement parse_placement(const char* name, Placement fallback) {
+        if (!name) return fallback;
+        std::string s(name);
+        if (s == "none") return Placement::None;
+        if (s == "cores") return Placement::Cores;
+        if (s == "all") return Placement::All;
+        return fallback;
+    }
+
+    const char* placement_name(Placement placement) {
+        switch (placement) {
+            case Placement::Cores: return "cores";
+            case Placement::All: return "all";
+            default: return "none";
+        }
+    }
+
+    Placement default_placement() {
+        return parse_placement(std::getenv("WEIER_PLACEMENT"), Placement::None);
+    }
+
+    Topology::Topology() {
+#ifdef WEIER_HWLOC
+        if (read_hwloc(cpus_)) source_ = "hwloc";
+#endif
+#ifdef __linux__
+        if (cpus_.empty() && read_sysfs(cpus_)) source_ = "sysfs";
+#endif
+        if (cpus_.empty()) {
+            // Топология неизвестна: считаем каждый аппаратный поток отдельным ядром
+            unsigned hw = std::max(1u, std::thread::hardware_concurrency());
+            for (unsigned i = 0; i < hw; ++i) cpus_.push_back({static_cast<int>(i), static_cast<int>(i), 0, 0, 0});
+        }
+        nodes_ = normalize(cpus_);
+    }
+
+    const Topology& Topology::system() {
+        static const Topology topo;
+        return topo;
+    }
+
+    unsigned Topology::capacity(Placement placement) const {
+        if (placement != Placement::Cores) return static_cast<unsigned>(cpus_.size());
+        return static_cast<unsigned>(std::count_if(cpus_.begin(), cpus_.end(),
+                                                   [](const CpuInfo& c) { return c.smt == 0; }));
+    }
+
+    std::vector<CpuInfo> Topology::assign(Placement placement, unsigned threads, unsigned first) const {
+        if (placement == Placement::None || threads == 0) return {};
+        // Сначала первые потоки всех ядер, затем вторые и т.д.: соседние по SMT
+        // потоки делят конвейер и включаются только при нехватке ядер
+        std::vector<CpuInfo> order;
+        int max_smt = placement == Placement::Cores ? 0 : 1 << 30;
+        for (int level = 0; level <= max_smt; ++level) {
+            std::size_t before = order.size();
+            for (const auto& c : cpus_) if (c.smt == level) order.push_back(c);
+            if (order.size() == before) break;
+        }
+        std::vector<CpuInfo> out(threads);
+        for (unsigned t = 0; t < threads; ++t) out[t] = order[(first + t) % order.size()];
+        // Потоки одного узла идут подряд: частичные суммы по узлам остаются локальными
+        std::stable_sort(out.begin(), out.end(), [](const CpuInfo& l, const CpuInfo& r) { return l.node < r.node; });
+        return out;
+    }
+
+#ifdef __linux__
+    bool pin_current_thread(int cpu) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof set, &set) == 0;
+    }
+
+    ScopedPin::ScopedPin(int cpu) {
+        if (cpu < 0) return;
+        cpu_set_t old;
+        if (sched_getaffinity(0, sizeof old, &old) != 0 || !pin_current_thread(cpu)) return;
+        saved_.resize(sizeof old);
+        std::memcpy(saved_.data(), &old, sizeof old);
+    }
+
+    ScopedPin::~ScopedPin() {
+        if (saved_.empty()) return;
+        cpu_set_t old;
+        std::memcpy(&old, saved_.data(), sizeof old);
+        sched_setaffinity(0, sizeof old, &old);
+    }
+#else
+    bool pin_current_thread(int) { return false; }
+    ScopedPin::ScopedPin(int) {}
+    ScopedPin::~ScopedPin() {}
+#endif
+
+    std::string describe_placement(Placement placement, unsigned threads, const std::vector<CpuInfo>& assigned) {
+        const Topology& topo = Topology::system();
+        std::ostringstream out;
+        out << placement_name(placement) << ", " << threads << " threads";
+        if (assigned.empty()) {
+            out << " unpinned";
+        } else {
+            int node = -1;
+            for (std::size_t i = 0; i < assigned.size(); ++i) {
+                if (assigned[i].node != node) {
+                    node = assigned[i].node;
+                    out << (i == 0 ? ": " : "; ") << "node " << node << " cpus ";
+                } else {
+                    out << ",";
+                }
+                out << assigned[i].cpu;
+            }
+        }
+        out << " (" << topo.source() << ": " << topo.cpus().size() << " cpus, " << topo.capacity(Placement::Cores)
+            << " cores, " << topo.nodes() << " nodes)";
+        return out.str();
+    }
+}
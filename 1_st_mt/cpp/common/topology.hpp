@@ -0,0 +1,72 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// CPU topology and thread placement for the threaded backends
+namespace common {
+    // One logical CPU the process may run on
+    struct CpuInfo {
+        int cpu;       // OS index, as used by sched_setaffinity
+        int core;      // physical core id within the package
+        int package;   // socket
+        int node;      // NUMA node, numbered densely from 0
+        int smt;       // index among the SMT siblings of the core, 0 for the first
+    };
+
+    // None leaves threads to the OS scheduler; Cores pins one thread per
+    // physical core; All pins to every SMT sibling, first siblings first
+    enum class Placement { None, Cores, All };
+
+    // Parses "none" / "cores" / "all"; anything else gives fallback
+    Placement parse_placement(const char* name, Placement fallback);
+    const char* placement_name(Placement placement);
+
+    // WEIER_PLACEMENT from the environment, Placement::None if unset
+    Placement default_placement();
+
+    class Topology {
+    public:
+        // Read once: hwloc when built with it, else /sys/devices/system/cpu.
+        // Only CPUs in the process affinity mask are listed.
+        static const Topology& system();
+
+        const std::vector<CpuInfo>& cpus() const { return cpus_; }
+        int nodes() const { return nodes_; }
+        const char* source() const { return source_; }
+
+        // CPU for each of `threads` workers, ordered by (node, package, core);
+        // wraps around when there are more threads than CPUs. Empty for None.
+        // The workers take slots [first, first + threads) of the order, so
+        // processes sharing one mask can ask for disjoint CPUs.
+        std::vector<CpuInfo> assign(Placement placement, unsigned threads, unsigned first = 0) const;
+
+        // Hardware threads the placement can use without oversubscription
+        unsigned capacity(Placement placement) const;
+
+    private:
+        Topology();
+
+        std::vector<CpuInfo> cpus_;   // sorted by (node, package, core, smt)
+        int nodes_ = 1;
+        const char* source_ = "none";
+    };
+
+    // Pins the calling thread to one CPU; false if the OS refused
+    bool pin_current_thread(int cpu);
+
+    // Pins the calling thread for the lifetime of the object, then restores
+    // its previous affinity mask. cpu < 0 does nothing.
+    class ScopedPin {
+    public:
+        explicit ScopedPin(int cpu);
+        ~ScopedPin();
+        ScopedPin(const ScopedPin&) = delete;
+        ScopedPin& operator=(const ScopedPin&) = delete;
+
+    private:
+        std::vector<unsigned char> saved_;   // previous mask, empty if not pinned
+    };
+
+    // e.g. "cores, 4 threads: node 0 cpus 0,2; node 1 cpus 8,10 (sysfs)"
+    std::string describe_placement(Placement placement, unsigned threads, const std::vector<CpuInfo>& assigned);
+}
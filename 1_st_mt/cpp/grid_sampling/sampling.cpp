@@ -0,0 +1,177 @@
+#include "sampling.hpp"
+#include "../common/common.hpp"
+#include "../common/mapped_file.hpp"
+#include "../integral_parallel/thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <new>
+
+// Значения функции Вейерштрасса на равномерной сетке: пул потоков пишет
+// блоками из целых страниц прямо в отображённый файл или в буфер вызывающего
+namespace grid_sampling {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        constexpr char MAGIC[8] = {'W', 'E', 'I', 'E', 'R', 'G', 'R', 'D'};
+
+        // Точек double на страницу
+        std::size_t page_points() { return std::max<std::size_t>(common::MappedFile::page_size() / sizeof(double), 1); }
+
+        std::size_t round_up(std::size_t v, std::size_t m) { return (v + m - 1) / m * m; }
+
+        // Буфер окна потока: выровнен на страницу, как отображение файла
+        struct PageDelete {
+            std::size_t align;
+            void operator()(double* p) const { ::operator delete[](p, std::align_val_t(align)); }
+        };
+        using PageBuffer = std::unique_ptr<double[], PageDelete>;
+
+        PageBuffer page_buffer(std::size_t points) {
+            std::size_t align = common::MappedFile::page_size();
+            std::size_t bytes = round_up(std::max<std::size_t>(points, 1), page_points()) * sizeof(double);
+            return PageBuffer(static_cast<double*>(::operator new[](bytes, std::align_val_t(align))), PageDelete{align});
+        }
+
+        // Точки [first, first + count) в out: задача — block точек. Отображение файла
+        // и окно потока выровнены на страницу, и границы задач совпадают с границами
+        // страниц; буфер вызывающего — только если он сам выровнен
+        void fill(const common::WeierstrassPlan& plan, SampleKernel kernel, double x0, double h, std::size_t first,
+                  std::size_t count, double* out, std::size_t block, integral_parallel::ThreadPool& pool) {
+            pool.run((count + block - 1) / block, [&](std::size_t task, unsigned) {
+                std::size_t lo = task * block;
+                std::size_t hi = std::min(lo + block, count);
+                if (kernel == SampleKernel::Scalar) {
+                    for (std::size_t i = lo; i < hi; ++i) out[i] = plan(x0 + h * static_cast<double>(first + i));
+                    return;
+                }
+                double xs[common::BATCH_BLOCK];
+                for (std::size_t i = lo; i < hi; i += common::BATCH_BLOCK) {
+                    std::size_t m = std::min(common::BATCH_BLOCK, hi - i);
+                    for (std::size_t j = 0; j < m; ++j) xs[j] = x0 + h * static_cast<double>(first + i + j);
+                    common::weierstrass_batch(plan, xs, out + i, m);
+                }
+            });
+        }
+
+        SampleHeader make_header(const common::WeierstrassPlan& plan, double x0, double h, std::size_t count,
+                                 SampleKernel kernel) {
+            SampleHeader header{};
+            std::memcpy(header.magic, MAGIC, sizeof MAGIC);
+            header.version = SAMPLE_VERSION;
+            header.kernel = static_cast<std::uint32_t>(kernel);
+            header.data_offset = std::max(common::MappedFile::page_size(), sizeof(SampleHeader));
+            header.count = count;
+            header.n = plan.n();
+            header.a = plan.a();
+            header.b = plan.b();
+            header.x0 = x0;
+            header.h = h;
+            return header;
+        }
+
+        void finish(SampleStats& stats, Clock::time_point start) {
+            stats.bytes = stats.points * sizeof(double);
+            stats.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            stats.gb_per_second = stats.seconds > 0.0 ? static_cast<double>(stats.bytes) / stats.seconds / 1e9 : 0.0;
+        }
+    }
+
+    double grid_step(double x0, double x1, std::size_t count) {
+        return count < 2 ? 0.0 : (x1 - x0) / static_cast<double>(count - 1);
+    }
+
+    SampleStats sample_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                   double* out, integral_parallel::ThreadPool& pool, const SampleOptions& options) {
+        auto start = Clock::now();
+        SampleStats stats;
+        std::size_t block = round_up(std::max<std::size_t>(options.block, 1), page_points());
+        fill(plan, options.kernel, x0, grid_step(x0, x1, count), 0, count, out, block, pool);
+        stats.points = count;
+        stats.windows = 1;
+        finish(stats, start);
+        return stats;
+    }
+
+    // Целиком: одно отображение с заголовком. Окнами: заголовок через pwrite,
+    // затем окно за окном отображается, заполняется, синхронизируется и снимается
+    SampleStats sample_weierstrass_file(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                        const std::string& path, integral_parallel::ThreadPool& pool,
+                                        const SampleOptions& options) {
+        auto start = Clock::now();
+        SampleStats stats;
+        double h = grid_step(x0, x1, count);
+        SampleHeader header = make_header(plan, x0, h, count, options.kernel);
+        std::size_t offset = header.data_offset;
+        std::size_t block = round_up(std::max<std::size_t>(options.block, 1), page_points());
+
+        common::MappedFile file;
+        if (options.window == 0) {
+            stats.error = file.create(path, offset + count * sizeof(double));
+            if (!stats.error.empty()) return stats;
+            stats.huge_pages = options.huge_pages && file.advise_huge_pages();
+            std::memcpy(file.data(), &header, sizeof header);
+            double* out = reinterpret_cast<double*>(static_cast<char*>(file.data()) + offset);
+            fill(plan, options.kernel, x0, h, 0, count, out, block, pool);
+            stats.error = file.sync();
+            stats.points = count;
+            stats.windows = 1;
+            finish(stats, start);
+            return stats;
+        }
+
+        stats.error = file.open(path, offset + count * sizeof(double));
+        if (stats.error.empty()) stats.error = file.write(0, &header, sizeof header);
+        std::size_t window = round_up(options.window, page_points());
+        stats.huge_pages = options.huge_pages && count > 0;
+        for (std::size_t lo = 0; lo < count && stats.error.empty(); lo += window) {
+            std::size_t m = std::min(window, count - lo);
+            stats.error = file.map(offset + lo * sizeof(double), m * sizeof(double));
+            if (!stats.error.empty()) break;
+            if (options.huge_pages && !file.advise_huge_pages()) stats.huge_pages = false;
+            fill(plan, options.kernel, x0, h, lo, m, static_cast<double*>(file.data()), block, pool);
+            // Грязные страницы окна уходят на диск до следующего окна
+            stats.error = file.sync();
+            file.unmap();
+            stats.points += m;
+            ++stats.windows;
+        }
+        finish(stats, start);
+        return stats;
+    }
+
+    SampleStats sample_weierstrass_stream(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                          const SampleSink& sink, integral_parallel::ThreadPool& pool,
+                                          const SampleOptions& options) {
+        auto start = Clock::now();
+        SampleStats stats;
+        double h = grid_step(x0, x1, count);
+        std::size_t block = round_up(std::max<std::size_t>(options.block, 1), page_points());
+        std::size_t window = round_up(options.window == 0 ? DEFAULT_WINDOW : options.window, page_points());
+        PageBuffer buffer = page_buffer(std::min(window, count));
+        for (std::size_t lo = 0; lo < count; lo += window) {
+            std::size_t m = std::min(window, count - lo);
+            fill(plan, options.kernel, x0, h, lo, m, buffer.get(), block, pool);
+            stats.points += m;
+            ++stats.windows;
+            if (!sink(buffer.get(), lo, m)) break;
+        }
+        finish(stats, start);
+        return stats;
+    }
+
+    std::string read_sample_header(const std::string& path, SampleHeader& header) {
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in) return "cannot open " + path;
+        std::streamoff size = in.tellg();
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof header)) return path + ": no sample header";
+        if (std::memcmp(header.magic, MAGIC, sizeof MAGIC) != 0) return path + ": not a sample file";
+        if (header.version != SAMPLE_VERSION) return path + ": unknown sample file version";
+        if (static_cast<std::uint64_t>(size) != header.data_offset + header.count * sizeof(double))
+            return path + ": size does not match the header";
+        return "";
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace common { class WeierstrassPlan; }
+namespace integral_parallel { class ThreadPool; }
+
+namespace grid_sampling {
+    // How sample values are computed:
+    //  Scalar — WeierstrassPlan::operator(), bit-identical to common::weierstrass
+    //           for plans with Reduction::Standard;
+    //  Batch  — common::weierstrass_batch (SIMD kernel), within ~1e-14 of it.
+    enum class SampleKernel : std::uint32_t { Scalar = 0, Batch = 1 };
+
+    // Sample files: this header at offset 0, then count doubles in native byte
+    // order from data_offset (one page, so samples start page-aligned). Sample i
+    // is W(x0 + h * i), with the argument computed in double exactly so.
+    struct SampleHeader {
+        char magic[8];                  // "WEIERGRD"
+        std::uint32_t version;          // SAMPLE_VERSION
+        std::uint32_t kernel;           // SampleKernel of the values
+        std::uint64_t data_offset;
+        std::uint64_t count;
+        std::uint64_t n;
+        double a, b, x0, h;
+    };
+    static constexpr std::uint32_t SAMPLE_VERSION = 1;
+
+    struct SampleOptions {
+        SampleKernel kernel = SampleKernel::Scalar;
+        // Points per pool task, rounded up to whole pages of doubles, so no two
+        // workers write to the same page. That holds for files and stream
+        // windows, which start on a page; the buffer of sample_weierstrass gets
+        // it only when the caller page-aligns it.
+        std::size_t block = std::size_t(1) << 16;
+        // Streaming: points per window, rounded up to whole pages. Files are
+        // mapped, filled and synced one window at a time, and the sink variant
+        // reuses one page-aligned window buffer, so memory stays at about window * 8 bytes.
+        // 0: files are mapped whole, sinks get windows of DEFAULT_WINDOW.
+        std::size_t window = 0;
+        // madvise(MADV_HUGEPAGE) on every mapping
+        bool huge_pages = true;
+    };
+    static constexpr std::size_t DEFAULT_WINDOW = std::size_t(1) << 20;
+
+    struct SampleStats {
+        std::size_t points = 0;
+        std::size_t bytes = 0;          // sample bytes, without the header
+        std::size_t windows = 0;
+        double seconds = 0.0;           // evaluation, writes and msync
+        double gb_per_second = 0.0;     // bytes / seconds / 1e9
+        bool huge_pages = false;        // the hint was accepted for every mapping
+        std::string error;              // empty on success
+    };
+
+    // Grid step with both ends sampled: (x1 - x0) / (count - 1), 0 for count < 2
+    double grid_step(double x0, double x1, std::size_t count);
+
+    // out[i] = W(x0 + h * i), i < count, filled in parallel on the pool
+    SampleStats sample_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                   double* out, integral_parallel::ThreadPool& pool,
+                                   const SampleOptions& options = SampleOptions());
+    // The same grid into path (created or truncated) with a SampleHeader,
+    // written straight into the file's mapping
+    SampleStats sample_weierstrass_file(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                        const std::string& path, integral_parallel::ThreadPool& pool,
+                                        const SampleOptions& options = SampleOptions());
+
+    // Receives window after window: values of samples [first, first + count);
+    // false stops the run
+    using SampleSink = std::function<bool(const double* values, std::size_t first, std::size_t count)>;
+    SampleStats sample_weierstrass_stream(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                          const SampleSink& sink, integral_parallel::ThreadPool& pool,
+                                          const SampleOptions& options = SampleOptions());
+
+    // Reads the header of a sample file and checks magic, version and size
+    std::string read_sample_header(const std::string& path, SampleHeader& header);
+}
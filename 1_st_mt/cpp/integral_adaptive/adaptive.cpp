@@ -0,0 +1,224 @@
+#include "adaptive.hpp"
+#include "../common/common.hpp"
+#include "../integral_parallel/thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// Адаптивная квадратура Гаусса–Кронрода для функции Вейерштрасса.
+// На отрезке слагаемые с большой частотой интегрируются точно (правило Филона
+// для постоянной амплитуды), гладкий остаток — парой G7/K15; отрезок с
+// оценкой ошибки больше своей доли допуска делится пополам.
+namespace integral_adaptive {
+    namespace {
+        // Узлы и веса K15 и вложенной G7 (QUADPACK qk15): xgk[1], xgk[3], xgk[5], xgk[7] — узлы G7
+        constexpr double XGK[8] = {
+            0.991455371120812639206854697526329, 0.949107912342758524526189684047851,
+            0.864864423359769072789712788640926, 0.741531185599394439863864773280788,
+            0.586087235467691130294144845693013, 0.405845151377397166906606412076961,
+            0.207784955007898467600689403773245, 0.000000000000000000000000000000000};
+        constexpr double WGK[8] = {
+            0.022935322010529224963732008058970, 0.063092092629978553290700663189204,
+            0.104790010322250183839876322541518, 0.140653259715525918745189590510238,
+            0.169004726639267902826583426598550, 0.190350578064785409913256402421014,
+            0.204432940075298892414161999234649, 0.209482141084727828012999174891714};
+        constexpr double WG[4] = {
+            0.129484966168869693270611432679082, 0.279705391489276667901467771423780,
+            0.381830050505118944950369775488975, 0.417959183673469387755102040816327};
+
+        struct Panel {
+            double a, b;
+            unsigned depth;
+        };
+
+        // Принятый отрезок
+        struct PanelSum {
+            double a;
+            double value;
+            double error;
+        };
+
+        // Общие для всех исполнителей параметры и счётчики
+        struct Context {
+            const common::WeierstrassPlan& plan;
+            const AdaptiveOptions& options;
+            double tol_per_width;               // допуск на единицу ширины
+            std::atomic<std::size_t> evaluations{0};
+            std::atomic<std::size_t> filon_terms{0};
+            std::atomic<bool> forced{false};    // отрезок принят по бюджету
+        };
+
+        bool use_filon(const Context& ctx, double freq, double width) {
+            return ctx.options.filon && std::fabs(freq) * width >= ctx.options.filon_cutoff;
+        }
+
+        // Значение на отрезке: точные интегралы быстрых слагаемых плюс K15 остатка, ошибка |K15 - G7|
+        void evaluate(Context& ctx, const Panel& p, double& value, double& error) {
+            const common::WeierstrassPlan& plan = ctx.plan;
+            double c = 0.5 * (p.a + p.b), r = 0.5 * (p.b - p.a), w = p.b - p.a;
+            std::size_t smooth = 0, filon = 0;
+            double closed = 0.0;
+            for (std::size_t k = 0; k < plan.n(); ++k) {
+                double f = plan.freq()[k];
+                if (!use_filon(ctx, f, w)) {
+                    ++smooth;
+                    continue;
+                }
+                // sin(f*b) - sin(f*a) = 2 cos(f*c) sin(f*r) — без вычитания близких чисел
+                closed += plan.amp()[k] * 2.0 * std::cos(f * c) * std::sin(f * r) / f;
+                ++filon;
+            }
+            ctx.filon_terms += filon;
+            value = closed;
+            error = 0.0;
+            if (smooth == 0) return;
+
+            auto f = [&](double x) {
+                double s = 0.0;
+                for (std::size_t k = 0; k < plan.n(); ++k) {
+                    double fr = plan.freq()[k];
+                    if (!use_filon(ctx, fr, w)) s += plan.amp()[k] * std::cos(fr * x);
+                }
+                return s;
+            };
+            double centre = f(c);
+            double kronrod = WGK[7] * centre, gauss = WG[3] * centre;
+            for (int j = 0; j < 7; ++j) {
+                double sum = f(c - r * XGK[j]) + f(c + r * XGK[j]);
+                kronrod += WGK[j] * sum;
+                if (j % 2 == 1) gauss += WG[j / 2] * sum;
+            }
+            ctx.evaluations += 15;
+            value += kronrod * r;
+            error = std::fabs((kronrod - gauss) * r);
+        }
+
+        // Отрезок принимается, если укладывается в свою долю допуска; иначе его
+        // половины возвращаются в очередь. Бюджет (глубина, число точек) принимает
+        // отрезок принудительно
+        bool settle(Context& ctx, const Panel& p, std::vector<PanelSum>& accepted, Panel* halves) {
+            double value, error;
+            evaluate(ctx, p, value, error);
+            double mid = 0.5 * (p.a + p.b);
+            bool fits = error <= ctx.tol_per_width * (p.b - p.a);
+            bool exhausted = p.depth >= ctx.options.max_depth || mid <= p.a || mid >= p.b ||
+                             ctx.evaluations.load(std::memory_order_relaxed) >= ctx.options.max_evaluations;
+            if (fits || exhausted) {
+                if (!fits) ctx.forced = true;
+                accepted.push_back(PanelSum{p.a, value, error});
+                return false;
+            }
+            halves[0] = Panel{p.a, mid, p.depth + 1};
+            halves[1] = Panel{mid, p.b, p.depth + 1};
+            return true;
+        }
+
+        // Допуск из оценки интеграла по всему отрезку
+        void set_tolerance(Context& ctx, double x0, double x1) {
+            double value, error;
+            Context probe{ctx.plan, ctx.options, 0.0};
+            evaluate(probe, Panel{x0, x1, 0}, value, error);
+            double tol = std::max(ctx.options.abs_tol, ctx.options.rel_tol * std::fabs(value));
+            ctx.tol_per_width = tol / std::fabs(x1 - x0);
+        }
+
+        AdaptiveResult finish(Context& ctx, std::vector<PanelSum>& accepted) {
+            // Сумма по порядку отрезков не зависит от порядка их обработки
+            std::sort(accepted.begin(), accepted.end(), [](const PanelSum& l, const PanelSum& r) { return l.a < r.a; });
+            AdaptiveResult result;
+            common::RunningSum total(ctx.plan.precision().summation);
+            for (const PanelSum& p : accepted) {
+                total.add(p.value);
+                result.error += p.error;
+            }
+            result.value = total.value();
+            result.evaluations = ctx.evaluations;
+            result.filon_terms = ctx.filon_terms;
+            result.panels = accepted.size();
+            result.converged = !ctx.forced;
+            return result;
+        }
+
+        // Отрезки всегда идут слева направо; x1 < x0 меняет знак результата
+        AdaptiveResult reversed(AdaptiveResult result) {
+            result.value = -result.value;
+            return result;
+        }
+
+        // Общая очередь открытых отрезков: работа кончается, когда очередь пуста
+        // и ни один исполнитель не держит отрезок
+        class PanelQueue {
+        public:
+            explicit PanelQueue(const Panel& root) : open_{root} {}
+
+            bool pop(Panel& p) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [&] { return !open_.empty() || busy_ == 0; });
+                if (open_.empty()) return false;
+                p = open_.back();
+                open_.pop_back();
+                ++busy_;
+                return true;
+            }
+
+            void done(const Panel* halves, std::size_t count) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    open_.insert(open_.end(), halves, halves + count);
+                    --busy_;
+                }
+                ready_.notify_all();
+            }
+
+        private:
+            std::mutex mutex_;
+            std::condition_variable ready_;
+            std::vector<Panel> open_;   // стек: обход в глубину держит очередь короткой
+            std::size_t busy_ = 0;
+        };
+    }
+
+    AdaptiveResult integrate_weierstrass_adaptive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                  const AdaptiveOptions& options) {
+        if (x0 == x1) return AdaptiveResult{0.0, 0.0, 0, 0, 0, true};
+        if (x1 < x0) return reversed(integrate_weierstrass_adaptive(plan, x1, x0, options));
+        Context ctx{plan, options, 0.0};
+        set_tolerance(ctx, x0, x1);
+        std::vector<PanelSum> accepted;
+        std::vector<Panel> open{Panel{x0, x1, 0}};
+        Panel halves[2];
+        while (!open.empty()) {
+            Panel p = open.back();
+            open.pop_back();
+            if (settle(ctx, p, accepted, halves)) {
+                open.push_back(halves[1]);
+                open.push_back(halves[0]);
+            }
+        }
+        return finish(ctx, accepted);
+    }
+
+    AdaptiveResult integrate_weierstrass_adaptive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                  const AdaptiveOptions& options, integral_parallel::ThreadPool& pool) {
+        if (x0 == x1) return AdaptiveResult{0.0, 0.0, 0, 0, 0, true};
+        if (x1 < x0) return reversed(integrate_weierstrass_adaptive(plan, x1, x0, options, pool));
+        Context ctx{plan, options, 0.0};
+        set_tolerance(ctx, x0, x1);
+        PanelQueue queue(Panel{x0, x1, 0});
+        std::vector<std::vector<PanelSum>> accepted(pool.size());
+        // По задаче на исполнителя: каждая крутит цикл над общей очередью
+        pool.run(pool.size(), [&](std::size_t, unsigned worker) {
+            Panel p, halves[2];
+            while (queue.pop(p)) {
+                bool split = settle(ctx, p, accepted[worker], halves);
+                queue.done(halves, split ? 2 : 0);
+            }
+        });
+        std::vector<PanelSum> all;
+        for (auto& part : accepted) all.insert(all.end(), part.begin(), part.end());
+        return finish(ctx, all);
+    }
+}
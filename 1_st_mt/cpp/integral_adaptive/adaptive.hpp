@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+
+namespace common { class WeierstrassPlan; }
+namespace integral_parallel { class ThreadPool; }
+
+namespace integral_adaptive {
+    struct AdaptiveOptions {
+        // Target: |error| <= max(abs_tol, rel_tol * |I|), with I estimated on the
+        // whole interval. A panel of width w is accepted once its estimate is
+        // within that target times w / (x1 - x0), so the panel set does not
+        // depend on the order in which panels are processed.
+        double abs_tol = 1e-10;
+        double rel_tol = 0.0;
+        // Terms with |PI * b^k| * w >= filon_cutoff on a panel are integrated in
+        // closed form, a^k * (sin(PI*b^k*x1) - sin(PI*b^k*x0)) / (PI*b^k): a
+        // Filon rule, exact because the amplitude of every cos term is constant.
+        // The remaining, smooth part goes through the Gauss–Kronrod pair.
+        bool filon = true;
+        double filon_cutoff = 8.0;
+        // Budget: panels still open when the Kronrod points reach max_evaluations,
+        // or after max_depth halvings, are accepted as they are
+        std::size_t max_evaluations = std::size_t(1) << 24;
+        unsigned max_depth = 50;
+    };
+
+    struct AdaptiveResult {
+        double value = 0.0;
+        double error = 0.0;             // sum of the panels' |K15 - G7|
+        std::size_t evaluations = 0;    // integrand points (15 per Kronrod panel)
+        std::size_t panels = 0;         // accepted subintervals
+        std::size_t filon_terms = 0;    // term integrals taken in closed form
+        bool converged = false;         // no panel was accepted by the budget
+    };
+
+    // Adaptive Gauss–Kronrod (G7/K15) quadrature with Filon handling of the
+    // fast cos terms. Panels are summed in order of position with the plan's
+    // summation mode, so converged results are the same on one thread and on
+    // the pool. Reduction::Exact and Arithmetic::Fp32 are not used here.
+    AdaptiveResult integrate_weierstrass_adaptive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                  const AdaptiveOptions& options = AdaptiveOptions());
+    // Same on the pool: workers share one queue of open panels, take a panel,
+    // accept it or push both halves back
+    AdaptiveResult integrate_weierstrass_adaptive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                  const AdaptiveOptions& options, integral_parallel::ThreadPool& pool);
+}
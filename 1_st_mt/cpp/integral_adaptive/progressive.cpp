@@ -0,0 +1,98 @@
+#include "progressive.hpp"
+#include "../common/common.hpp"
+#include "../integral_parallel/parallel.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Прогрессивное уточнение: сетка средних точек утраивается, старые точки
+// остаются средними точками новой сетки, поэтому на этапе считаются только
+// новые две трети. Между этапами — экстраполяция Ричардсона.
+namespace integral_adaptive {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        // Сумма значений в точках x0 + h*(i + 0.5), i < steps, без множителя h
+        using RangeSum = std::function<double(double x0, double h, std::size_t steps)>;
+
+        ProgressiveResult progressive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                      const ProgressiveOptions& options, const ProgressCallback& callback,
+                                      const RangeSum& range_sum) {
+            auto start = Clock::now();
+            ProgressiveResult result;
+            std::size_t steps = std::max<std::size_t>(options.initial_steps, 1);
+            double h = (x1 - x0) / static_cast<double>(steps);
+            common::RunningSum total(plan.precision().summation);
+            total.add(range_sum(x0, h, steps));
+
+            // Строка таблицы Ричардсона: row[j] — j раз экстраполированное значение
+            std::vector<double> row;
+            double previous = 0.0;
+            for (unsigned stage = 0;; ++stage) {
+                if (stage > 0) {
+                    // Новые точки x0 + h*(i + 1/6) и x0 + h*(i + 5/6) — сетки средних
+                    // точек с тем же h, сдвинутые на -h/3 и +h/3
+                    total.add(range_sum(x0 - h / 3.0, h, steps));
+                    total.add(range_sum(x0 + h / 3.0, h, steps));
+                    steps *= 3;
+                    h = (x1 - x0) / static_cast<double>(steps);
+                }
+                double midpoint = total.value() * h;
+
+                // Ошибка правила средних — ряд по h^2, h^4, ...; шаг уменьшается втрое,
+                // поэтому множители 9^j - 1
+                double carry = midpoint;
+                double factor = 1.0;
+                for (std::size_t j = 0; j < row.size(); ++j) {
+                    double old = row[j];
+                    row[j] = carry;
+                    factor *= 9.0;
+                    carry += (carry - old) / (factor - 1.0);
+                }
+                row.push_back(carry);
+
+                ProgressiveStage info;
+                info.stage = stage;
+                info.steps = steps;
+                info.evaluations = steps;
+                info.midpoint = midpoint;
+                info.estimate = options.extrapolate ? row.back() : midpoint;
+                info.change = stage == 0 ? std::numeric_limits<double>::infinity()
+                                         : std::fabs(info.estimate - previous);
+                info.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+                previous = info.estimate;
+
+                result.value = info.estimate;
+                result.change = info.change;
+                result.steps = steps;
+                result.evaluations = steps;
+                result.stages = stage + 1;
+                double tol = std::max(options.abs_tol, options.rel_tol * std::fabs(info.estimate));
+                result.converged = stage + 1 >= options.min_stages && info.change <= tol;
+
+                bool go_on = !callback || callback(info);
+                if (result.converged || !go_on || steps > options.max_steps / 3) break;
+            }
+            return result;
+        }
+    }
+
+    ProgressiveResult integrate_weierstrass_progressive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                        const ProgressiveOptions& options,
+                                                        const ProgressCallback& callback) {
+        return progressive(plan, x0, x1, options, callback, [&](double from, double h, std::size_t steps) {
+            return common::weierstrass_midpoint_sum_rotation(plan, from, h, 0, steps);
+        });
+    }
+
+    ProgressiveResult integrate_weierstrass_progressive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                        const ProgressiveOptions& options,
+                                                        integral_parallel::ThreadPool& pool,
+                                                        const ProgressCallback& callback) {
+        return progressive(plan, x0, x1, options, callback, [&](double from, double h, std::size_t steps) {
+            return integral_parallel::sum_weierstrass_range(plan, from, h, 0, steps, pool);
+        });
+    }
+}
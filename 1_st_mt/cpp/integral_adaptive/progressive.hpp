@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+namespace common { class WeierstrassPlan; }
+namespace integral_parallel { class ThreadPool; }
+
+namespace integral_adaptive {
+    struct ProgressiveOptions {
+        // Midpoint steps of the first stage; every stage triples them, so the old
+        // midpoints stay on the new grid and only 2/3 of its points are new.
+        // For integer b a step count with no factor 2, 3 or 5 keeps b^k * h off
+        // whole periods of the high terms (aliasing).
+        std::size_t initial_steps = 1001;
+        std::size_t max_steps = std::size_t(1) << 34;
+        // Stop once two successive estimates differ by at most
+        // max(abs_tol, rel_tol * |estimate|), but not before min_stages
+        double abs_tol = 1e-10;
+        double rel_tol = 0.0;
+        unsigned min_stages = 3;
+        // Richardson extrapolation over the stages (error series in h^2, h^4, ...
+        // with ratio 3); off: the estimate is the plain midpoint sum
+        bool extrapolate = true;
+    };
+
+    // One stage, as passed to the callback
+    struct ProgressiveStage {
+        unsigned stage = 0;
+        std::size_t steps = 0;          // grid of this stage
+        std::size_t evaluations = 0;    // points evaluated so far, equal to steps
+        double midpoint = 0.0;          // midpoint rule on this grid
+        double estimate = 0.0;          // extrapolated (or midpoint) value
+        double change = 0.0;            // |estimate - previous estimate|, infinity at stage 0
+        double seconds = 0.0;           // since the call started
+    };
+
+    struct ProgressiveResult {
+        double value = 0.0;
+        double change = 0.0;            // last |estimate - previous estimate|
+        std::size_t steps = 0;
+        std::size_t evaluations = 0;
+        unsigned stages = 0;
+        bool converged = false;         // stopped by the tolerance
+    };
+
+    // Return false to stop after this stage
+    using ProgressCallback = std::function<bool(const ProgressiveStage&)>;
+
+    // Midpoint rule refined by tripling: stage s adds the points at x0 + h*(i + 1/6)
+    // and x0 + h*(i + 5/6) of the previous grid h to the running sum, so the
+    // total cost is that of the last grid alone. Keeps only the running sum and
+    // one row of the Richardson table. Point values agree with a direct run on
+    // the final grid up to the rounding of x; reproducible plans are summed
+    // stage by stage, not in REPRO_BLOCK blocks.
+    ProgressiveResult integrate_weierstrass_progressive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                        const ProgressiveOptions& options = ProgressiveOptions(),
+                                                        const ProgressCallback& callback = ProgressCallback());
+    // Same, each stage's new points summed on the pool
+    ProgressiveResult integrate_weierstrass_progressive(const common::WeierstrassPlan& plan, double x0, double x1,
+                                                        const ProgressiveOptions& options,
+                                                        integral_parallel::ThreadPool& pool,
+                                                        const ProgressCallback& callback = ProgressCallback());
+}
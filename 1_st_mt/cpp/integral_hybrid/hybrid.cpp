@@ -0,0 +1,152 @@
+#include "hybrid.hpp"
+#include "../common/common.hpp"
+#include "../integral_parallel/parallel.hpp"
+#include "../integral_parallel/thread_pool.hpp"
+#ifdef ENABLE_OPENCL
+#include "../integral_opencl/opencl_impl.hpp"
+#endif
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// Совместное вычисление одного интеграла на устройстве (OpenCL) и на пуле потоков CPU.
+// Диапазон [0, steps) раздаётся кусками из общего курсора; размер куска каждой
+// стороны подстраивается под её измеренную скорость.
+namespace integral_hybrid {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        // Вес нового замера в скользящей оценке скорости
+        constexpr double RATE_SMOOTHING = 0.5;
+
+        double seconds_since(Clock::time_point t) {
+            return std::chrono::duration<double>(Clock::now() - t).count();
+        }
+    }
+
+    ChunkScheduler::ChunkScheduler(std::size_t steps, const HybridOptions& options)
+        : steps_(steps), options_(options) {
+        options_.min_chunk = std::max<std::size_t>(options.min_chunk, 1);
+    }
+
+    bool ChunkScheduler::take(int side, std::size_t& begin, std::size_t& end) {
+        std::size_t want;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            double mine = rate_[side], other = device_alive_ ? rate_[1 - side] : 0.0;
+            std::size_t remaining = steps_ - std::min(steps_, next_.load());
+            if (mine <= 0.0) {
+                want = options_.min_chunk;   // первый кусок — замер скорости
+            } else {
+                want = static_cast<std::size_t>(mine * options_.target_seconds);
+                // В конце — не больше своей доли остатка, чтобы стороны закончили вместе
+                double share = other > 0.0 ? mine / (mine + other) : 1.0;
+                want = std::min(want, static_cast<std::size_t>(static_cast<double>(remaining) * share));
+            }
+            want = std::max(want, options_.min_chunk);
+        }
+        begin = next_.fetch_add(want);
+        if (begin >= steps_) return false;
+        end = std::min(steps_, begin + want);
+        return true;
+    }
+
+    void ChunkScheduler::record(int side, std::size_t points, double seconds) {
+        if (seconds <= 0.0) return;
+        double r = static_cast<double>(points) / seconds;
+        std::lock_guard<std::mutex> lock(mutex_);
+        rate_[side] = rate_[side] > 0.0 ? RATE_SMOOTHING * r + (1.0 - RATE_SMOOTHING) * rate_[side] : r;
+    }
+
+    void ChunkScheduler::device_failed() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        device_alive_ = false;
+    }
+
+    double ChunkScheduler::rate(int side) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rate_[side];
+    }
+
+    double integrate_weierstrass_hybrid(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                        const DeviceSum& device, integral_parallel::ThreadPool& pool,
+                                        const HybridOptions& options, HybridStats* stats) {
+        HybridStats local;
+        HybridStats& st = stats ? *stats : local;
+        st = HybridStats();
+        if (steps == 0) return 0.0;
+
+        double h = (x1 - x0) / static_cast<double>(steps);
+        ChunkScheduler sched(steps, options);
+
+        // Устройство обслуживает отдельный поток: его вызовы блокируются до конца ядра.
+        // Первый кусок устройства берётся до старта CPU, иначе на занятой машине CPU
+        // может разобрать весь диапазон раньше, чем поток устройства проснётся
+        common::Summation mode = plan.precision().summation;
+        common::RunningSum device_sum(mode);
+        std::size_t lost_begin = 0, lost_end = 0;
+        bool lost_chunk = false;
+        std::size_t first_begin = 0, first_end = 0;
+        bool first = sched.take(ChunkScheduler::Device, first_begin, first_end);
+        std::thread device_thread([&] {
+            std::size_t begin = first_begin, end = first_end;
+            for (bool more = first; more; more = sched.take(ChunkScheduler::Device, begin, end)) {
+                auto t = Clock::now();
+                double sum = 0.0;
+                std::string error = device(begin, end, sum);
+                if (!error.empty()) {
+                    // Кусок вернётся CPU после завершения общего курсора
+                    st.device_error = error;
+                    lost_begin = begin;
+                    lost_end = end;
+                    lost_chunk = true;
+                    sched.device_failed();
+                    return;
+                }
+                sched.record(ChunkScheduler::Device, end - begin, seconds_since(t));
+                device_sum.add(sum);
+                st.device_points += end - begin;
+                ++st.device_chunks;
+            }
+        });
+
+        // CPU — вызывающий поток с пулом
+        common::RunningSum cpu_sum(mode);
+        std::size_t begin, end;
+        while (sched.take(ChunkScheduler::CPU, begin, end)) {
+            auto t = Clock::now();
+            cpu_sum.add(integral_parallel::sum_weierstrass_range(plan, x0, h, begin, end, pool));
+            sched.record(ChunkScheduler::CPU, end - begin, seconds_since(t));
+            st.cpu_points += end - begin;
+            ++st.cpu_chunks;
+        }
+        device_thread.join();
+
+        // Кусок, на котором устройство сломалось, досчитывает CPU
+        if (lost_chunk) {
+            cpu_sum.add(integral_parallel::sum_weierstrass_range(plan, x0, h, lost_begin, lost_end, pool));
+            st.cpu_points += lost_end - lost_begin;
+            ++st.cpu_chunks;
+        }
+        st.cpu_rate = sched.rate(ChunkScheduler::CPU);
+        st.device_rate = sched.rate(ChunkScheduler::Device);
+        common::RunningSum total(mode);
+        total.add(cpu_sum.value());
+        total.add(device_sum.value());
+        return total.value() * h;
+    }
+
+#ifdef ENABLE_OPENCL
+    double integrate_weierstrass_hybrid(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                        integral_opencl::OpenCLEngine& engine, integral_parallel::ThreadPool& pool,
+                                        const HybridOptions& options, HybridStats* stats) {
+        double h = steps ? (x1 - x0) / static_cast<double>(steps) : 0.0;
+        DeviceSum device = [&](std::size_t begin, std::size_t end, double& sum) {
+            integral_opencl::Result r = engine.sum_range(plan, x0, h, begin, end);
+            sum = r.value;
+            return r.error;
+        };
+        return integrate_weierstrass_hybrid(plan, x0, x1, steps, device, pool, options, stats);
+    }
+#endif
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+
+namespace common { class WeierstrassPlan; }
+namespace integral_opencl { class OpenCLEngine; }
+namespace integral_parallel { class ThreadPool; }
+
+namespace integral_hybrid {
+    struct HybridOptions {
+        std::size_t min_chunk = std::size_t(1) << 14;   // smallest chunk either side takes
+        double target_seconds = 0.02;                    // chunk size aims at this much work
+    };
+
+    // How the range was split; rates are in points per second
+    struct HybridStats {
+        std::size_t cpu_points = 0, device_points = 0;
+        std::size_t cpu_chunks = 0, device_chunks = 0;
+        double cpu_rate = 0.0, device_rate = 0.0;
+        std::string device_error;   // device failure; the CPU finished its share
+    };
+
+    // Shared cursor over [0, steps) from which both sides take chunks. A side's
+    // first chunk is min_chunk points and measures its rate; later chunks aim at
+    // target_seconds of work at that rate, but never exceed the side's share of
+    // what remains (its rate over both rates), so the sides finish together.
+    class ChunkScheduler {
+    public:
+        enum Side { CPU = 0, Device = 1 };
+
+        ChunkScheduler(std::size_t steps, const HybridOptions& options);
+
+        // Next chunk [begin, end) for side; false once the range is taken
+        bool take(int side, std::size_t& begin, std::size_t& end);
+        // points done by side in seconds; rates are smoothed over chunks
+        void record(int side, std::size_t points, double seconds);
+        // The CPU then sizes its chunks as if it were alone
+        void device_failed();
+        double rate(int side) const;
+
+    private:
+        std::size_t steps_;
+        HybridOptions options_;
+        std::atomic<std::size_t> next_{0};
+        mutable std::mutex mutex_;       // rates and device_alive_
+        double rate_[2] = {0.0, 0.0};
+        bool device_alive_ = true;
+    };
+
+    // Device side of a hybrid run: the sum of the integrand at x0 + h*(i + 0.5),
+    // i in [begin, end), without the factor h, into sum. Returns "" or an error
+    // message; after an error the chunk is recomputed on the CPU and the device
+    // gets no more chunks.
+    using DeviceSum = std::function<std::string(std::size_t begin, std::size_t end, double& sum)>;
+
+    // Integral over [x0, x1] split dynamically between device and the thread
+    // pool. The device is driven from its own thread and always gets the first
+    // chunk; the CPU side is the calling thread with the pool. If the device
+    // fails, the CPU recomputes the failed chunk and takes the rest.
+    double integrate_weierstrass_hybrid(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                        const DeviceSum& device, integral_parallel::ThreadPool& pool,
+                                        const HybridOptions& options = HybridOptions(), HybridStats* stats = nullptr);
+    // The same with OpenCLEngine::sum_range as the device (builds with ENABLE_OPENCL)
+    double integrate_weierstrass_hybrid(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                        integral_opencl::OpenCLEngine& engine, integral_parallel::ThreadPool& pool,
+                                        const HybridOptions& options = HybridOptions(), HybridStats* stats = nullptr);
+}
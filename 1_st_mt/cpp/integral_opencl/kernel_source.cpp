@@ -0,0 +1,158 @@
+#include "kernel_source.hpp"
+#include "../common/common.hpp"
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+
+// Генерация специализированных ядер OpenCL: n, a^k и PI*b^k подставляются
+// как константы времени компиляции, цикл по слагаемым развёрнут.
+namespace integral_opencl { namespace detail {
+    namespace {
+        // Шестнадцатеричный литерал: таблицы на устройстве побитно совпадают с планом
+        std::string hex(double v) {
+            char buf[40];
+            std::snprintf(buf, sizeof buf, "%a", v);
+            return buf;
+        }
+
+        // Константы редукции Mixed: ядро получает их hex-литералами, mixed_point_host
+        // считает с ними же
+        constexpr double INV_TWO_PI = 0x1.45f306dc9c883p-3;
+        constexpr double TWO_PI_1 = 0x1.921fb544p+2;       // 33 старших бита 2*pi
+        constexpr double TWO_PI_2 = 0x1.0b4611a6p-32;      // следующие 33 бита
+        constexpr double TWO_PI_3 = 0x1.3198a2e037073p-67; // остаток
+        // Граница Коди–Уэйта для Mixed: ниже неё q < 2^46 и r в [-pi, pi] с ошибкой
+        // ~1e-12; выше (при b = 30 — слагаемые с k >= 10) аргумент остаётся в double
+        // и берётся double cos, как в варианте Double
+        constexpr double MIXED_LIMIT = 0x1p48;
+
+        // Функция point для типа vec (doubleN) или double (хвост); слагаемые развёрнуты
+        void emit_point(std::ostringstream& out, const char* name, const char* vec, const char* fvec,
+                        std::size_t n, Precision precision) {
+            bool scalar = std::string(vec) == "double";
+            out << "inline " << vec << " " << name << "(" << vec << " x) {\n";
+            out << "    " << vec << " sum = (" << vec << ")(0.0);\n";
+            for (std::size_t k = 0; k < n; ++k) {
+                if (precision == Precision::Double) {
+                    out << "    sum += AMP[" << k << "] * cos(FREQ[" << k << "] * x);\n";
+                } else {
+                    // Аргумент и редукция в double (fma с тремя частями 2*pi), cos во float;
+                    // вектор с аргументом за MIXED_LIMIT целиком идёт через double cos
+                    out << "    { " << vec << " arg = FREQ[" << k << "] * x;\n"
+                        << (scalar ? "      if (fabs(arg) < MIXED_LIMIT) {\n"
+                                   : "      if (all(isless(fabs(arg), (" + std::string(vec) + ")(MIXED_LIMIT)))) {\n")
+                        << "        " << vec << " q = rint(arg * INV_TWO_PI);\n"
+                        << "        " << vec << " r = fma(-q, (" << vec << ")(TWO_PI_1), arg);\n"
+                        << "        r = fma(-q, (" << vec << ")(TWO_PI_2), r);\n"
+                        << "        r = fma(-q, (" << vec << ")(TWO_PI_3), r);\n"
+                        << "        sum += AMP[" << k << "] * convert_" << vec << "(cos(convert_" << fvec << "(r)));\n"
+                        << "      } else {\n"
+                        << "        sum += AMP[" << k << "] * cos(arg);\n"
+                        << "      } }\n";
+                }
+            }
+            out << "    return sum;\n}\n\n";
+        }
+    }
+
+    double mixed_point_host(const common::WeierstrassPlan& plan, double x) {
+        double sum = 0.0;
+        for (std::size_t k = 0; k < plan.n(); ++k) {
+            double arg = plan.freq()[k] * x;
+            if (std::fabs(arg) < MIXED_LIMIT) {
+                double q = std::rint(arg * INV_TWO_PI);
+                double r = std::fma(-q, TWO_PI_1, arg);
+                r = std::fma(-q, TWO_PI_2, r);
+                r = std::fma(-q, TWO_PI_3, r);
+                sum += plan.amp()[k] * static_cast<double>(std::cos(static_cast<float>(r)));
+            } else {
+                sum += plan.amp()[k] * std::cos(arg);
+            }
+        }
+        return sum;
+    }
+
+    std::string specialized_source(const common::WeierstrassPlan& plan, Precision precision, int width) {
+        std::size_t n = plan.n();
+        std::ostringstream out;
+        out << "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n";
+        out << "// a=" << hex(plan.a()) << " b=" << hex(plan.b()) << " n=" << n
+            << (precision == Precision::Mixed ? " mixed" : " double") << " width=" << width << "\n";
+        out << "#define N " << n << "\n";
+        out << "#define W " << width << "\n";
+        out << "#define INV_TWO_PI " << hex(INV_TWO_PI) << "\n";
+        out << "#define TWO_PI_1 " << hex(TWO_PI_1) << "\n";
+        out << "#define TWO_PI_2 " << hex(TWO_PI_2) << "\n";
+        out << "#define TWO_PI_3 " << hex(TWO_PI_3) << "\n";
+        out << "#define MIXED_LIMIT " << hex(MIXED_LIMIT) << "\n";
+        // Пустой план: массив нулевой длины недопустим
+        std::size_t len = n > 0 ? n : 1;
+        out << "__constant double AMP[" << len << "] = {";
+        for (std::size_t k = 0; k < len; ++k) out << (k ? ", " : "") << hex(n > 0 ? plan.amp()[k] : 0.0);
+        out << "};\n__constant double FREQ[" << len << "] = {";
+        for (std::size_t k = 0; k < len; ++k) out << (k ? ", " : "") << hex(n > 0 ? plan.freq()[k] : 0.0);
+        out << "};\n\n";
+
+        std::string vec = width == 1 ? "double" : "double" + std::to_string(width);
+        std::string fvec = width == 1 ? "float" : "float" + std::to_string(width);
+        emit_point(out, "point1", "double", "float", n, precision);
+        if (width > 1) emit_point(out, "pointw", vec.c_str(), fvec.c_str(), n, precision);
+
+        // Сумма элементов вектора и смещения точек внутри вектора
+        std::string hsum = "s", lanes;
+        if (width == 2) { hsum = "s.s0 + s.s1"; lanes = "(double2)(0.5, 1.5)"; }
+        if (width == 4) { hsum = "s.s0 + s.s1 + s.s2 + s.s3"; lanes = "(double4)(0.5, 1.5, 2.5, 3.5)"; }
+
+        out << "__kernel void " << SPECIALIZED_KERNEL << "(\n"
+               "    const double x0,\n"
+               "    const double h,\n"
+               "    const ulong first,\n"
+               "    const ulong count,\n"
+               "    const int accumulate,\n"
+               "    __global double* partial,\n"
+               "    __local double* scratch\n"
+               ") {\n"
+               "    size_t gid = get_global_id(0);\n"
+               "    size_t gsize = get_global_size(0);\n"
+               "    double acc = 0.0;\n";
+        if (width > 1) {
+            // Точки first + v*W + j: base и смещения целые, x совпадает со скалярной формулой
+            out << "    ulong vecs = count / W;\n"
+                   "    for (ulong v = gid; v < vecs; v += gsize) {\n"
+                   "        " << vec << " s = pointw(x0 + h * ((double)(first + v * W) + " << lanes << "));\n"
+                   "        acc += " << hsum << ";\n"
+                   "    }\n"
+                   "    for (ulong i = vecs * W + gid; i < count; i += gsize) {\n";
+        } else {
+            out << "    for (ulong i = gid; i < count; i += gsize) {\n";
+        }
+        out << "        acc += point1(x0 + h * ((double)(first + i) + 0.5));\n"
+               "    }\n"
+               "\n"
+               "    size_t lid = get_local_id(0);\n"
+               "    scratch[lid] = acc;\n"
+               "    barrier(CLK_LOCAL_MEM_FENCE);\n"
+               "    for (size_t s = get_local_size(0) / 2; s > 0; s >>= 1) {\n"
+               "        if (lid < s) scratch[lid] += scratch[lid + s];\n"
+               "        barrier(CLK_LOCAL_MEM_FENCE);\n"
+               "    }\n"
+               "    if (lid == 0) {\n"
+               "        size_t g = get_group_id(0);\n"
+               "        partial[g] = accumulate ? partial[g] + scratch[0] : scratch[0];\n"
+               "    }\n"
+               "}\n\n";
+
+        // Значения по точкам: проверка Mixed сравнивает их с Double поточечно
+        out << "__kernel void " << SPECIALIZED_VALUES_KERNEL << "(\n"
+               "    const double x0,\n"
+               "    const double h,\n"
+               "    const ulong first,\n"
+               "    const ulong count,\n"
+               "    __global double* out\n"
+               ") {\n"
+               "    size_t i = get_global_id(0);\n"
+               "    if (i < count) out[i] = point1(x0 + h * ((double)(first + i) + 0.5));\n"
+               "}\n";
+        return out.str();
+    }
+}}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "opencl_impl.hpp"
+
+namespace common { class WeierstrassPlan; }
+
+namespace integral_opencl { namespace detail {
+    // Largest n that gets a specialized kernel; longer plans use the generic one
+    static constexpr std::size_t MAX_SPECIALIZED_N = 256;
+
+    // Kernel name in specialized_source()
+    static constexpr const char* SPECIALIZED_KERNEL = "weier_reduce_spec";
+
+    // Kernel writing the value at every point, for checking Mixed against Double
+    static constexpr const char* SPECIALIZED_VALUES_KERNEL = "weier_values_spec";
+
+    // OpenCL C for weier_reduce_spec(x0, h, first, count, accumulate, partial, scratch):
+    // the plan's tables as __constant arrays with exact hex literals, the term loop
+    // unrolled, `width` samples per work-item iteration; and for
+    // weier_values_spec(x0, h, first, count, out), one point per work-item
+    std::string specialized_source(const common::WeierstrassPlan& plan, Precision precision, int width);
+
+    // Host copy of the Mixed point function of specialized_source: the same
+    // constants and operations, with std::cos on float for the device cos. For
+    // tests; the device float cos may differ from the host's in the last ulps.
+    double mixed_point_host(const common::WeierstrassPlan& plan, double x);
+}}
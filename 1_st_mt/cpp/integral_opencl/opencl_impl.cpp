@@ -1,119 +1,817 @@
 #include "opencl_impl.hpp"
+#include "kernel_source.hpp"
 #include "../common/common.hpp"
+#include "../common/jobs.hpp"
+#include "../common/profile.hpp"
 #include <CL/opencl.hpp>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <tuple>
 #include <vector>
 #include <iostream>
 #include <sstream>
 #include <mutex>
+#include <random>
 
-// Модуль для численного интегрирования функции Вейерштрасса на GPU с помощью OpenCL
+// Модуль для численного интегрирования функции Вейерштрасса на GPU с помощью OpenCL.
+// Контекст, очередь, программа и ядро живут в OpenCLEngine и переиспользуются
+// между вызовами; бинарник программы кэшируется на диске.
 namespace integral_opencl {
     namespace {
-        // Глобальная переменная для хранения последней ошибки OpenCL
+        // Последняя ошибка обёрток совместимости (integrate_weierstrass_opencl)
         std::string g_last_error;
         std::mutex g_err_mutex;
 
-        // Исходный код ядра OpenCL для вычисления функции Вейерштрасса
+        // Исходный код ядер OpenCL для вычисления функции Вейерштрасса.
+        // Коэффициенты a^k и PI*b^k берутся из плана и лежат в __constant памяти.
+        // weier_integral пишет значение в каждой точке запуска [first, first + count);
+        // weier_reduce суммирует точки в рабочем элементе (шаг — глобальный размер,
+        // чтобы соседние элементы брали соседние точки), затем деревом в локальной
+        // памяти группы и добавляет одну частичную сумму на группу в partial.
+        // weier_batch считает пакет за один запуск: группа g берёт кусок pieces[g]
+        // (задание, первая точка, число точек) и пишет его сумму в partial[g];
+        // таблицы всех планов пакета лежат подряд в глобальной памяти.
         const char *kernelSrc = R"CLC(
 #pragma OPENCL EXTENSION cl_khr_fp64 : enable
+inline double weier_point(__constant double* amp, __constant double* freq, int n, double x) {
+    double sum = 0.0;
+    for (int k = 0; k < n; ++k) {
+        sum += amp[k] * cos(freq[k] * x);
+    }
+    return sum;
+}
+
 __kernel void weier_integral(
-    const double a,
-    const double b,
+    __constant double* amp,
+    __constant double* freq,
     const int n,
     const double x0,
     const double h,
+    const ulong first,
     __global double* out
 ) {
-    int i = get_global_id(0);
-    double x = x0 + h * (i + 0.5);
-    double sum = 0.0;
-    for (int k = 0; k < n; ++k) {
-        sum += pow(a, (double)k) * cos(3.14159265358979323846 * pow(b, (double)k) * x);
+    size_t i = get_global_id(0);
+    double x = x0 + h * ((double)(first + i) + 0.5);
+    out[i] = weier_point(amp, freq, n, x);
+}
+
+__kernel void weier_reduce(
+    __constant double* amp,
+    __constant double* freq,
+    const int n,
+    const double x0,
+    const double h,
+    const ulong first,
+    const ulong count,
+    const int accumulate,
+    __global double* partial,
+    __local double* scratch
+) {
+    size_t gid = get_global_id(0);
+    size_t gsize = get_global_size(0);
+    double acc = 0.0;
+    for (ulong i = gid; i < count; i += gsize) {
+        acc += weier_point(amp, freq, n, x0 + h * ((double)(first + i) + 0.5));
+    }
+
+    size_t lid = get_local_id(0);
+    scratch[lid] = acc;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (size_t s = get_local_size(0) / 2; s > 0; s >>= 1) {
+        if (lid < s) scratch[lid] += scratch[lid + s];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if (lid == 0) {
+        size_t g = get_group_id(0);
+        partial[g] = accumulate ? partial[g] + scratch[0] : scratch[0];
     }
-    out[i] = sum;
+}
+
+__kernel void weier_batch(
+    __global const double* amp,
+    __global const double* freq,
+    __global const int* tables,     // на задание: смещение таблиц, n
+    __global const double* grid,    // на задание: x0, h
+    __global const ulong* pieces,   // на группу: задание, первая точка, число точек
+    __global double* partial,
+    __local double* scratch
+) {
+    size_t g = get_group_id(0);
+    ulong job = pieces[3 * g];
+    ulong first = pieces[3 * g + 1];
+    ulong count = pieces[3 * g + 2];
+    __global const double* a = amp + tables[2 * job];
+    __global const double* f = freq + tables[2 * job];
+    int n = tables[2 * job + 1];
+    double x0 = grid[2 * job];
+    double h = grid[2 * job + 1];
+
+    size_t lid = get_local_id(0);
+    double acc = 0.0;
+    for (ulong i = lid; i < count; i += get_local_size(0)) {
+        double x = x0 + h * ((double)(first + i) + 0.5);
+        double sum = 0.0;
+        for (int k = 0; k < n; ++k) sum += a[k] * cos(f[k] * x);
+        acc += sum;
+    }
+
+    scratch[lid] = acc;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (size_t s = get_local_size(0) / 2; s > 0; s >>= 1) {
+        if (lid < s) scratch[lid] += scratch[lid + s];
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if (lid == 0) partial[g] = scratch[0];
 }
 )CLC";
 
+        // Опции сборки входят в ключ кэша вместе с исходником
+        const char *buildOptions = "";
+
         // Устанавливает текст ошибки для последующего получения
         void set_error(const std::string &msg) {
             std::lock_guard<std::mutex> lock(g_err_mutex);
             g_last_error = msg;
         }
+
+        // Рабочих групп на вычислительный блок в режиме редукции
+        constexpr std::size_t GROUPS_PER_UNIT = 8;
+        // Точек в проверке варианта Mixed против Double
+        constexpr std::size_t VALIDATION_SAMPLES = std::size_t(1) << 16;
+
+        std::uint64_t bits(double v) {
+            std::uint64_t u;
+            std::memcpy(&u, &v, sizeof u);
+            return u;
+        }
+
+        std::string cl_error(const char *what, cl_int err) {
+            return std::string(what) + " failed (error " + std::to_string(err) + ")";
+        }
+
+        cl_device_type to_cl(DeviceType type) {
+            switch (type) {
+                case DeviceType::GPU: return CL_DEVICE_TYPE_GPU;
+                case DeviceType::CPU: return CL_DEVICE_TYPE_CPU;
+                case DeviceType::Accelerator: return CL_DEVICE_TYPE_ACCELERATOR;
+                default: return CL_DEVICE_TYPE_ALL;
+            }
+        }
+
+        // FNV-1a: ключ кэша, не криптографический
+        std::uint64_t fnv1a(const std::string &s, std::uint64_t h = 1469598103934665603ULL) {
+            for (unsigned char c : s) {
+                h ^= c;
+                h *= 1099511628211ULL;
+            }
+            return h;
+        }
+
+        std::string default_cache_dir() {
+            if (const char *xdg = std::getenv("XDG_CACHE_HOME")) if (*xdg) return std::string(xdg) + "/weier_integral";
+            if (const char *home = std::getenv("HOME")) if (*home) return std::string(home) + "/.cache/weier_integral";
+            return "";
+        }
+
+        bool is_index(const std::string &s) {
+            return !s.empty() && s.find_first_not_of("0123456789") == std::string::npos;
+        }
+
+        struct Candidate {
+            cl::Platform platform;
+            cl::Device device;
+            std::string platform_name;
+            std::string device_name;
+        };
+
+        // Устройства, подходящие под опции, в порядке платформ и устройств
+        std::vector<Candidate> find_devices(const EngineOptions &options, cl_device_type type, std::string &error) {
+            std::vector<Candidate> found;
+            std::vector<cl::Platform> platforms;
+            cl_int err = cl::Platform::get(&platforms);
+            if (err != CL_SUCCESS || platforms.empty()) {
+                error = "No OpenCL platforms";
+                return found;
+            }
+            for (std::size_t p = 0; p < platforms.size(); ++p) {
+                if (options.platform >= 0 && static_cast<std::size_t>(options.platform) != p) continue;
+                std::string pname = platforms[p].getInfo<CL_PLATFORM_NAME>();
+                std::string pvendor = platforms[p].getInfo<CL_PLATFORM_VENDOR>();
+                if (!options.platform_match.empty() && pname.find(options.platform_match) == std::string::npos
+                    && pvendor.find(options.platform_match) == std::string::npos) continue;
+
+                std::vector<cl::Device> devices;
+                if (platforms[p].getDevices(type, &devices) != CL_SUCCESS) continue;
+                for (std::size_t d = 0; d < devices.size(); ++d) {
+                    if (options.device >= 0 && static_cast<std::size_t>(options.device) != d) continue;
+                    std::string dname = devices[d].getInfo<CL_DEVICE_NAME>();
+                    if (!options.device_match.empty() && dname.find(options.device_match) == std::string::npos) continue;
+                    found.push_back({platforms[p], devices[d], pname, dname});
+                }
+            }
+            if (found.empty()) error = "No matching OpenCL devices";
+            return found;
+        }
+
+        std::vector<unsigned char> read_file(const std::string &path) {
+            std::ifstream in(path, std::ios::binary);
+            if (!in) return {};
+            return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+
+        // Запись через временный файл и rename: параллельные процессы не видят половину бинарника
+        void write_file(const std::string &path, const std::vector<unsigned char> &data) {
+            std::string tmp = path + ".tmp" + std::to_string(std::random_device{}());
+            {
+                std::ofstream out(tmp, std::ios::binary);
+                if (!out) return;
+                out.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+                if (!out) return;
+            }
+            std::error_code ec;
+            std::filesystem::rename(tmp, path, ec);
+            if (ec) std::filesystem::remove(tmp, ec);
+        }
+    }
+
+    EngineOptions options_from_env() {
+        EngineOptions options;
+        if (const char *p = std::getenv("WEIER_CL_PLATFORM")) {
+            if (is_index(p)) options.platform = std::atoi(p); else options.platform_match = p;
+        }
+        if (const char *d = std::getenv("WEIER_CL_DEVICE")) {
+            if (is_index(d)) options.device = std::atoi(d); else options.device_match = d;
+        }
+        if (const char *t = std::getenv("WEIER_CL_TYPE")) {
+            std::string s(t);
+            if (s == "gpu") options.type = DeviceType::GPU;
+            else if (s == "cpu") options.type = DeviceType::CPU;
+            else if (s == "accelerator") options.type = DeviceType::Accelerator;
+            else if (s == "all") options.type = DeviceType::All;
+        }
+        if (const char *c = std::getenv("WEIER_CL_CACHE")) options.cache_dir = c;
+        if (const char *p = std::getenv("WEIER_CL_PRECISION")) {
+            if (std::string(p) == "mixed") options.precision = Precision::Mixed;
+        }
+        return options;
     }
 
+    struct OpenCLEngine::Impl {
+        std::mutex mutex;   // одна очередь: вызовы integrate() по одному
+        cl::Device device;
+        cl::Context context;
+        cl::CommandQueue queue;
+        cl::Program program;
+        cl::Kernel kernel;          // weier_integral
+        cl::Kernel reduceKernel;    // weier_reduce
+        cl::Kernel batchKernel;     // weier_batch
+        std::string platform_name;
+        std::string device_name;
+        std::string cache_dir;
+        bool from_cache = false;
+        cl_ulong max_constant = 0;
+        EngineOptions options;
+        bool device_reduction = true;
+        std::size_t launch_samples = 0;
+        std::size_t local_size = 1;   // степень двойки для дерева в локальной памяти
+        std::size_t groups = 1;
 
-    // Возвращает текст последней ошибки OpenCL
-    const std::string & last_error() { return g_last_error; }
+        // Профилирование событий очереди (CL_QUEUE_PROFILING_ENABLE): фаза и событие
+        // каждой команды до ближайшего блокирующего чтения
+        bool profiling = false;
+        std::deque<std::pair<const char *, cl::Event>> events;
 
-    // Основная функция для интегрирования функции Вейерштрасса на GPU через OpenCL
-    // a, b, n — параметры функции
-    // x0, x1 — границы интегрирования
-    // steps — количество разбиений
-    // ok — флаг успешности вычисления
-    double integrate_weierstrass_opencl(double a, double b, std::size_t n, double x0, double x1, std::size_t steps, bool &ok) {
-        ok = false;
+        // Событие для команды фазы phase или nullptr без профилирования
+        cl::Event *track(const char *phase) {
+            if (!profiling) return nullptr;
+            events.emplace_back(phase, cl::Event());
+            return &events.back().second;
+        }
 
-        // Получаем список доступных платформ OpenCL
-        std::vector<cl::Platform> platforms;
-        cl::Platform::get(&platforms);
-        if (platforms.empty()) { set_error("No OpenCL platforms"); return 0.0; }
+        // После блокирующего чтения очередь (in-order) выполнила все команды:
+        // время START..END каждой уходит в свою фазу common::add_phase
+        void collect() {
+            for (auto &ev : events) {
+                cl_int err = CL_SUCCESS;
+                cl_ulong start = ev.second.getProfilingInfo<CL_PROFILING_COMMAND_START>(&err);
+                cl_ulong end = err == CL_SUCCESS ? ev.second.getProfilingInfo<CL_PROFILING_COMMAND_END>(&err) : 0;
+                if (err == CL_SUCCESS && end >= start)
+                    common::add_phase(ev.first, static_cast<double>(end - start) * 1e-9);
+            }
+            events.clear();
+        }
 
-        // Получаем список устройств (GPU) на первой платформе
-        std::vector<cl::Device> devices;
-        platforms[0].getDevices(CL_DEVICE_TYPE_GPU, &devices);
-        if (devices.empty()) { set_error("No GPU devices"); return 0.0; }
+        // Буферы переиспользуются; размер не зависит от steps
+        cl::Buffer ampBuf, freqBuf, outBuf, partialBuf;
+        std::size_t table_capacity = 0;
 
-        // Выбираем первое устройство и создаём контекст и очередь команд
-        cl::Device device = devices[0];
-        cl::Context context(device);
-        cl::CommandQueue queue(context, device);
+        // Специализированные ядра по набору параметров (a, b, n, точность)
+        struct Variant {
+            cl::Kernel kernel;
+            cl::Kernel values;   // значения по точкам, для проверки Mixed
+            std::string name;
+        };
+        std::map<std::tuple<std::uint64_t, std::uint64_t, std::size_t, Precision>, Variant> variants;
+        // Ошибки сборки Double по тем же ключам: повторные вызовы не пересобирают
+        std::map<std::tuple<std::uint64_t, std::uint64_t, std::size_t, Precision>, std::string> failed_variants;
 
-        // Создаём и компилируем программу OpenCL из исходного кода ядра
-        cl::Program::Sources sources;
-        sources.push_back({kernelSrc, std::strlen(kernelSrc)});
-        cl::Program program(context, sources);
-        if (program.build({device}) != CL_SUCCESS) {
-            std::string log = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device);
-            set_error(std::string("Build error: ") + log);
-            return 0.0;
+        // Загрузка программы из кэша, иначе компиляция из исходника с сохранением бинарника
+        bool build_program(const std::string &source, cl::Program &program, bool &cached_binary,
+                           std::string &error) {
+            auto start = std::chrono::steady_clock::now();
+            bool ok = load_or_build(source, program, cached_binary, error);
+            if (profiling) {
+                common::add_phase(cached_binary ? "opencl binary load" : "opencl build",
+                                  std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            }
+            return ok;
         }
 
-        // Создаём объект ядра
-        cl::Kernel kernel(program, "weier_integral");
+        bool load_or_build(const std::string &source, cl::Program &program, bool &cached_binary,
+                           std::string &error) {
+            std::string cache_path;
+            cached_binary = false;
+            if (!cache_dir.empty() && cache_dir != "-") {
+                std::uint64_t key = fnv1a(source);
+                key = fnv1a(buildOptions, key);
+                key = fnv1a(platform_name, key);
+                key = fnv1a(device_name, key);
+                key = fnv1a(device.getInfo<CL_DRIVER_VERSION>(), key);
+                key = fnv1a(device.getInfo<CL_DEVICE_VERSION>(), key);
+                char name[32];
+                std::snprintf(name, sizeof name, "%016llx.bin", static_cast<unsigned long long>(key));
+                cache_path = cache_dir + "/" + name;
+
+                std::vector<unsigned char> binary = read_file(cache_path);
+                if (!binary.empty()) {
+                    cl_int err = CL_SUCCESS;
+                    std::vector<cl_int> status;
+                    cl::Program::Binaries binaries{binary};
+                    cl::Program cached(context, {device}, binaries, &status, &err);
+                    // Битый или чужой бинарник не ошибка: просто компилируем заново
+                    if (err == CL_SUCCESS && cached.build({device}, buildOptions) == CL_SUCCESS) {
+                        program = cached;
+                        cached_binary = true;
+                        return true;
+                    }
+                }
+            }
 
+            cl_int err = CL_SUCCESS;
+            program = cl::Program(context, source, false, &err);
+            if (err != CL_SUCCESS) {
+                error = cl_error("clCreateProgramWithSource", err);
+                return false;
+            }
+            if (program.build({device}, buildOptions) != CL_SUCCESS) {
+                error = std::string("Build error: ") + program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device);
+                return false;
+            }
+            if (!cache_path.empty()) {
+                auto binaries = program.getInfo<CL_PROGRAM_BINARIES>(&err);
+                if (err == CL_SUCCESS && binaries.size() == 1 && !binaries[0].empty()) {
+                    std::error_code ec;
+                    std::filesystem::create_directories(cache_dir, ec);
+                    if (!ec) write_file(cache_path, binaries[0]);
+                }
+            }
+            return true;
+        }
+
+        // Таблицы плана копируются в постоянные буферы устройства
+        bool upload_tables(const common::WeierstrassPlan &plan, std::string &error) {
+            std::size_t n = plan.n();
+            if (!ensure_tables(n > 0 ? n : 1, error)) return false;
+            if (n == 0) return true;
+            cl_int err = queue.enqueueWriteBuffer(ampBuf, CL_FALSE, 0, sizeof(double) * n, plan.amp(), nullptr,
+                                                  track("opencl write"));
+            if (err == CL_SUCCESS)
+                err = queue.enqueueWriteBuffer(freqBuf, CL_FALSE, 0, sizeof(double) * n, plan.freq(), nullptr,
+                                               track("opencl write"));
+            if (err != CL_SUCCESS) { error = cl_error("clEnqueueWriteBuffer", err); return false; }
+            return true;
+        }
+
+        bool ensure_tables(std::size_t n, std::string &error) {
+            if (n <= table_capacity) return true;
+            cl_int err = CL_SUCCESS;
+            ampBuf = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(double) * n, nullptr, &err);
+            if (err == CL_SUCCESS) freqBuf = cl::Buffer(context, CL_MEM_READ_ONLY, sizeof(double) * n, nullptr, &err);
+            if (err != CL_SUCCESS) {
+                table_capacity = 0;
+                error = cl_error("clCreateBuffer (tables)", err);
+                return false;
+            }
+            table_capacity = n;
+            return true;
+        }
+
+        // Выходные буферы создаются один раз: launch_samples значений или по одному на группу
+        bool create_output(std::string &error) {
+            cl_int err = CL_SUCCESS;
+            if (device_reduction) {
+                partialBuf = cl::Buffer(context, CL_MEM_READ_WRITE, sizeof(double) * groups, nullptr, &err);
+                if (err != CL_SUCCESS) { error = cl_error("clCreateBuffer (partials)", err); return false; }
+            } else {
+                outBuf = cl::Buffer(context, CL_MEM_WRITE_ONLY, sizeof(double) * launch_samples, nullptr, &err);
+                if (err != CL_SUCCESS) { error = cl_error("clCreateBuffer (output)", err); return false; }
+            }
+            return true;
+        }
+
+        // Ядро для плана: специализированное (с проверкой Mixed против Double при первом
+        // использовании) или nullptr, если специализация выключена или не подходит.
+        // Ошибкой считается только сбой сборки Double
+        Variant *variant_for(const common::WeierstrassPlan &plan, double x0, double h, std::string &error) {
+            if (!options.specialize || !device_reduction || plan.n() > detail::MAX_SPECIALIZED_N) return nullptr;
+            // Arithmetic::Fp32 в плане запрашивает Mixed так же, как WEIER_CL_PRECISION=mixed
+            Precision precision = plan.precision().arithmetic == common::Arithmetic::Fp32 ? Precision::Mixed
+                                                                                          : options.precision;
+            auto key = std::make_tuple(bits(plan.a()), bits(plan.b()), plan.n(), precision);
+            auto it = variants.find(key);
+            if (it != variants.end()) return &it->second;
+            auto failed = failed_variants.find(key);
+            if (failed != failed_variants.end()) {
+                error = failed->second;
+                return nullptr;
+            }
+
+            Variant *dbl = build_variant(plan, Precision::Double, error);
+            if (!dbl) {
+                failed_variants[key] = error;
+                return nullptr;
+            }
+            if (precision == Precision::Double) return dbl;
+            // Mixed необязателен: если он не собрался или проверка не прошла,
+            // под его ключом остаётся Double, а ошибка уходит в имя варианта
+            auto unavailable = [&]() {
+                Variant fallback = *dbl;
+                fallback.name += " (mixed unavailable: " + error + ")";
+                error.clear();
+                return &(variants[key] = fallback);
+            };
+            Variant *mixed = build_variant(plan, Precision::Mixed, error);
+            if (!mixed) return unavailable();
+
+            // Проверка на VALIDATION_SAMPLES точках первого вызова (x0, h): среднее
+            // |Mixed - Double| по точкам — ошибки разных знаков не гасят друг друга
+            std::vector<double> ref, got;
+            if (!sample_values(*dbl, x0, h, ref, error)) return unavailable();
+            if (!sample_values(*mixed, x0, h, got, error)) return unavailable();
+            double scale = 0.0, deviation = 0.0;
+            for (std::size_t k = 0; k < plan.n(); ++k) scale += std::fabs(plan.amp()[k]);
+            for (std::size_t i = 0; i < VALIDATION_SAMPLES; ++i) deviation += std::fabs(got[i] - ref[i]);
+            deviation /= static_cast<double>(VALIDATION_SAMPLES);
+            if (deviation <= options.mixed_tolerance * scale) return mixed;
+            Variant fallback = *dbl;
+            fallback.name += " (mixed rejected)";
+            return &(variants[key] = fallback);
+        }
+
+        Variant *build_variant(const common::WeierstrassPlan &plan, Precision precision, std::string &error) {
+            auto key = std::make_tuple(bits(plan.a()), bits(plan.b()), plan.n(), precision);
+            auto it = variants.find(key);
+            if (it != variants.end()) return &it->second;
+
+            int width = options.vector_width == 2 || options.vector_width == 4 ? options.vector_width : 1;
+            std::string source = detail::specialized_source(plan, precision, width);
+            cl::Program program;
+            bool cached_binary;
+            if (!build_program(source, program, cached_binary, error)) return nullptr;
+            cl_int err = CL_SUCCESS;
+            Variant v;
+            v.kernel = cl::Kernel(program, detail::SPECIALIZED_KERNEL, &err);
+            if (err != CL_SUCCESS) { error = cl_error("clCreateKernel", err); return nullptr; }
+            v.values = cl::Kernel(program, detail::SPECIALIZED_VALUES_KERNEL, &err);
+            if (err != CL_SUCCESS) { error = cl_error("clCreateKernel (values)", err); return nullptr; }
+            v.name = "n=" + std::to_string(plan.n()) + (precision == Precision::Mixed ? " mixed " : " ")
+                     + (width == 1 ? std::string("double") : "double" + std::to_string(width));
+            return &(variants[key] = v);
+        }
+
+        // Значения варианта в точках [0, VALIDATION_SAMPLES) сетки (x0, h)
+        bool sample_values(Variant &v, double x0, double h, std::vector<double> &values, std::string &error) {
+            cl_int err = CL_SUCCESS;
+            cl::Buffer buf(context, CL_MEM_WRITE_ONLY, sizeof(double) * VALIDATION_SAMPLES, nullptr, &err);
+            if (err != CL_SUCCESS) { error = cl_error("clCreateBuffer (validation)", err); return false; }
+            cl_ulong firstArg = 0, countArg = VALIDATION_SAMPLES;
+            v.values.setArg(0, x0);
+            v.values.setArg(1, h);
+            v.values.setArg(2, firstArg);
+            v.values.setArg(3, countArg);
+            v.values.setArg(4, buf);
+            err = queue.enqueueNDRangeKernel(v.values, cl::NullRange, cl::NDRange(VALIDATION_SAMPLES), cl::NullRange,
+                                             nullptr, track("opencl kernel"));
+            if (err != CL_SUCCESS) { error = cl_error("clEnqueueNDRangeKernel", err); return false; }
+            values.assign(VALIDATION_SAMPLES, 0.0);
+            err = queue.enqueueReadBuffer(buf, CL_TRUE, 0, sizeof(double) * VALIDATION_SAMPLES, values.data(), nullptr,
+                                          track("opencl read"));
+            if (err != CL_SUCCESS) { error = cl_error("clEnqueueReadBuffer", err); return false; }
+            if (profiling) collect();
+            return true;
+        }
+
+        // Сумма значений в точках [begin, end): запусками по launch_samples точек,
+        // частичные суммы групп накапливаются на устройстве и читаются один раз.
+        // Аргументы ядра с индекса base: x0, h, first, count, accumulate, partial, scratch
+        // (у общего ядра перед ними amp, freq и n, их задаёт вызывающий).
+        // Внутри групп сумма — дерево в локальной памяти; частичные суммы групп
+        // складываются на хосте в режиме mode
+        bool sum_reduce(cl::Kernel &k, cl_uint base, double x0, double h, std::size_t begin, std::size_t end,
+                        common::Summation mode, double &sum, std::string &error) {
+            cl_int err = CL_SUCCESS;
+            k.setArg(base + 0, x0);
+            k.setArg(base + 1, h);
+            k.setArg(base + 5, partialBuf);
+            k.setArg(base + 6, cl::Local(sizeof(double) * local_size));
+            for (std::size_t first = begin; first < end; first += launch_samples) {
+                cl_ulong firstArg = first;
+                cl_ulong countArg = std::min(launch_samples, end - first);
+                int accumulate = first == begin ? 0 : 1;
+                k.setArg(base + 2, firstArg);
+                k.setArg(base + 3, countArg);
+                k.setArg(base + 4, accumulate);
+                err = queue.enqueueNDRangeKernel(k, cl::NullRange, cl::NDRange(groups * local_size),
+                                                 cl::NDRange(local_size), nullptr, track("opencl kernel"));
+                if (err != CL_SUCCESS) { error = cl_error("clEnqueueNDRangeKernel", err); return false; }
+            }
+            std::vector<double> partial(groups, 0.0);
+            err = queue.enqueueReadBuffer(partialBuf, CL_TRUE, 0, sizeof(double) * groups, partial.data(), nullptr,
+                                          track("opencl read"));
+            if (err != CL_SUCCESS) { error = cl_error("clEnqueueReadBuffer", err); return false; }
+            if (profiling) collect();
+            common::RunningSum total(mode);
+            total.add(partial.data(), partial.size());
+            sum = total.value();
+            return true;
+        }
+
+        // Значение в каждой точке читается на хост; буфер ограничен launch_samples
+        bool sum_samples(int n, double x0, double h, std::size_t begin, std::size_t end, common::Summation mode,
+                         double &sum, std::string &error) {
+            cl_int err = CL_SUCCESS;
+            kernel.setArg(0, ampBuf);
+            kernel.setArg(1, freqBuf);
+            kernel.setArg(2, n);
+            kernel.setArg(3, x0);
+            kernel.setArg(4, h);
+            kernel.setArg(6, outBuf);
+            std::vector<double> results(std::min(launch_samples, end - begin), 0.0);
+            common::RunningSum total(mode);
+            for (std::size_t first = begin; first < end; first += launch_samples) {
+                std::size_t count = std::min(launch_samples, end - first);
+                cl_ulong firstArg = first;
+                kernel.setArg(5, firstArg);
+                err = queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(count), cl::NullRange, nullptr,
+                                                 track("opencl kernel"));
+                if (err != CL_SUCCESS) { error = cl_error("clEnqueueNDRangeKernel", err); return false; }
+                // Блокирующее чтение дожидается ядра
+                err = queue.enqueueReadBuffer(outBuf, CL_TRUE, 0, sizeof(double) * count, results.data(), nullptr,
+                                              track("opencl read"));
+                if (err != CL_SUCCESS) { error = cl_error("clEnqueueReadBuffer", err); return false; }
+                if (profiling) collect();
+                total.add(results.data(), count);
+            }
+            sum = total.value();
+            return true;
+        }
+    };
+
+    OpenCLEngine::OpenCLEngine(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+    OpenCLEngine::~OpenCLEngine() = default;
+
+    std::unique_ptr<OpenCLEngine> OpenCLEngine::create(const EngineOptions &options, std::string &error) {
+        // По умолчанию — первый GPU, а без GPU любое устройство (например, CPU-рантайм PoCL)
+        std::vector<Candidate> found;
+        if (options.type == DeviceType::Default) {
+            std::string ignored;
+            found = find_devices(options, CL_DEVICE_TYPE_GPU, ignored);
+        }
+        if (found.empty()) found = find_devices(options, to_cl(options.type), error);
+        if (found.empty()) return nullptr;
+
+        auto impl = std::make_unique<Impl>();
+        impl->device = found[0].device;
+        impl->platform_name = found[0].platform_name;
+        impl->device_name = found[0].device_name;
+        if (impl->device.getInfo<CL_DEVICE_DOUBLE_FP_CONFIG>() == 0) {
+            error = "Device " + impl->device_name + " has no double precision support";
+            return nullptr;
+        }
+        impl->max_constant = impl->device.getInfo<CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE>();
+
+        cl_int err = CL_SUCCESS;
+        impl->context = cl::Context(impl->device, nullptr, nullptr, nullptr, &err);
+        if (err != CL_SUCCESS) { error = cl_error("clCreateContext", err); return nullptr; }
+        // Свойство очереди задаётся при создании: профиль включается до создания движка
+        impl->profiling = common::profiling();
+        impl->queue = cl::CommandQueue(impl->context, impl->device,
+                                       impl->profiling ? CL_QUEUE_PROFILING_ENABLE : 0, &err);
+        if (err != CL_SUCCESS) { error = cl_error("clCreateCommandQueue", err); return nullptr; }
+
+        impl->cache_dir = options.cache_dir.empty() ? default_cache_dir() : options.cache_dir;
+        impl->options = options;
+        if (!impl->build_program(kernelSrc, impl->program, impl->from_cache, error)) return nullptr;
+
+        impl->kernel = cl::Kernel(impl->program, "weier_integral", &err);
+        if (err == CL_SUCCESS) impl->reduceKernel = cl::Kernel(impl->program, "weier_reduce", &err);
+        if (err == CL_SUCCESS) impl->batchKernel = cl::Kernel(impl->program, "weier_batch", &err);
+        if (err != CL_SUCCESS) { error = cl_error("clCreateKernel", err); return nullptr; }
+
+        // Размер группы — наибольшая степень двойки в пределах ядра, 256 и локальной памяти
+        impl->device_reduction = options.device_reduction;
+        impl->launch_samples = std::max<std::size_t>(options.launch_samples, 1);
+        std::size_t max_local = std::min<std::size_t>(
+            impl->reduceKernel.getWorkGroupInfo<CL_KERNEL_WORK_GROUP_SIZE>(impl->device), 256);
+        max_local = std::min<std::size_t>(max_local, impl->device.getInfo<CL_DEVICE_LOCAL_MEM_SIZE>() / sizeof(double));
+        while (impl->local_size * 2 <= max_local) impl->local_size *= 2;
+        impl->groups = std::max<std::size_t>(1, impl->device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>() * GROUPS_PER_UNIT);
+        if (!impl->create_output(error)) return nullptr;
+        return std::unique_ptr<OpenCLEngine>(new OpenCLEngine(std::move(impl)));
+    }
+
+    const std::string &OpenCLEngine::platform_name() const { return impl_->platform_name; }
+    const std::string &OpenCLEngine::device_name() const { return impl_->device_name; }
+    bool OpenCLEngine::binary_from_cache() const { return impl_->from_cache; }
+
+    // Основная функция для интегрирования функции Вейерштрасса через OpenCL
+    // plan — коэффициенты функции для (a, b, n)
+    // x0, x1 — границы интегрирования
+    // steps — количество разбиений
+    Result OpenCLEngine::integrate(const common::WeierstrassPlan &plan, double x0, double x1, std::size_t steps) {
+        if (steps == 0) return Result();
         // Вычисляем ширину шага интегрирования
         double h = (x1 - x0) / static_cast<double>(steps);
-        // Буфер для хранения результатов вычислений на GPU
-        cl::Buffer outBuf(context, CL_MEM_WRITE_ONLY, sizeof(double) * steps);
-
-        // Подготавливаем аргументы для ядра
-        double ad = a;
-        double bd = b;
-        int   nd = static_cast<int>(n);
-        double x0d = x0;
-        double hd = h;
-
-        // Устанавливаем аргументы ядра
-        kernel.setArg(0, ad);
-        kernel.setArg(1, bd);
-        kernel.setArg(2, nd);
-        kernel.setArg(3, x0d);
-        kernel.setArg(4, hd);
-        kernel.setArg(5, outBuf);
-
-        // Запускаем ядро на GPU
-        cl::NDRange globalWorkSize(steps);
-        queue.enqueueNDRangeKernel(kernel, cl::NullRange, globalWorkSize);
-        queue.finish();
-
-        // Читаем результаты вычислений из буфера
-        std::vector<double> results(steps, 0.0);
-        queue.enqueueReadBuffer(outBuf, CL_TRUE, 0, sizeof(double) * steps, results.data());
-
-        // Суммируем значения и вычисляем интеграл
-        double sum = 0.0; for (double v : results) sum += v;
-        double integral = sum * h;
+        Result result = sum_range(plan, x0, h, 0, steps);
+        result.value *= h;
+        return result;
+    }
+
+    Result OpenCLEngine::sum_range(const common::WeierstrassPlan &plan, double x0, double h,
+                                   std::size_t begin, std::size_t end) {
+        Result result;
+        Impl &e = *impl_;
+        std::lock_guard<std::mutex> lock(e.mutex);
+
+        std::size_t n = plan.n();
+        if (2 * n * sizeof(double) > e.max_constant) {
+            result.error = "Plan does not fit into constant memory";
+            return result;
+        }
+        if (begin >= end) return result;
+
+        double sum = 0.0;
+        bool ok;
+        std::string specialize_error;
+        if (!e.device_reduction) {
+            result.variant = "generic per-sample";
+            ok = e.upload_tables(plan, result.error)
+                 && e.sum_samples(static_cast<int>(n), x0, h, begin, end, plan.precision().summation,
+                                 sum, result.error);
+        } else if (Impl::Variant *v = e.variant_for(plan, x0, h, specialize_error)) {
+            // Таблицы уже вкомпилированы в программу варианта
+            result.variant = v->name;
+            ok = e.sum_reduce(v->kernel, 0, x0, h, begin, end, plan.precision().summation, sum, result.error);
+        } else if (!e.upload_tables(plan, result.error)) {
+            return result;
+        } else {
+            // Общее ядро: таблицы из буферов, n — аргумент. Подходит любому плану,
+            // поэтому сюда же идут планы, чей специализированный вариант не собрался
+            result.variant = specialize_error.empty() ? "generic"
+                                                      : "generic (specialized build failed: " + specialize_error + ")";
+            int nd = static_cast<int>(n);
+            e.reduceKernel.setArg(0, e.ampBuf);
+            e.reduceKernel.setArg(1, e.freqBuf);
+            e.reduceKernel.setArg(2, nd);
+            ok = e.sum_reduce(e.reduceKernel, 3, x0, h, begin, end, plan.precision().summation, sum,
+                              result.error);
+        }
+        if (ok) result.value = sum;
+        return result;
+    }
+
+    // Пакет за один запуск: куски заданий (не короче local_size точек на элемент
+    // группы) раздаются группам, таблицы различных планов копируются один раз
+    Result OpenCLEngine::integrate_batch(const common::IntegralJob *jobs, std::size_t count, double *results) {
+        Result result;
+        Impl &e = *impl_;
+        std::fill(results, results + count, 0.0);
+        // Устройство не следует воспроизводимому режиму, куски режутся как обычно
+        common::PrecisionPolicy precision = common::default_precision();
+        precision.reproducible = false;
+        common::BatchPlan batch(jobs, count, common::Reduction::Standard, precision);
+        if (batch.points() == 0) return result;
+        result.variant = "batch generic";
+
+        std::vector<double> amp, freq, grid(2 * count);
+        std::vector<cl_int> tables(2 * count);
+        std::map<const common::WeierstrassPlan *, cl_int> offsets;
+        for (std::size_t j = 0; j < count; ++j) {
+            const common::WeierstrassPlan &plan = batch.plan(j);
+            auto it = offsets.find(&plan);
+            if (it == offsets.end()) {
+                it = offsets.emplace(&plan, static_cast<cl_int>(amp.size())).first;
+                amp.insert(amp.end(), plan.amp(), plan.amp() + plan.n());
+                freq.insert(freq.end(), plan.freq(), plan.freq() + plan.n());
+            }
+            tables[2 * j] = it->second;
+            tables[2 * j + 1] = static_cast<cl_int>(plan.n());
+            grid[2 * j] = batch.job(j).x0;
+            grid[2 * j + 1] = batch.h(j);
+        }
+        // Буфер нулевого размера создать нельзя — при n = 0 у всех таблиц один пустой элемент
+        if (amp.empty()) {
+            amp.push_back(0.0);
+            freq.push_back(0.0);
+        }
+
+        std::lock_guard<std::mutex> lock(e.mutex);
+        std::size_t grain = std::max(batch.points() / e.groups, e.local_size * 16);
+        std::vector<common::BatchPiece> pieces = batch.pieces(0, batch.points(), grain);
+        std::vector<cl_ulong> packed(3 * pieces.size());
+        for (std::size_t p = 0; p < pieces.size(); ++p) {
+            packed[3 * p] = pieces[p].job;
+            packed[3 * p + 1] = pieces[p].begin;
+            packed[3 * p + 2] = pieces[p].end - pieces[p].begin;
+        }
+
+        cl_int err = CL_SUCCESS;
+        auto input = [&](void *data, std::size_t bytes) {
+            cl::Buffer buffer;
+            if (err == CL_SUCCESS)
+                buffer = cl::Buffer(e.context, CL_MEM_READ_ONLY | CL_MEM_COPY_HOST_PTR, bytes, data, &err);
+            return buffer;
+        };
+        cl::Buffer ampBuf = input(amp.data(), sizeof(double) * amp.size());
+        cl::Buffer freqBuf = input(freq.data(), sizeof(double) * freq.size());
+        cl::Buffer tableBuf = input(tables.data(), sizeof(cl_int) * tables.size());
+        cl::Buffer gridBuf = input(grid.data(), sizeof(double) * grid.size());
+        cl::Buffer pieceBuf = input(packed.data(), sizeof(cl_ulong) * packed.size());
+        cl::Buffer partialBuf;
+        if (err == CL_SUCCESS)
+            partialBuf = cl::Buffer(e.context, CL_MEM_WRITE_ONLY, sizeof(double) * pieces.size(), nullptr, &err);
+        if (err != CL_SUCCESS) { result.error = cl_error("clCreateBuffer (batch)", err); return result; }
+
+        cl::Kernel &k = e.batchKernel;
+        k.setArg(0, ampBuf);
+        k.setArg(1, freqBuf);
+        k.setArg(2, tableBuf);
+        k.setArg(3, gridBuf);
+        k.setArg(4, pieceBuf);
+        k.setArg(5, partialBuf);
+        k.setArg(6, cl::Local(sizeof(double) * e.local_size));
+        err = e.queue.enqueueNDRangeKernel(k, cl::NullRange, cl::NDRange(pieces.size() * e.local_size),
+                                           cl::NDRange(e.local_size), nullptr, e.track("opencl kernel"));
+        if (err != CL_SUCCESS) { result.error = cl_error("clEnqueueNDRangeKernel", err); return result; }
+        std::vector<double> partial(pieces.size());
+        err = e.queue.enqueueReadBuffer(partialBuf, CL_TRUE, 0, sizeof(double) * partial.size(), partial.data(),
+                                        nullptr, e.track("opencl read"));
+        if (err != CL_SUCCESS) { result.error = cl_error("clEnqueueReadBuffer", err); return result; }
+        if (e.profiling) e.collect();
+        batch.job_sums(pieces, partial.data(), results);
+        batch.scale(results, results);
+        return result;
+    }
+
+    OpenCLEngine *default_engine(std::string &error) {
+        static std::mutex mutex;
+        static std::unique_ptr<OpenCLEngine> engine;
+        static std::string init_error;
+        static bool initialized = false;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!initialized) {
+            engine = OpenCLEngine::create(options_from_env(), init_error);
+            initialized = true;
+        }
+        if (!engine) error = init_error;
+        return engine.get();
+    }
+
+    // Возвращает текст последней ошибки OpenCL
+    const std::string & last_error() { return g_last_error; }
+
+    double integrate_weierstrass_opencl(const common::WeierstrassPlan &plan, double x0, double x1, std::size_t steps, bool &ok) {
+        ok = false;
+        std::string error;
+        OpenCLEngine *engine = default_engine(error);
+        if (!engine) { set_error(error); return 0.0; }
+        Result r = engine->integrate(plan, x0, x1, steps);
+        if (!r.ok()) { set_error(r.error); return 0.0; }
         ok = true;
-        return integral;
+        return r.value;
+    }
+
+    double integrate_weierstrass_opencl(double a, double b, std::size_t n, double x0, double x1, std::size_t steps, bool &ok) {
+        return integrate_weierstrass_opencl(*common::weierstrass_plan(a, b, n), x0, x1, steps, ok);
     }
 }
@@ -1,9 +1,103 @@
 #pragma once
 #include <cstddef>
+#include <memory>
 #include <string>
 
+namespace common { class WeierstrassPlan; struct IntegralJob; }
+
 namespace integral_opencl {
-    // Returns integral value on success, std::nullopt on error; error message in last_error()
+    // Default picks the first GPU and falls back to any device (e.g. a CPU runtime such as PoCL)
+    enum class DeviceType { Default, GPU, CPU, Accelerator, All };
+
+    // Arithmetic of specialized kernels. Mixed keeps x and the cos argument in
+    // double, reduces arguments below 2^48 to [-pi, pi] in double (Cody-Waite)
+    // and evaluates their cos in float; larger arguments take the double cos.
+    // Sums are accumulated in double; for devices with weak fp64. It is checked
+    // against the Double variant once per parameter set and replaced by Double
+    // if it deviates too much.
+    enum class Precision { Double, Mixed };
+
+    struct EngineOptions {
+        int platform = -1;              // platform index, -1: any
+        int device = -1;                // device index within the platform, -1: first match
+        std::string platform_match;     // substring of the platform name or vendor
+        std::string device_match;       // substring of the device name
+        DeviceType type = DeviceType::Default;
+        std::string cache_dir;          // program binary cache; empty: default location, "-": disabled
+        // true: work-items and work-groups sum on the device and only one partial
+        // per group is read back; false: one value per sample is read and summed
+        // on the host. Device memory stays bounded by launch_samples either way.
+        bool device_reduction = true;
+        std::size_t launch_samples = std::size_t(1) << 24;   // samples per kernel launch
+        // Generate reduction kernels with a^k, PI*b^k and n baked in as __constant
+        // tables and a fully unrolled term loop, compiled once per parameter set
+        // (and cached on disk like the generic program). Needs device_reduction.
+        // If the build fails the call runs the generic kernel and says so in
+        // Result::variant; the failure is remembered per parameter set.
+        bool specialize = true;
+        int vector_width = 4;           // samples per work-item iteration: 1, 2 or 4 (doubleN)
+        Precision precision = Precision::Double;
+        // Mixed is accepted if the mean |mixed - double| per point is within
+        // mixed_tolerance * sum |a^k| on 2^16 points of the first call's grid.
+        // With float cos only below 2^48 the error does not grow with x: ~2e-8
+        // on the host copy of the kernel arithmetic (detail::mixed_point_host)
+        double mixed_tolerance = 1e-6;
+    };
+
+    // Options from WEIER_CL_PLATFORM / WEIER_CL_DEVICE (index or name substring),
+    // WEIER_CL_TYPE (gpu|cpu|accelerator|all), WEIER_CL_CACHE (directory or "-")
+    // and WEIER_CL_PRECISION (double|mixed)
+    EngineOptions options_from_env();
+
+    // Outcome of one call: value is meaningful only when error is empty
+    struct Result {
+        double value = 0.0;
+        std::string error;
+        std::string variant;   // kernel that ran, e.g. "n=10 double4", "generic" or
+                               // "generic (specialized build failed: ...)"
+        bool ok() const { return error.empty(); }
+    };
+
+    // Long-lived context, queue, compiled program and kernel for one device.
+    // The program binary is cached on disk, keyed by device, driver and source
+    // hash, so later processes skip the JIT. integrate() calls are serialized.
+    class OpenCLEngine {
+    public:
+        // nullptr on failure, with the reason in error
+        static std::unique_ptr<OpenCLEngine> create(const EngineOptions& options, std::string& error);
+        ~OpenCLEngine();
+        OpenCLEngine(const OpenCLEngine&) = delete;
+        OpenCLEngine& operator=(const OpenCLEngine&) = delete;
+
+        // Coefficient tables go to __constant memory. The device always uses
+        // Reduction::Standard, whatever the plan requests.
+        Result integrate(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps);
+        // Sum of the integrand at x0 + h*(i + 0.5), i in [begin, end), without the factor h
+        Result sum_range(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin, std::size_t end);
+        // results[j] = integral of jobs[j], j < count, in one launch of the generic
+        // batch kernel: every work-group sums one piece of one job and the tables
+        // of all distinct (a, b, n) go to the device once. Runs in double with
+        // Reduction::Standard; results are 0 on error.
+        Result integrate_batch(const common::IntegralJob* jobs, std::size_t count, double* results);
+
+        const std::string& platform_name() const;
+        const std::string& device_name() const;
+        // True if the program was loaded from the binary cache instead of compiled
+        bool binary_from_cache() const;
+
+    private:
+        struct Impl;
+        explicit OpenCLEngine(std::unique_ptr<Impl> impl);
+        std::unique_ptr<Impl> impl_;
+    };
+
+    // Process-wide engine built from options_from_env() on first use; nullptr
+    // (with the reason in error) if no device could be set up
+    OpenCLEngine* default_engine(std::string& error);
+
+    // Compatibility wrappers over default_engine(); the error of the last failed
+    // call is also kept in last_error()
     double integrate_weierstrass_opencl(double a, double b, std::size_t n, double x0, double x1, std::size_t steps, bool &ok);
+    double integrate_weierstrass_opencl(const common::WeierstrassPlan &plan, double x0, double x1, std::size_t steps, bool &ok);
     const std::string & last_error();
 }
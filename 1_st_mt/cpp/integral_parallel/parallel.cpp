@@ -1,73 +1,184 @@
 #include "parallel.hpp"
+#include "thread_pool.hpp"
 #include "../common/common.hpp"
+#include "../common/jobs.hpp"
+#include "../common/mapped_file.hpp"
+#include <algorithm>
+#include <memory>
 #include <vector>
-#include <thread>
-#include <thread>
 
 
 // Модуль для параллельного численного интегрирования функции Вейерштрасса
-// с использованием стандартных потоков C++ (std::thread).
+// на долгоживущем пуле потоков с кражей работы (thread_pool.hpp).
 namespace integral_parallel {
     namespace {
-        // Функция для вычисления части интеграла на диапазоне [begin, end).
-        // Результат записывается по адресу out.
-        void weierstrass_chunk(double a, double b, std::size_t n, double x0, double h,
-                              std::size_t begin, std::size_t end, double* out) {
-            double local = 0.0;
-            for (std::size_t i = begin; i < end; ++i) {
-                // Вычисляем значение функции Вейерштрасса в точке x
-                double x = x0 + h * (static_cast<double>(i) + 0.5);
-                local += common::weierstrass(x, a, b, n);
-            }
-            *out = local;
+        // Задач на исполнителя при автоматическом выборе зерна: хватает для
+        // балансировки, а накладные расходы на задачу остаются малыми
+        constexpr std::size_t TASKS_PER_WORKER = 8;
+
+        // Частичная сумма исполнителя в своей строке кэша (без ложного разделения)
+        struct alignas(ThreadPool::CACHE_LINE) Accumulator {
+            common::RunningSum sum;
+        };
+
+        std::size_t round_up(std::size_t v, std::size_t m) { return (v + m - 1) / m * m; }
+    }
+
+    // Суммы блоков [first, last) воспроизводимого режима: задача — несколько
+    // целых блоков, сумма блока пишется в свою ячейку
+    void block_sums(const common::RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end,
+                    std::size_t first, std::size_t last, double* out, ThreadPool& pool, std::size_t grain) {
+        if (first >= last) return;
+        std::size_t blocks = last - first;
+        std::size_t per_task = grain == 0 ? blocks / (pool.size() * TASKS_PER_WORKER)
+                                          : (grain + common::REPRO_BLOCK - 1) / common::REPRO_BLOCK;
+        per_task = std::max<std::size_t>(per_task, 1);
+        pool.run((blocks + per_task - 1) / per_task, [&](std::size_t task, unsigned) {
+            std::size_t lo = task * per_task;
+            std::size_t hi = std::min(lo + per_task, blocks);
+            common::block_sums(sum, x0, h, begin, end, first + lo, first + hi, out + lo);
+        });
+    }
+
+    // Сумма значений в точках x0 + h*(i + 0.5), i в [begin, end)
+    // pool — пул исполнителей, grain — точек на задачу (0 — выбрать автоматически)
+    double sum_range(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double h,
+                     std::size_t begin, std::size_t end, ThreadPool& pool, std::size_t grain) {
+        if (begin >= end) return 0.0;
+        // Воспроизводимый режим: ячейки блоков складываются фиксированным деревом
+        if (precision.reproducible) {
+            std::vector<double> sums(common::reproducible_block_count(begin, end));
+            block_sums(sum, x0, h, begin, end, 0, sums.size(), sums.data(), pool, grain);
+            return common::reproducible_tree_sum(sums.data(), sums.size());
         }
+        std::size_t count = end - begin;
+
+        // Зерно кратно BATCH_BLOCK: границы задач совпадают с блоками ядра
+        // и с сегментами пересева рекуррентного поворота
+        if (grain == 0) grain = count / (pool.size() * TASKS_PER_WORKER);
+        grain = round_up(std::max<std::size_t>(grain, 1), common::BATCH_BLOCK);
+        std::size_t tasks = (count + grain - 1) / grain;
+
+        common::Summation mode = precision.summation;
+        std::unique_ptr<Accumulator[]> acc(new Accumulator[pool.size()]);
+        for (unsigned w = 0; w < pool.size(); ++w) acc[w].sum = common::RunningSum(mode);
+        pool.run(tasks, [&](std::size_t task, unsigned worker) {
+            std::size_t lo = begin + task * grain;
+            std::size_t hi = std::min(lo + grain, end);
+            acc[worker].sum.add(sum(x0, h, lo, hi));
+        });
+
+        // Суммируем результаты сначала внутри NUMA-узлов, затем по узлам
+        std::vector<common::RunningSum> node_sum(pool.nodes(), common::RunningSum(mode));
+        for (unsigned w = 0; w < pool.size(); ++w) node_sum[pool.node(w)].add(acc[w].sum.value());
+        common::RunningSum total(mode);
+        for (const auto& v : node_sum) total.add(v.value());
+        return total.value();
+    }
+
+    void weierstrass_block_sums(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                std::size_t end, std::size_t first, std::size_t last, double* out,
+                                ThreadPool& pool, std::size_t grain) {
+        common::PlanIntegrand f(plan);
+        block_sums(common::range_sum(f), x0, h, begin, end, first, last, out, pool, grain);
+    }
+
+    // Точки диапазона вычисляются рекуррентным поворотом и SIMD-ядром (common::PlanIntegrand)
+    double sum_weierstrass_range(const common::WeierstrassPlan& plan, double x0, double h,
+                                 std::size_t begin, std::size_t end, ThreadPool& pool, std::size_t grain) {
+        common::PlanIntegrand f(plan);
+        return sum_range(common::range_sum(f), plan.precision(), x0, h, begin, end, pool, grain);
     }
 
     // Основная функция для параллельного интегрирования.
-    // a, b, n — параметры функции Вейерштрасса
+    // plan — коэффициенты функции Вейерштрасса для (a, b, n)
     // x0, x1 — границы интегрирования
     // steps — количество разбиений (шагов интегрирования)
-    double integrate_weierstrass_parallel(double a, double b, std::size_t n,
+    double integrate_weierstrass_parallel(const common::WeierstrassPlan& plan, double x0, double x1,
+                                          std::size_t steps, ThreadPool& pool, std::size_t grain) {
+        return integrate(common::PlanIntegrand(plan), x0, x1, steps, pool, grain);
+    }
+
+    double integrate_weierstrass_parallel(const common::WeierstrassPlan& plan,
                                           double x0, double x1, std::size_t steps) {
-        // hw — количество аппаратных потоков (ядер/логических процессоров)
-        unsigned hw = std::thread::hardware_concurrency();
-        if (hw == 0) hw = 4; // если не удалось определить, используем 4 потока
-
-        // threads — итоговое количество потоков (не больше, чем шагов)
-        std::size_t threads = std::min<std::size_t>(hw, steps);
-
-        // chunk — базовое количество шагов на поток
-        std::size_t chunk = steps / threads;
-        // remainder — сколько потоков получат на 1 шаг больше (для равномерного распределения)
-        std::size_t remainder = steps % threads;
-
-        // h — ширина одного шага интегрирования
-        double h = (x1 - x0) / static_cast<double>(steps);
-
-        // results — массив для хранения результата каждого потока
-        std::vector<double> results(threads, 0.0);
-        // workers — массив потоков
-        std::vector<std::thread> workers;
-
-        // start — индекс первого шага для текущего потока
-        std::size_t start = 0;
-        for (std::size_t t = 0; t < threads; ++t) {
-            // size — количество шагов для текущего потока
-            std::size_t size = chunk + (t < remainder ? 1 : 0);
-            std::size_t begin = start;
-            std::size_t end = begin + size;
-            start = end;
-            // Запускаем поток, вычисляющий свою часть интеграла
-            workers.emplace_back(weierstrass_chunk, a, b, n, x0, h, begin, end, &results[t]);
-        }
-        // Ожидаем завершения всех потоков
-        for (auto& th : workers) th.join();
+        return integrate_weierstrass_parallel(plan, x0, x1, steps, default_pool());
+    }
+
+    // Таблица первообразной: первый проход — суммы участков и частичные суммы
+    // внутри куска, затем последовательный скан итогов кусков, второй проход —
+    // сдвиг куска на его смещение и множитель h
+    std::string cumulative(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0,
+                           double x1, std::size_t count, std::size_t steps_per_point, double* out, ThreadPool& pool,
+                           std::size_t grain) {
+        std::string error = common::cumulative_check(count, steps_per_point);
+        if (!error.empty()) return error;
+        double h = (x1 - x0) / static_cast<double>(count * steps_per_point);
+        grain = common::cumulative_grain(precision, count, steps_per_point, pool.size(), grain);
+        std::size_t chunks = (count + grain - 1) / grain;
+        std::vector<double> totals(chunks), offsets(chunks);
+        pool.run(chunks, [&](std::size_t c, unsigned) {
+            std::size_t lo = c * grain;
+            std::size_t hi = std::min(lo + grain, count);
+            totals[c] = common::cumulative_chunk(sum, precision, x0, h, steps_per_point, lo, hi, out + lo);
+        });
+        common::cumulative_offsets(precision, totals.data(), chunks, offsets.data());
+        pool.run(chunks, [&](std::size_t c, unsigned) {
+            std::size_t lo = c * grain;
+            std::size_t hi = std::min(lo + grain, count);
+            for (std::size_t j = lo; j < hi; ++j) out[j] = (out[j] + offsets[c]) * h;
+        });
+        return "";
+    }
+
+    std::string cumulative_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                       std::size_t steps_per_point, double* out, ThreadPool& pool,
+                                       std::size_t grain) {
+        return cumulative(common::PlanIntegrand(plan), x0, x1, count, steps_per_point, out, pool, grain);
+    }
+
+    std::string cumulative_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                       std::size_t steps_per_point, double* out) {
+        return cumulative_weierstrass(plan, x0, x1, count, steps_per_point, out, default_pool());
+    }
+
+    // Таблица пишется прямо в отображённый файл, без промежуточного буфера
+    std::string cumulative_weierstrass_file(const common::WeierstrassPlan& plan, double x0, double x1,
+                                            std::size_t count, std::size_t steps_per_point, const std::string& path,
+                                            ThreadPool& pool, std::size_t grain) {
+        // Проверка до создания файла: пустой или неверный запрос не трогает path
+        std::string error = common::cumulative_check(count, steps_per_point);
+        if (!error.empty()) return error;
+        common::MappedFile file;
+        error = file.create(path, count * sizeof(double));
+        if (!error.empty()) return error;
+        cumulative_weierstrass(plan, x0, x1, count, steps_per_point, static_cast<double*>(file.data()), pool, grain);
+        return file.sync();
+    }
+
+    // Пакет: куски всех заданий раздаются одним запуском пула, сумма куска
+    // пишется в свою ячейку и складывается по заданиям в порядке кусков
+    void sum_weierstrass_batch(const common::BatchPlan& batch, std::size_t lo, std::size_t hi, double* out,
+                               ThreadPool& pool, std::size_t grain) {
+        if (grain == 0) grain = std::max<std::size_t>((hi - lo) / (pool.size() * TASKS_PER_WORKER), common::BATCH_BLOCK);
+        std::vector<common::BatchPiece> pieces = batch.pieces(lo, hi, grain);
+        std::vector<double> sums(pieces.size());
+        pool.run(pieces.size(), [&](std::size_t task, unsigned) { sums[task] = batch.sum(pieces[task]); });
+        batch.job_sums(pieces, sums.data(), out);
+    }
+
+    void integrate_weierstrass_batch_parallel(const common::IntegralJob* jobs, std::size_t count, double* results,
+                                              ThreadPool& pool, std::size_t grain) {
+        common::BatchPlan batch(jobs, count);
+        sum_weierstrass_batch(batch, 0, batch.points(), results, pool, grain);
+        batch.scale(results, results);
+    }
 
-        // Суммируем результаты всех потоков
-        double total = 0.0;
-        for (double v : results) total += v;
+    void integrate_weierstrass_batch_parallel(const common::IntegralJob* jobs, std::size_t count, double* results) {
+        integrate_weierstrass_batch_parallel(jobs, count, results, default_pool());
+    }
 
-        // Возвращаем итоговый результат интегрирования
-        return total * h;
+    double integrate_weierstrass_parallel(double a, double b, std::size_t n,
+                                          double x0, double x1, std::size_t steps) {
+        return integrate_weierstrass_parallel(*common::weierstrass_plan(a, b, n), x0, x1, steps);
     }
 }
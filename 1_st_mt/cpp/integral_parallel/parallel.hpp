@@ -1,6 +1,81 @@
 #pragma once
 #include <cstddef>
+#include <string>
+#include "../common/integrand.hpp"
+#include "thread_pool.hpp"
+
+namespace common { class BatchPlan; struct IntegralJob; }
 
 namespace integral_parallel {
+    // Sum of a range sum (see common/integrand.hpp) over [begin, end) on the
+    // pool, without the factor h; grain — points per task, rounded up to a
+    // multiple of common::BATCH_BLOCK (0: from the range and pool size)
+    double sum_range(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double h,
+                     std::size_t begin, std::size_t end, ThreadPool& pool, std::size_t grain = 0);
+    // common::block_sums for blocks [first, last) spread over the pool
+    void block_sums(const common::RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end,
+                    std::size_t first, std::size_t last, double* out, ThreadPool& pool, std::size_t grain = 0);
+
+    // Midpoint rule over any integrand, e.g. common::WeierstrassN<30>() or a lambda
+    template <class F>
+    double integrate(const F& f, double x0, double x1, std::size_t steps, ThreadPool& pool, std::size_t grain = 0) {
+        double h = (x1 - x0) / static_cast<double>(steps);
+        return sum_range(common::range_sum(f), common::precision_of(f), x0, h, 0, steps, pool, grain) * h;
+    }
+    template <class F>
+    double integrate(const F& f, double x0, double x1, std::size_t steps) {
+        return integrate(f, x0, x1, steps, default_pool());
+    }
+
+    // Cumulative integral table: out[j] = integral from x0 to x0 + (j + 1) * (x1 - x0) / count,
+    // j < count, by the midpoint rule with steps_per_point points in each of the
+    // count sections (the grid of count * steps_per_point steps, steps_per_point >= 1). Every point is
+    // evaluated once: tasks take chunks of grain sections (common::cumulative_grain),
+    // write the chunk's running sums, the chunk totals are scanned, and a second
+    // pool run adds each chunk's offset and the factor h. Returns "" or the
+    // error of common::cumulative_check, leaving out untouched.
+    std::string cumulative(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double x1,
+                    std::size_t count, std::size_t steps_per_point, double* out, ThreadPool& pool,
+                    std::size_t grain = 0);
+    template <class F>
+    std::string cumulative(const F& f, double x0, double x1, std::size_t count, std::size_t steps_per_point,
+                           double* out, ThreadPool& pool, std::size_t grain = 0) {
+        return cumulative(common::range_sum(f), common::precision_of(f), x0, x1, count, steps_per_point, out, pool, grain);
+    }
+    std::string cumulative_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                       std::size_t steps_per_point, double* out);
+    std::string cumulative_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t count,
+                                       std::size_t steps_per_point, double* out, ThreadPool& pool,
+                                       std::size_t grain = 0);
+    // Same table written into path as count doubles in native byte order, through
+    // a common::MappedFile; returns "" or an error message
+    std::string cumulative_weierstrass_file(const common::WeierstrassPlan& plan, double x0, double x1,
+                                            std::size_t count, std::size_t steps_per_point, const std::string& path,
+                                            ThreadPool& pool, std::size_t grain = 0);
+
+    // The Weierstrass function through its plan (common::PlanIntegrand)
+    // Runs on default_pool(); grain == 0 picks the task size from steps and pool size
     double integrate_weierstrass_parallel(double a, double b, std::size_t n, double x0, double x1, std::size_t steps);
+    double integrate_weierstrass_parallel(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps);
+    // grain — midpoints per task, rounded up to a multiple of common::BATCH_BLOCK
+    double integrate_weierstrass_parallel(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                          ThreadPool& pool, std::size_t grain = 0);
+    // Sum of the integrand at x0 + h*(i + 0.5), i in [begin, end), without the factor h
+    double sum_weierstrass_range(const common::WeierstrassPlan& plan, double x0, double h,
+                                 std::size_t begin, std::size_t end, ThreadPool& pool, std::size_t grain = 0);
+    // common::weierstrass_block_sums for blocks [first, last) spread over the pool
+    void weierstrass_block_sums(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                std::size_t end, std::size_t first, std::size_t last, double* out,
+                                ThreadPool& pool, std::size_t grain = 0);
+
+    // results[j] = integral of jobs[j], j < count, in one pool run: jobs are cut
+    // into pieces of at most grain points (0: from the batch size and pool size)
+    // and small jobs go whole to a task
+    void integrate_weierstrass_batch_parallel(const common::IntegralJob* jobs, std::size_t count, double* results);
+    void integrate_weierstrass_batch_parallel(const common::IntegralJob* jobs, std::size_t count, double* results,
+                                              ThreadPool& pool, std::size_t grain = 0);
+    // out[j] = sum of job j's grid points in the concatenated range [lo, hi) of
+    // the batch (lo <= hi <= batch.points()), without the factor h; one pool run
+    void sum_weierstrass_batch(const common::BatchPlan& batch, std::size_t lo, std::size_t hi, double* out,
+                               ThreadPool& pool, std::size_t grain = 0);
 }
@@ -0,0 +1,188 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+// Пул потоков с кражей работы. Каждый исполнитель держит в своей строке кэша
+// оставшийся диапазон задач [begin, end), упакованный в одно 64-битное слово:
+// владелец забирает задачи спереди, вор — заднюю половину, оба через CAS,
+// поэтому блокировки нужны только для пробуждения и ожидания потоков.
+namespace integral_parallel {
+    namespace {
+        constexpr std::size_t MAX_ROUND = 0xFFFFFFFFu;   // задач за раунд: индексы — 32 бита
+
+        std::uint64_t pack(std::uint64_t begin, std::uint64_t end) { return begin << 32 | end; }
+        std::size_t range_begin(std::uint64_t r) { return static_cast<std::size_t>(r >> 32); }
+        std::size_t range_end(std::uint64_t r) { return static_cast<std::size_t>(r & 0xFFFFFFFFu); }
+
+        unsigned default_threads(common::Placement placement) {
+            if (const char* env = std::getenv("WEIER_THREADS")) {
+                unsigned long v = std::strtoul(env, nullptr, 10);
+                if (v > 0) return static_cast<unsigned>(v);
+            }
+            if (placement != common::Placement::None) return common::Topology::system().capacity(placement);
+            unsigned hw = std::thread::hardware_concurrency();
+            return hw == 0 ? 4 : hw;   // если не удалось определить, используем 4 потока
+        }
+    }
+
+    ThreadPool::ThreadPool(unsigned threads, common::Placement placement, unsigned first_cpu)
+        : size_(threads == 0 ? default_threads(placement) : threads), placement_(placement),
+          cpus_(common::Topology::system().assign(placement, size_, first_cpu)), node_(size_, 0),
+          victims_(size_), slots_(new Slot[size_]) {
+        for (unsigned id = 0; id < cpus_.size(); ++id) {
+            node_[id] = static_cast<unsigned>(cpus_[id].node);
+            nodes_ = std::max(nodes_, node_[id] + 1);
+        }
+        // Порядок кражи: сначала свой узел, затем остальные, по кругу от себя
+        for (unsigned id = 0; id < size_; ++id) {
+            for (int pass = 0; pass < 2; ++pass) {
+                for (unsigned i = 1; i < size_; ++i) {
+                    unsigned v = (id + i) % size_;
+                    if ((node_[v] == node_[id]) == (pass == 0)) victims_[id].push_back(v);
+                }
+            }
+        }
+        // Исполнитель 0 — вызывающий поток, фоновые потоки — 1..size_-1
+        for (unsigned id = 1; id < size_; ++id) threads_.emplace_back(&ThreadPool::worker_loop, this, id);
+    }
+
+    std::string ThreadPool::describe() const {
+        return common::describe_placement(placement_, size_, cpus_);
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (auto& th : threads_) th.join();
+    }
+
+    bool ThreadPool::pop(unsigned id, std::size_t& task) {
+        auto& range = slots_[id].range;
+        std::uint64_t r = range.load(std::memory_order_acquire);
+        while (range_begin(r) < range_end(r)) {
+            if (range.compare_exchange_weak(r, pack(range_begin(r) + 1, range_end(r)), std::memory_order_acq_rel)) {
+                task = range_begin(r);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool ThreadPool::steal(unsigned id, std::size_t& task) {
+        for (unsigned v : victims_[id]) {
+            auto& victim = slots_[v].range;
+            std::uint64_t r = victim.load(std::memory_order_acquire);
+            while (range_begin(r) < range_end(r)) {
+                // Вор забирает [mid, end): первую задачу выполняет сам, остальное кладёт к себе
+                std::size_t begin = range_begin(r), end = range_end(r);
+                std::size_t mid = begin + (end - begin) / 2;
+                if (victim.compare_exchange_weak(r, pack(begin, mid), std::memory_order_acq_rel)) {
+                    slots_[id].range.store(pack(mid + 1, end), std::memory_order_release);
+                    task = mid;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void ThreadPool::drain(unsigned id, const std::function<void(std::size_t, unsigned)>& fn,
+                           common::RunProfile* profile) {
+        std::size_t task;
+        if (!profile) {
+            while (pop(id, task) || steal(id, task)) fn(task, id);
+            return;
+        }
+        profile->enter(id);
+        while (pop(id, task) || steal(id, task)) {
+            auto t = profile->clock();
+            fn(task, id);
+            profile->busy(id, t);
+        }
+        profile->leave(id);
+    }
+
+    void ThreadPool::worker_loop(unsigned id) {
+        if (!cpus_.empty()) common::pin_current_thread(cpus_[id].cpu);
+        std::uint64_t seen = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            wake_.wait(lock, [&] { return stop_ || (job_ && generation_ != seen); });
+            if (stop_) return;
+            seen = generation_;
+            const auto* job = job_;
+            common::RunProfile* profile = profile_;
+            ++inside_;
+            lock.unlock();
+
+            drain(id, *job, profile);
+
+            lock.lock();
+            if (--inside_ == 0) done_.notify_one();
+        }
+    }
+
+    void ThreadPool::run(std::size_t tasks, const std::function<void(std::size_t, unsigned)>& fn) {
+        std::lock_guard<std::mutex> serial(run_mutex_);
+        common::ScopedPin pin(cpus_.empty() ? -1 : cpus_[0].cpu);
+        for (std::size_t base = 0; base < tasks; base += MAX_ROUND) {
+            std::size_t count = std::min(tasks - base, MAX_ROUND);
+            std::function<void(std::size_t, unsigned)> shifted;
+            const auto* job = &fn;
+            if (base != 0) {
+                shifted = [&fn, base](std::size_t task, unsigned worker) { fn(base + task, worker); };
+                job = &shifted;
+            }
+
+            // Профиль раунда; без профилирования — ни выделений, ни замеров
+            common::RunProfile profile("pool", size_);
+
+            // Одна задача или один исполнитель — без пробуждения пула
+            if (count == 1 || size_ == 1) {
+                profile.enter(0);
+                auto since = profile.clock();
+                for (std::size_t t = 0; t < count; ++t) (*job)(t, 0);
+                profile.busy(0, since, count);
+                profile.leave(0);
+                profile.finish();
+                continue;
+            }
+
+            // Начальное разбиение: равные смежные диапазоны по исполнителям
+            std::size_t chunk = count / size_, remainder = count % size_, start = 0;
+            for (unsigned id = 0; id < size_; ++id) {
+                std::size_t size = chunk + (id < remainder ? 1 : 0);
+                slots_[id].range.store(pack(start, start + size), std::memory_order_relaxed);
+                start += size;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                job_ = job;
+                profile_ = profile.active() ? &profile : nullptr;
+                ++generation_;
+            }
+            wake_.notify_all();
+
+            drain(0, *job, profile_);
+
+            // Задачи, которых не видно в диапазонах, уже у воров внутри задания:
+            // после выхода всех фоновых исполнителей работа завершена.
+            // Опоздавшие потоки увидят job_ == nullptr и не войдут.
+            std::unique_lock<std::mutex> lock(mutex_);
+            done_.wait(lock, [&] { return inside_ == 0; });
+            job_ = nullptr;
+            profile_ = nullptr;
+            lock.unlock();
+            profile.finish();
+        }
+    }
+
+    ThreadPool& default_pool() {
+        static ThreadPool pool(0, common::default_placement());
+        return pool;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../common/profile.hpp"
+#include "../common/topology.hpp"
+
+namespace integral_parallel {
+    // Long-lived pool of work-stealing workers. The thread calling run() takes
+    // part as worker 0, so a pool of size() == 1 has no background threads.
+    // run() calls from different threads are serialized; calling run() from
+    // inside a task deadlocks. With a placement other than None, background
+    // workers are pinned for their lifetime and the caller for the duration of
+    // run(); idle workers steal within their NUMA node first.
+    class ThreadPool {
+    public:
+        static constexpr std::size_t CACHE_LINE = 64;
+
+        // threads == 0: WEIER_THREADS from the environment, else the hardware
+        // threads the placement can use (hardware_concurrency() for None).
+        // first_cpu: first slot of common::Topology::assign the workers take
+        explicit ThreadPool(unsigned threads = 0, common::Placement placement = common::Placement::None,
+                            unsigned first_cpu = 0);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        unsigned size() const { return size_; }
+        common::Placement placement() const { return placement_; }
+        // NUMA node of a worker (0 when unpinned) and the number of nodes in use
+        unsigned node(unsigned worker) const { return node_[worker]; }
+        unsigned nodes() const { return nodes_; }
+        // Placement summary for reports, see common::describe_placement
+        std::string describe() const;
+
+        // Calls fn(task, worker) once for every task in [0, tasks), worker < size().
+        // Tasks start as contiguous per-worker ranges; idle workers steal the
+        // back half of another worker's range. With common::profiling() on, every
+        // run records busy / idle / startup time per worker as group "pool <size()>".
+        void run(std::size_t tasks, const std::function<void(std::size_t, unsigned)>& fn);
+
+    private:
+        // Remaining range of one worker, packed as begin << 32 | end
+        struct alignas(CACHE_LINE) Slot {
+            std::atomic<std::uint64_t> range{0};
+        };
+
+        void worker_loop(unsigned id);
+        void drain(unsigned id, const std::function<void(std::size_t, unsigned)>& fn,
+                   common::RunProfile* profile);
+        bool pop(unsigned id, std::size_t& task);
+        bool steal(unsigned id, std::size_t& task);
+
+        unsigned size_;
+        common::Placement placement_;
+        std::vector<common::CpuInfo> cpus_;         // per worker, empty for None
+        std::vector<unsigned> node_;
+        unsigned nodes_ = 1;
+        std::vector<std::vector<unsigned>> victims_;   // steal order: own node first
+        std::unique_ptr<Slot[]> slots_;
+        std::vector<std::thread> threads_;
+
+        std::mutex run_mutex_;                      // one job at a time
+        std::mutex mutex_;                          // guards the fields below
+        std::condition_variable wake_, done_;
+        const std::function<void(std::size_t, unsigned)>* job_ = nullptr;
+        common::RunProfile* profile_ = nullptr;    // of the current job, while profiling
+        std::uint64_t generation_ = 0;
+        unsigned inside_ = 0;                       // background workers in the current job
+        bool stop_ = false;
+    };
+
+    // Process-wide pool used by the overloads without an explicit pool;
+    // placement from WEIER_PLACEMENT (see common::default_placement)
+    ThreadPool& default_pool();
+}
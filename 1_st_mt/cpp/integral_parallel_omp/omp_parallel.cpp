@@ -1,17 +1,232 @@
 #include "omp_parallel.hpp"
 #include "../common/common.hpp"
+#include "../common/jobs.hpp"
+#include "../common/profile.hpp"
 #include <omp.h>
+#include <algorithm>
 #include <cmath>
+#include <memory>
+#include <vector>
 
 namespace integral_parallel_omp {
+    namespace {
+        // Частичная сумма потока в своей строке кэша
+        struct alignas(64) Accumulator {
+            double sum = 0.0;
+        };
+
+        // Частичные суммы в режиме суммирования плана
+        double total_of(const std::vector<double>& parts, common::Summation mode) {
+            common::RunningSum total(mode);
+            total.add(parts.data(), parts.size());
+            return total.value();
+        }
+
+        unsigned thread_count(const OmpOptions& options) {
+            if (options.threads != 0) return options.threads;
+            if (options.placement != common::Placement::None)
+                return common::Topology::system().capacity(options.placement);
+            return static_cast<unsigned>(omp_get_max_threads());
+        }
+
+        // CPU потока t команды, пусто без закрепления
+        std::vector<common::CpuInfo> team_cpus(const OmpOptions& options, unsigned threads) {
+            return common::Topology::system().assign(options.placement, threads, options.first_cpu);
+        }
+    }
+
+    OmpOptions default_options() {
+        OmpOptions options;
+        options.placement = common::default_placement();
+        return options;
+    }
+
+    std::string describe(const OmpOptions& options) {
+        unsigned threads = thread_count(options);
+        return common::describe_placement(options.placement, threads, team_cpus(options, threads));
+    }
+
+    void block_sums_omp(const common::RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end,
+                        std::size_t first, std::size_t last, double* out, const OmpOptions& options) {
+        unsigned threads = thread_count(options);
+        // Поток t закрепляется за cpus[t] на время параллельной области
+        std::vector<common::CpuInfo> cpus = team_cpus(options, threads);
+        long long count = static_cast<long long>(last - first);
+        common::RunProfile profile("openmp", threads);
+        #pragma omp parallel num_threads(threads)
+        {
+            int tid = omp_get_thread_num();
+            common::ScopedPin pin(cpus.empty() ? -1 : cpus[tid].cpu);
+            profile.enter(tid);
+            auto since = profile.clock();
+            std::size_t done = 0;
+            // nowait: ожидание остальных на конце области — простой, а не работа
+            #pragma omp for schedule(static) nowait
+            for (long long i = 0; i < count; ++i) {
+                std::size_t j = first + static_cast<std::size_t>(i);
+                common::block_sums(sum, x0, h, begin, end, j, j + 1, out + i);
+                ++done;
+            }
+            profile.busy(tid, since, done);
+            profile.leave(tid);
+        }
+        profile.finish();
+    }
+
+    double sum_range_omp(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double h,
+                         std::size_t begin, std::size_t end, const OmpOptions& options) {
+        if (begin >= end) return 0.0;
+        // Воспроизводимый режим: итерация — блок REPRO_BLOCK со своей ячейкой,
+        // ячейки складываются фиксированным деревом
+        if (precision.reproducible) {
+            std::vector<double> sums(common::reproducible_block_count(begin, end));
+            block_sums_omp(sum, x0, h, begin, end, 0, sums.size(), sums.data(), options);
+            return common::reproducible_tree_sum(sums.data(), sums.size());
+        }
+
+        unsigned threads = thread_count(options);
+        // Поток t закрепляется за cpus[t] на время параллельной области
+        std::vector<common::CpuInfo> cpus = team_cpus(options, threads);
+        std::unique_ptr<Accumulator[]> acc(new Accumulator[threads]);
+
+        // Итерация — блок из BATCH_BLOCK точек
+        long long blocks = static_cast<long long>((end - begin + common::BATCH_BLOCK - 1) / common::BATCH_BLOCK);
+        common::RunProfile profile("openmp", threads);
+        #pragma omp parallel num_threads(threads)
+        {
+            int tid = omp_get_thread_num();
+            common::ScopedPin pin(cpus.empty() ? -1 : cpus[tid].cpu);
+            profile.enter(tid);
+            auto since = profile.clock();
+            std::size_t done = 0;
+            common::RunningSum local(precision.summation);
+            #pragma omp for schedule(static) nowait
+            for (long long blk = 0; blk < blocks; ++blk) {
+                std::size_t lo = begin + static_cast<std::size_t>(blk) * common::BATCH_BLOCK;
+                std::size_t hi = std::min(lo + common::BATCH_BLOCK, end);
+                local.add(sum(x0, h, lo, hi));
+                ++done;
+            }
+            acc[tid].sum = local.value();
+            profile.busy(tid, since, done);
+            profile.leave(tid);
+        }
+        profile.finish();
+
+        // Сначала суммы внутри NUMA-узлов, затем по узлам
+        int nodes = cpus.empty() ? 1 : common::Topology::system().nodes();
+        std::vector<std::vector<double>> node_parts(nodes);
+        for (unsigned t = 0; t < threads; ++t) node_parts[cpus.empty() ? 0 : cpus[t].node].push_back(acc[t].sum);
+        std::vector<double> node_sum;
+        for (const auto& parts : node_parts) node_sum.push_back(total_of(parts, precision.summation));
+        return total_of(node_sum, precision.summation);
+    }
+
+    void weierstrass_block_sums_omp(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                    std::size_t end, std::size_t first, std::size_t last, double* out,
+                                    const OmpOptions& options) {
+        common::PlanIntegrand f(plan);
+        block_sums_omp(common::range_sum(f), x0, h, begin, end, first, last, out, options);
+    }
+
+    // Точки вычисляются рекуррентным поворотом и SIMD-ядром (common::PlanIntegrand)
+    double sum_weierstrass_range_omp(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                     std::size_t end, const OmpOptions& options) {
+        common::PlanIntegrand f(plan);
+        return sum_range_omp(common::range_sum(f), plan.precision(), x0, h, begin, end, options);
+    }
+
+    // Таблица первообразной в одной параллельной области: куски по итерации,
+    // скан итогов кусков — один поток (omp single с неявным барьером), затем сдвиг кусков
+    std::string cumulative_omp(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0,
+                               double x1, std::size_t count, std::size_t steps_per_point, double* out,
+                               const OmpOptions& options, std::size_t grain) {
+        std::string error = common::cumulative_check(count, steps_per_point);
+        if (!error.empty()) return error;
+        unsigned threads = thread_count(options);
+        std::vector<common::CpuInfo> cpus = team_cpus(options, threads);
+        double h = (x1 - x0) / static_cast<double>(count * steps_per_point);
+        grain = common::cumulative_grain(precision, count, steps_per_point, threads, grain);
+        long long chunks = static_cast<long long>((count + grain - 1) / grain);
+        std::vector<double> totals(chunks), offsets(chunks);
+        #pragma omp parallel num_threads(threads)
+        {
+            common::ScopedPin pin(cpus.empty() ? -1 : cpus[omp_get_thread_num()].cpu);
+            #pragma omp for schedule(dynamic)
+            for (long long c = 0; c < chunks; ++c) {
+                std::size_t lo = static_cast<std::size_t>(c) * grain;
+                std::size_t hi = std::min(lo + grain, count);
+                totals[c] = common::cumulative_chunk(sum, precision, x0, h, steps_per_point, lo, hi, out + lo);
+            }
+            #pragma omp single
+            common::cumulative_offsets(precision, totals.data(), totals.size(), offsets.data());
+            #pragma omp for schedule(static)
+            for (long long c = 0; c < chunks; ++c) {
+                std::size_t lo = static_cast<std::size_t>(c) * grain;
+                std::size_t hi = std::min(lo + grain, count);
+                for (std::size_t j = lo; j < hi; ++j) out[j] = (out[j] + offsets[c]) * h;
+            }
+        }
+        return "";
+    }
+
+    std::string cumulative_weierstrass_omp(const common::WeierstrassPlan& plan, double x0, double x1,
+                                           std::size_t count, std::size_t steps_per_point, double* out,
+                                           const OmpOptions& options) {
+        return cumulative_omp(common::PlanIntegrand(plan), x0, x1, count, steps_per_point, out, options);
+    }
+
+    // Пакет: одна параллельная область на куски всех заданий; куски разной
+    // длины, поэтому schedule(dynamic)
+    void sum_weierstrass_batch_omp(const common::BatchPlan& batch, std::size_t lo, std::size_t hi, double* out,
+                                   const OmpOptions& options) {
+        unsigned threads = thread_count(options);
+        std::vector<common::CpuInfo> cpus = team_cpus(options, threads);
+        std::size_t grain = std::max<std::size_t>((hi - lo) / (threads * 8), common::BATCH_BLOCK);
+        std::vector<common::BatchPiece> pieces = batch.pieces(lo, hi, grain);
+        std::vector<double> sums(pieces.size());
+        long long count = static_cast<long long>(pieces.size());
+        common::RunProfile profile("openmp", threads);
+        #pragma omp parallel num_threads(threads)
+        {
+            int tid = omp_get_thread_num();
+            common::ScopedPin pin(cpus.empty() ? -1 : cpus[tid].cpu);
+            profile.enter(tid);
+            auto since = profile.clock();
+            std::size_t done = 0;
+            #pragma omp for schedule(dynamic) nowait
+            for (long long p = 0; p < count; ++p) {
+                sums[p] = batch.sum(pieces[p]);
+                ++done;
+            }
+            profile.busy(tid, since, done);
+            profile.leave(tid);
+        }
+        profile.finish();
+        batch.job_sums(pieces, sums.data(), out);
+    }
+
+    void integrate_weierstrass_batch_omp(const common::IntegralJob* jobs, std::size_t count, double* results,
+                                         const OmpOptions& options) {
+        common::BatchPlan batch(jobs, count);
+        sum_weierstrass_batch_omp(batch, 0, batch.points(), results, options);
+        batch.scale(results, results);
+    }
+
+    void integrate_weierstrass_batch_omp(const common::IntegralJob* jobs, std::size_t count, double* results) {
+        integrate_weierstrass_batch_omp(jobs, count, results, default_options());
+    }
+
+    double integrate_weierstrass_parallel_omp(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                              const OmpOptions& options) {
+        return integrate_omp(common::PlanIntegrand(plan), x0, x1, steps, options);
+    }
+
+    double integrate_weierstrass_parallel_omp(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps) {
+        return integrate_weierstrass_parallel_omp(plan, x0, x1, steps, default_options());
+    }
+
     double integrate_weierstrass_parallel_omp(double a, double b, std::size_t n, double x0, double x1, std::size_t steps) {
-        double h = (x1 - x0) / static_cast<double>(steps);
-        double total = 0.0;
-        #pragma omp parallel for reduction(+:total) schedule(static)
-        for (long long i = 0; i < static_cast<long long>(steps); ++i) {
-            double x = x0 + h * (static_cast<double>(i) + 0.5);
-            total += common::weierstrass(x, a, b, n);
-        }
-        return total * h;
+        return integrate_weierstrass_parallel_omp(*common::weierstrass_plan(a, b, n), x0, x1, steps);
     }
 }
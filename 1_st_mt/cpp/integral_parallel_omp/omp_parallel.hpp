@@ -1,6 +1,84 @@
 #pragma once
 #include <cstddef>
+#include <string>
+#include "../common/integrand.hpp"
+#include "../common/topology.hpp"
+
+namespace common { class BatchPlan; struct IntegralJob; }
 
 namespace integral_parallel_omp {
+    // threads == 0: what the placement can use, or the OpenMP default for None
+    struct OmpOptions {
+        unsigned threads = 0;
+        common::Placement placement = common::Placement::None;
+        // First slot of common::Topology::assign the team takes
+        unsigned first_cpu = 0;
+    };
+
+    // WEIER_PLACEMENT from the environment, OpenMP default thread count
+    OmpOptions default_options();
+
+    // Placement summary for reports, see common::describe_placement
+    std::string describe(const OmpOptions& options);
+
+    // Sum of a range sum (see common/integrand.hpp) over [begin, end), one
+    // BATCH_BLOCK-point range per iteration, without the factor h
+    double sum_range_omp(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double h,
+                         std::size_t begin, std::size_t end, const OmpOptions& options);
+    // common::block_sums for blocks [first, last), one block per iteration
+    void block_sums_omp(const common::RangeSum& sum, double x0, double h, std::size_t begin, std::size_t end,
+                        std::size_t first, std::size_t last, double* out, const OmpOptions& options);
+
+    // Midpoint rule over any integrand, e.g. common::WeierstrassN<30>() or a lambda
+    template <class F>
+    double integrate_omp(const F& f, double x0, double x1, std::size_t steps,
+                         const OmpOptions& options = default_options()) {
+        double h = (x1 - x0) / static_cast<double>(steps);
+        return sum_range_omp(common::range_sum(f), common::precision_of(f), x0, h, 0, steps, options) * h;
+    }
+
+    // Cumulative integral table as integral_parallel::cumulative: out[j] = integral
+    // from x0 to x0 + (j + 1) * (x1 - x0) / count, j < count, with steps_per_point >= 1
+    // midpoints per section; one parallel region with a chunk per iteration,
+    // the scan of chunk totals by one thread and the offsets after a barrier.
+    // Reproducible policies give the same table as integral_parallel. Returns ""
+    // or the error of common::cumulative_check, leaving out untouched.
+    std::string cumulative_omp(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0,
+                               double x1, std::size_t count, std::size_t steps_per_point, double* out,
+                               const OmpOptions& options, std::size_t grain = 0);
+    template <class F>
+    std::string cumulative_omp(const F& f, double x0, double x1, std::size_t count, std::size_t steps_per_point,
+                               double* out, const OmpOptions& options = default_options(), std::size_t grain = 0) {
+        return cumulative_omp(common::range_sum(f), common::precision_of(f), x0, x1, count, steps_per_point, out,
+                              options, grain);
+    }
+    // The table of the Weierstrass function; write it into a common::MappedFile
+    // for file output
+    std::string cumulative_weierstrass_omp(const common::WeierstrassPlan& plan, double x0, double x1,
+                                           std::size_t count, std::size_t steps_per_point, double* out,
+                                           const OmpOptions& options = default_options());
+
+    // The Weierstrass function through its plan (common::PlanIntegrand)
     double integrate_weierstrass_parallel_omp(double a, double b, std::size_t n, double x0, double x1, std::size_t steps);
+    double integrate_weierstrass_parallel_omp(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps);
+    double integrate_weierstrass_parallel_omp(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                              const OmpOptions& options);
+
+    // Sum of the integrand at x0 + h*(i + 0.5), i in [begin, end), without the factor h
+    double sum_weierstrass_range_omp(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                     std::size_t end, const OmpOptions& options);
+    // common::weierstrass_block_sums for blocks [first, last), one block per iteration
+    void weierstrass_block_sums_omp(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                    std::size_t end, std::size_t first, std::size_t last, double* out,
+                                    const OmpOptions& options);
+
+    // results[j] = integral of jobs[j], j < count, in one parallel region over
+    // the pieces of all jobs (schedule(dynamic), see common::BatchPlan::pieces)
+    void integrate_weierstrass_batch_omp(const common::IntegralJob* jobs, std::size_t count, double* results);
+    void integrate_weierstrass_batch_omp(const common::IntegralJob* jobs, std::size_t count, double* results,
+                                         const OmpOptions& options);
+    // out[j] = sum of job j's grid points in the concatenated range [lo, hi) of
+    // the batch (lo <= hi <= batch.points()), without the factor h
+    void sum_weierstrass_batch_omp(const common::BatchPlan& batch, std::size_t lo, std::size_t hi, double* out,
+                                   const OmpOptions& options);
 }
@@ -1,14 +1,38 @@
 #include "single.hpp"
 #include "../common/common.hpp"
+#include "../common/jobs.hpp"
+#include "../common/profile.hpp"
+#include <vector>
 
 namespace integral_single {
-    double integrate_weierstrass(double a, double b, std::size_t n, double x0, double x1, std::size_t steps) {
+    double integrate(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double x1,
+                     std::size_t steps) {
         double h = (x1 - x0) / static_cast<double>(steps);
-        double sum = 0.0;
-        for (std::size_t i = 0; i < steps; ++i) {
-            double x = x0 + h * (static_cast<double>(i) + 0.5);
-            sum += common::weierstrass(x, a, b, n);
-        }
-        return sum * h;
+        common::RunProfile profile("single", 1);
+        profile.enter(0);
+        auto since = profile.clock();
+        double total = precision.reproducible ? common::midpoint_sum_reproducible(sum, x0, h, 0, steps)
+                                              : sum(x0, h, 0, steps);
+        profile.busy(0, since);
+        profile.leave(0);
+        profile.finish();
+        return total * h;
+    }
+
+    double integrate_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps) {
+        return integrate(common::PlanIntegrand(plan), x0, x1, steps);
+    }
+
+    double integrate_weierstrass(double a, double b, std::size_t n, double x0, double x1, std::size_t steps) {
+        return integrate_weierstrass(*common::weierstrass_plan(a, b, n), x0, x1, steps);
+    }
+
+    void integrate_weierstrass_batch(const common::IntegralJob* jobs, std::size_t count, double* results) {
+        common::BatchPlan batch(jobs, count);
+        std::vector<common::BatchPiece> pieces = batch.pieces(0, batch.points(), 0);
+        std::vector<double> sums(pieces.size());
+        for (std::size_t p = 0; p < pieces.size(); ++p) sums[p] = batch.sum(pieces[p]);
+        batch.job_sums(pieces, sums.data(), results);
+        batch.scale(results, results);
     }
 }
@@ -1,6 +1,23 @@
 #pragma once
 #include <cstddef>
+#include "../common/integrand.hpp"
+
+namespace common { struct IntegralJob; }
 
 namespace integral_single {
+    // Midpoint rule over a range sum (see common/integrand.hpp); reproducible
+    // policies sum in REPRO_BLOCK blocks
+    double integrate(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double x1,
+                     std::size_t steps);
+    // Midpoint rule over any integrand, e.g. common::WeierstrassN<30>() or a lambda
+    template <class F>
+    double integrate(const F& f, double x0, double x1, std::size_t steps) {
+        return integrate(common::range_sum(f), common::precision_of(f), x0, x1, steps);
+    }
+
+    // The Weierstrass function through its plan (common::PlanIntegrand)
     double integrate_weierstrass(double a, double b, std::size_t n, double x0, double x1, std::size_t steps);
+    double integrate_weierstrass(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps);
+    // results[j] = integral of jobs[j], j < count; plans are built once per distinct (a, b, n)
+    void integrate_weierstrass_batch(const common::IntegralJob* jobs, std::size_t count, double* results);
 }
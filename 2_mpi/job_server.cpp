@@ -0,0 +1,342 @@
+#include "job_server.hpp"
+#include "../1_st_mt/cpp/common/common.hpp"
+#include "../1_st_mt/cpp/common/jobs.hpp"
+#include <mpi.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// Резидентный режим: MPI запускается один раз, задания идут потоком.
+// Процесс 0 читает строки заданий и рассылает их батчами одним MPI_Bcast,
+// каждый процесс считает свою долю сквозной сетки батча (common::BatchPlan;
+// задания воспроизводимых планов не режутся), частичные суммы заданий уходят
+// неблокирующим MPI_Ireduce и собираются, пока читается и считается
+// следующий батч — барьеров между заданиями нет.
+namespace integral_mpi {
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        // Задание рассылается как есть (MPI_BYTE); steps == 0 — строка с ошибкой, не считается
+        using Job = common::IntegralJob;
+
+        // Заголовок батча перед заданиями в том же буфере
+        struct BatchHeader {
+            std::uint64_t count;
+            std::uint64_t stop;
+        };
+
+        // Что нужно процессу 0 для ответа
+        struct JobMeta {
+            std::size_t id;
+            Clock::time_point read;
+            std::string error;
+        };
+
+        // Батч между MPI_Ireduce и ответом: частичные суммы процесса и итог на процессе 0
+        struct InFlight {
+            MPI_Request request = MPI_REQUEST_NULL;
+            std::vector<Job> jobs;
+            std::vector<double> partial;
+            std::vector<double> total;
+            std::vector<JobMeta> meta;
+            int out = -1;
+        };
+
+        // Построчное чтение дескриптора с ожиданием через poll
+        class LineReader {
+        public:
+            explicit LineReader(int fd) : fd_(fd) {}
+
+            // false: за timeout_ms (-1 — без ограничения) полной строки нет или вход закончился
+            bool next(std::string& line, int timeout_ms) {
+                for (;;) {
+                    std::size_t nl = buffer_.find('\n');
+                    if (nl != std::string::npos) {
+                        line = buffer_.substr(0, nl);
+                        buffer_.erase(0, nl + 1);
+                        return true;
+                    }
+                    if (eof_) {
+                        if (buffer_.empty()) return false;
+                        line.swap(buffer_);
+                        buffer_.clear();
+                        return true;
+                    }
+                    pollfd p{fd_, POLLIN, 0};
+                    int ready = poll(&p, 1, timeout_ms);
+                    if (ready < 0 && errno == EINTR) continue;
+                    if (ready == 0) return false;
+                    char chunk[4096];
+                    ssize_t got = ready < 0 ? -1 : read(fd_, chunk, sizeof(chunk));
+                    if (got < 0 && errno == EINTR) continue;
+                    if (got <= 0) eof_ = true;
+                    else buffer_.append(chunk, static_cast<std::size_t>(got));
+                }
+            }
+
+            bool eof() const { return eof_ && buffer_.empty(); }
+
+        private:
+            int fd_;
+            std::string buffer_;
+            bool eof_ = false;
+        };
+
+        // Источник заданий и приёмник ответов процесса 0: stdin, файл (FIFO) или
+        // локальный сокет, клиенты которого обслуживаются по очереди
+        class Endpoint {
+        public:
+            ~Endpoint() {
+                close_client();
+                if (listen_ >= 0) {
+                    close(listen_);
+                    unlink(socket_path_.c_str());
+                }
+                if (in_ > 0) close(in_);
+                if (out_ > 1) close(out_);
+            }
+
+            // Пустая строка или причина ошибки
+            std::string open(const ServerOptions& options) {
+                if (options.source.rfind("unix:", 0) == 0) {
+                    socket_path_ = options.source.substr(5);
+                    sockaddr_un addr{};
+                    addr.sun_family = AF_UNIX;
+                    if (socket_path_.empty() || socket_path_.size() >= sizeof(addr.sun_path))
+                        return "bad socket path: " + socket_path_;
+                    std::memcpy(addr.sun_path, socket_path_.c_str(), socket_path_.size() + 1);
+                    unlink(socket_path_.c_str());
+                    listen_ = socket(AF_UNIX, SOCK_STREAM, 0);
+                    if (listen_ < 0 || bind(listen_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+                        listen(listen_, 4) != 0)
+                        return "cannot listen on " + socket_path_ + ": " + std::strerror(errno);
+                    return next_client() ? "" : "accept failed: " + std::string(std::strerror(errno));
+                }
+                in_ = options.source == "-" ? 0 : ::open(options.source.c_str(), O_RDONLY);
+                if (in_ < 0) return "cannot open " + options.source + ": " + std::strerror(errno);
+                out_ = options.sink == "-" ? 1 : ::open(options.sink.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+                if (out_ < 0) return "cannot open " + options.sink + ": " + std::strerror(errno);
+                reader_ = std::make_unique<LineReader>(in_);
+                return "";
+            }
+
+            bool is_socket() const { return listen_ >= 0; }
+
+            // Закрывает текущего клиента сокета и ждёт следующего
+            bool next_client() {
+                close_client();
+                do client_ = accept(listen_, nullptr, nullptr);
+                while (client_ < 0 && errno == EINTR);
+                if (client_ < 0) return false;
+                reader_ = std::make_unique<LineReader>(client_);
+                return true;
+            }
+
+            LineReader& reader() { return *reader_; }
+            int out() const { return is_socket() ? client_ : out_; }
+
+            // Клиент сокета мог уже уйти — без SIGPIPE, ответы просто теряются
+            void write(int fd, const std::string& text) const {
+                std::size_t done = 0;
+                while (done < text.size()) {
+                    ssize_t n = is_socket() ? send(fd, text.data() + done, text.size() - done, MSG_NOSIGNAL)
+                                            : ::write(fd, text.data() + done, text.size() - done);
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) return;
+                    done += static_cast<std::size_t>(n);
+                }
+            }
+
+        private:
+            void close_client() {
+                if (client_ >= 0) close(client_);
+                client_ = -1;
+            }
+
+            int in_ = -1;
+            int out_ = -1;
+            int listen_ = -1;
+            int client_ = -1;
+            std::string socket_path_;
+            std::unique_ptr<LineReader> reader_;
+        };
+
+        // false — пустая строка или комментарий; строка с ошибкой даёт steps = 0 и error
+        bool parse_job(const std::string& text, const ServerOptions& options, Job& job, std::string& error) {
+            std::istringstream in(text.substr(0, text.find('#')));
+            std::string token;
+            if (!(in >> token)) return false;
+            in.clear();
+            in.seekg(0);
+            long long n = 0;
+            long long steps = 0;
+            std::string rest;
+            Job parsed;
+            if (!(in >> parsed.a >> parsed.b >> n >> parsed.x0 >> parsed.x1 >> steps) || (in >> rest)) {
+                error = "expected: a b n x0 x1 steps";
+            } else if (n < 0 || steps <= 0 || !std::isfinite(parsed.a) || !std::isfinite(parsed.b) ||
+                       !std::isfinite(parsed.x0) || !std::isfinite(parsed.x1) ||
+                       static_cast<unsigned long long>(n) > options.max_n ||
+                       static_cast<unsigned long long>(steps) > options.max_steps ||
+                       !std::isfinite(common::PI * std::pow(std::abs(parsed.b), static_cast<double>(n)))) {
+                // Огромные n и steps заняли бы все процессы (или память под план) надолго
+                error = "bad parameters";
+            } else {
+                parsed.n = static_cast<std::size_t>(n);
+                parsed.steps = static_cast<std::size_t>(steps);
+            }
+            // Задание с ошибкой остаётся пустым: n = 0, steps = 0
+            job = error.empty() ? parsed : Job();
+            return true;
+        }
+
+        double percentile(const std::vector<double>& sorted, double q) {
+            if (sorted.empty()) return 0.0;
+            return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(q * sorted.size()))];
+        }
+    }
+
+    ServerStats serve(const ServerOptions& options) {
+        ServerStats stats;
+        MPI_Comm comm = options.mpi.comm;
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        Engine engine = resolve_engine(options.mpi.engine);
+        unsigned threads = resolve_threads(options.mpi);
+        std::size_t batch = std::max<std::size_t>(options.batch, 1);
+        int linger = static_cast<int>(std::ceil(std::max(options.linger_ms, 0.0)));
+        std::vector<unsigned char> buffer(sizeof(BatchHeader) + batch * sizeof(Job));
+
+        Endpoint endpoint;
+        if (rank == 0) stats.error = endpoint.open(options);
+
+        InFlight slots[2];
+        InFlight* outstanding = nullptr;
+        std::vector<double> latencies;
+        Clock::time_point first_read;
+        std::size_t next_id = 0;
+
+        // Ждёт MPI_Ireduce батча, процесс 0 пишет ответы в порядке заданий
+        auto finish = [&](InFlight*& flight) {
+            if (!flight) return;
+            MPI_Wait(&flight->request, MPI_STATUS_IGNORE);
+            if (rank == 0) {
+                std::ostringstream text;
+                for (std::size_t j = 0; j < flight->jobs.size(); ++j) {
+                    const Job& job = flight->jobs[j];
+                    const JobMeta& meta = flight->meta[j];
+                    double latency = std::chrono::duration<double>(Clock::now() - meta.read).count();
+                    text << meta.id << ' ';
+                    if (!meta.error.empty()) {
+                        text << "error " << meta.error << '\n';
+                        continue;
+                    }
+                    double h = (job.x1 - job.x0) / static_cast<double>(job.steps);
+                    text << std::setprecision(17) << flight->total[j] * h << ' ' << std::setprecision(6) << latency
+                         << '\n';
+                    latencies.push_back(latency);
+                    stats.points += job.steps;
+                }
+                endpoint.write(flight->out, text.str());
+                stats.jobs += flight->jobs.size();
+                stats.seconds = std::chrono::duration<double>(Clock::now() - first_read).count();
+            }
+            flight = nullptr;
+        };
+
+        for (;;) {
+            InFlight& fill = outstanding == &slots[0] ? slots[1] : slots[0];
+            fill.jobs.clear();
+            fill.meta.clear();
+            BatchHeader header{0, 0};
+            bool client_done = false;
+
+            if (rank == 0) {
+                header.stop = stats.error.empty() ? 0 : 1;
+                fill.out = header.stop ? -1 : endpoint.out();
+                // Батч уходит полным или после linger_ms тишины; без новых заданий
+                // тишина отдаёт ответы батча в полёте, чтобы клиент не ждал
+                while (!header.stop && fill.jobs.size() < batch) {
+                    std::string line;
+                    bool idle = fill.jobs.empty();
+                    if (!endpoint.reader().next(line, idle && !outstanding ? -1 : linger)) {
+                        if (endpoint.reader().eof()) {
+                            client_done = true;
+                            break;
+                        }
+                        if (!idle) break;
+                        finish(outstanding);
+                        continue;
+                    }
+                    std::size_t first = line.find_first_not_of(" \t\r");
+                    std::size_t last = line.find_last_not_of(" \t\r");
+                    if (first != std::string::npos && line.compare(first, last - first + 1, "quit") == 0) {
+                        header.stop = 1;
+                        break;
+                    }
+                    Job job;
+                    std::string error;
+                    if (!parse_job(line, options, job, error)) continue;
+                    if (next_id == 0) first_read = Clock::now();
+                    fill.jobs.push_back(job);
+                    fill.meta.push_back(JobMeta{next_id++, Clock::now(), error});
+                }
+                // Файл и stdin кончаются вместе со входом, сокет ждёт следующего клиента
+                if (client_done && !endpoint.is_socket()) header.stop = 1;
+                header.count = fill.jobs.size();
+                std::memcpy(buffer.data(), &header, sizeof(header));
+                if (header.count) std::memcpy(buffer.data() + sizeof(header), fill.jobs.data(), header.count * sizeof(Job));
+            }
+
+            MPI_Bcast(buffer.data(), static_cast<int>(buffer.size()), MPI_BYTE, 0, comm);
+            if (rank != 0) {
+                std::memcpy(&header, buffer.data(), sizeof(header));
+                fill.jobs.resize(header.count);
+                if (header.count) std::memcpy(fill.jobs.data(), buffer.data() + sizeof(header), header.count * sizeof(Job));
+            }
+
+            if (header.count) {
+                // Прошлый батч собирается после счёта текущего: редукция шла, пока он считался
+                common::BatchPlan plan(fill.jobs.data(), fill.jobs.size());
+                fill.partial.resize(header.count);
+                sum_weierstrass_batch_share(plan, rank, size, fill.partial.data(), engine, threads);
+                finish(outstanding);
+                fill.total.assign(header.count, 0.0);
+                MPI_Ireduce(fill.partial.data(), fill.total.data(), static_cast<int>(header.count), MPI_DOUBLE,
+                            MPI_SUM, 0, comm, &fill.request);
+                outstanding = &fill;
+                ++stats.batches;
+            }
+            if (header.stop) break;
+            if (client_done) {
+                finish(outstanding);
+                if (!endpoint.next_client()) stats.error = "accept failed: " + std::string(std::strerror(errno));
+            }
+        }
+        finish(outstanding);
+
+        std::sort(latencies.begin(), latencies.end());
+        if (!latencies.empty()) {
+            double sum = 0.0;
+            for (double l : latencies) sum += l;
+            stats.mean_latency = sum / static_cast<double>(latencies.size());
+            stats.p50_latency = percentile(latencies, 0.5);
+            stats.p99_latency = percentile(latencies, 0.99);
+            stats.max_latency = latencies.back();
+        }
+        return stats;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include "mpi_parallel.hpp"
+#include <cstddef>
+#include <string>
+
+namespace integral_mpi {
+    // Resident job server: rank 0 reads integration jobs, broadcasts them in
+    // batches, every rank sums its slice of the batch's concatenated grid and
+    // the per-job partials come back with MPI_Ireduce while the next batch is
+    // already being read and computed.
+    //
+    // Input, one job per line: "a b n x0 x1 steps"; '#' starts a comment and
+    // "quit" stops the server. Output, one line per job in input order:
+    // "id value seconds" (or "id error <reason>"), where id counts jobs from 0
+    // and seconds is the latency from reading the line to writing the result.
+    struct ServerOptions {
+        // "-": stdin; "unix:<path>": listen on a local socket, clients are served
+        // one after another and get their results on the same connection;
+        // anything else: a file or FIFO of jobs
+        std::string source = "-";
+        // Results of stdin and file sources: "-" for stdout or a file path
+        std::string sink = "-";
+        std::size_t batch = 64;         // most jobs per broadcast
+        double linger_ms = 2.0;         // a partial batch goes out after this much input silence
+        // Larger jobs get "error bad parameters" instead of tying up the ranks;
+        // so does n with PI * |b|^n beyond the double range
+        std::size_t max_n = 4096;
+        std::size_t max_steps = 10000000000;    // 1e10
+        MpiOptions mpi;                 // engine, threads and ranks; schedule is not used
+    };
+
+    // Collected on rank 0
+    struct ServerStats {
+        std::size_t jobs = 0;
+        std::size_t batches = 0;
+        std::size_t points = 0;
+        double seconds = 0.0;           // first job read to last result written
+        double mean_latency = 0.0;
+        double p50_latency = 0.0;
+        double p99_latency = 0.0;
+        double max_latency = 0.0;
+        std::string error;              // source or sink could not be opened
+    };
+
+    // Collective over options.mpi.comm; returns when the input ends or on "quit"
+    ServerStats serve(const ServerOptions& options);
+}
@@ -1,58 +1,610 @@
 #include "mpi_parallel.hpp"
 #include "../1_st_mt/cpp/common/common.hpp"
+#include "../1_st_mt/cpp/common/integrand.hpp"
+#include "../1_st_mt/cpp/common/jobs.hpp"
+#include "../1_st_mt/cpp/common/profile.hpp"
+#include "../1_st_mt/cpp/common/topology.hpp"
+#include "../1_st_mt/cpp/integral_parallel/parallel.hpp"
+#include "../1_st_mt/cpp/integral_parallel/thread_pool.hpp"
+#ifdef ENABLE_OPENMP
+#include "../1_st_mt/cpp/integral_parallel_omp/omp_parallel.hpp"
+#endif
 #include <mpi.h>
-#include <vector>
 #include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
 
 // Модуль для параллельного численного интегрирования функции Вейерштрасса
-// с использованием OpenMPI.
+// с использованием OpenMPI. Внутри процесса диапазон считает один из CPU
+// движков 1_st_mt (пул потоков или OpenMP), MPI вызывает только главный поток.
 namespace integral_mpi {
     namespace {
-        // Функция для вычисления части интеграла на диапазоне [begin, end).
-        double weierstrass_chunk(double a, double b, std::size_t n, double x0, double h,
-                                std::size_t begin, std::size_t end) {
-            double local = 0.0;
-            for (std::size_t i = begin; i < end; ++i) {
-                // Вычисляем значение функции Вейерштрасса в точке x
-                double x = x0 + h * (static_cast<double>(i) + 0.5);
-                local += common::weierstrass(x, a, b, n);
+        using Clock = std::chrono::steady_clock;
+
+        double seconds_since(Clock::time_point t) {
+            return std::chrono::duration<double>(Clock::now() - t).count();
+        }
+
+        // Время процесса в профиль: вычисление — занятость, коллективные операции — простой.
+        // Номер — в MPI_COMM_WORLD, а не в options.comm: запуски на разных
+        // коммуникаторах копятся в одной строке процесса
+        void record_rank(const MpiStats& st) {
+            int rank;
+            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+            common::WorkerProfile w;
+            w.group = "mpi";
+            w.worker = static_cast<unsigned>(rank);
+            w.runs = 1;
+            w.tasks = st.chunks;
+            w.busy = st.compute_seconds;
+            w.idle = st.reduce_seconds;
+            common::add_worker_profile(w);
+            common::add_phase("mpi compute", st.compute_seconds);
+            common::add_phase("mpi collective", st.reduce_seconds);
+        }
+
+        // Коммуникаторы узла (процессы с общей памятью) и лидеров узлов
+        struct NodeComms {
+            MPI_Comm node = MPI_COMM_NULL;
+            MPI_Comm leaders = MPI_COMM_NULL;
+
+            explicit NodeComms(MPI_Comm comm) {
+                int rank, node_rank;
+                MPI_Comm_rank(comm, &rank);
+                MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+                MPI_Comm_rank(node, &node_rank);
+                MPI_Comm_split(comm, node_rank == 0 ? 0 : MPI_UNDEFINED, rank, &leaders);
+            }
+            ~NodeComms() {
+                if (leaders != MPI_COMM_NULL) MPI_Comm_free(&leaders);
+                MPI_Comm_free(&node);
+            }
+            NodeComms(const NodeComms&) = delete;
+            NodeComms& operator=(const NodeComms&) = delete;
+        };
+
+        // NodeComms кэшируются атрибутом исходного коммуникатора: split делается
+        // один раз на коммуникатор, а не на каждый интеграл. Атрибут уходит вместе
+        // с коммуникатором (MPI_Comm_free), оставшиеся (MPI_COMM_WORLD) освобождаются
+        // в начале MPI_Finalize — через атрибут на MPI_COMM_SELF
+        int node_keyval = MPI_KEYVAL_INVALID;
+
+        std::set<MPI_Comm>& cached_comms() {
+            static std::set<MPI_Comm> comms;
+            return comms;
+        }
+
+        int free_node_comms(MPI_Comm comm, int, void* value, void*) {
+            delete static_cast<NodeComms*>(value);
+            cached_comms().erase(comm);
+            return MPI_SUCCESS;
+        }
+
+        int free_all_node_comms(MPI_Comm, int, void*, void*) {
+            // Каждое удаление атрибута вызывает free_node_comms, тот убирает коммуникатор из множества
+            while (!cached_comms().empty()) MPI_Comm_delete_attr(*cached_comms().begin(), node_keyval);
+            MPI_Comm_free_keyval(&node_keyval);
+            return MPI_SUCCESS;
+        }
+
+        // Коллективная при первом вызове на comm
+        const NodeComms& node_comms(MPI_Comm comm) {
+            if (node_keyval == MPI_KEYVAL_INVALID) {
+                MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, free_node_comms, &node_keyval, nullptr);
+                int finalize_keyval;
+                MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, free_all_node_comms, &finalize_keyval, nullptr);
+                MPI_Comm_set_attr(MPI_COMM_SELF, finalize_keyval, nullptr);
+                MPI_Comm_free_keyval(&finalize_keyval);
+            }
+            void* value = nullptr;
+            int found = 0;
+            MPI_Comm_get_attr(comm, node_keyval, &value, &found);
+            if (found) return *static_cast<NodeComms*>(value);
+            auto* comms = new NodeComms(comm);
+            MPI_Comm_set_attr(comm, node_keyval, comms);
+            cached_comms().insert(comm);
+            return *comms;
+        }
+
+        // Первый слот Topology::assign для закреплённых потоков процесса, см. threads_for
+        unsigned& first_cpu() {
+            static unsigned first = 0;
+            return first;
+        }
+
+        // Пул процесса: создаётся при первом вызове и пересоздаётся при смене
+        // числа потоков, размещения или первого CPU
+        integral_parallel::ThreadPool& rank_pool(unsigned threads) {
+            static std::unique_ptr<integral_parallel::ThreadPool> pool;
+            static unsigned pool_first = 0;
+            if (!pool || pool->size() != threads || pool->placement() != common::default_placement() ||
+                pool_first != first_cpu()) {
+                pool = std::make_unique<integral_parallel::ThreadPool>(threads, common::default_placement(),
+                                                                       first_cpu());
+                pool_first = first_cpu();
+            }
+            return *pool;
+        }
+
+#ifdef ENABLE_OPENMP
+        // Команда OpenMP процесса с тем же размещением, что у rank_pool
+        integral_parallel_omp::OmpOptions rank_omp(unsigned threads) {
+            integral_parallel_omp::OmpOptions omp;
+            omp.threads = threads;
+            omp.placement = common::default_placement();
+            omp.first_cpu = first_cpu();
+            return omp;
+        }
+#endif
+
+        unsigned threads_for(MPI_Comm node, unsigned requested) {
+            // Маска уже меньше машины — процесс закреплён запускающей программой,
+            // иначе CPU узла делятся между его процессами
+            unsigned cpus = static_cast<unsigned>(common::Topology::system().cpus().size());
+            bool bound = cpus < std::thread::hardware_concurrency();
+            int local, local_rank;
+            MPI_Comm_size(node, &local);
+            MPI_Comm_rank(node, &local_rank);
+            unsigned threads = requested;
+            if (threads == 0) threads = bound ? std::max(cpus, 1u) : std::max(cpus / static_cast<unsigned>(local), 1u);
+            // Незакреплённые процессы узла видят одну и ту же маску: без сдвига все
+            // закрепились бы на её первых CPU. Процесс r узла берёт слоты с r * threads
+            first_cpu() = bound ? 0 : static_cast<unsigned>(local_rank) * threads;
+            return threads;
+        }
+
+        // Сумма точек [begin, end) выбранным движком (без множителя h)
+        double range_sum(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double h,
+                         std::size_t begin, std::size_t end, Engine engine, unsigned threads) {
+            switch (engine) {
+                case Engine::Threads:
+                    return integral_parallel::sum_range(sum, precision, x0, h, begin, end, rank_pool(threads));
+#ifdef ENABLE_OPENMP
+                case Engine::OpenMP: {
+                    integral_parallel_omp::OmpOptions omp = rank_omp(threads);
+                    return integral_parallel_omp::sum_range_omp(sum, precision, x0, h, begin, end, omp);
+                }
+#endif
+                default:
+                    if (precision.reproducible) return common::midpoint_sum_reproducible(sum, x0, h, begin, end);
+                    return sum(x0, h, begin, end);
+            }
+        }
+
+        // Суммы блоков [first, last) воспроизводимого режима выбранным движком
+        void block_sums(const common::RangeSum& sum, double x0, double h, std::size_t steps, std::size_t first,
+                        std::size_t last, double* out, Engine engine, unsigned threads) {
+            switch (engine) {
+                case Engine::Threads:
+                    integral_parallel::block_sums(sum, x0, h, 0, steps, first, last, out, rank_pool(threads));
+                    return;
+#ifdef ENABLE_OPENMP
+                case Engine::OpenMP: {
+                    integral_parallel_omp::OmpOptions omp = rank_omp(threads);
+                    integral_parallel_omp::block_sums_omp(sum, x0, h, 0, steps, first, last, out, omp);
+                    return;
+                }
+#endif
+                default:
+                    common::block_sums(sum, x0, h, 0, steps, first, last, out);
+            }
+        }
+
+        // Суммы заданий пакета по отрезку [lo, hi) его сквозной сетки выбранным движком
+        void batch_sums(const common::BatchPlan& batch, std::size_t lo, std::size_t hi, double* out, Engine engine,
+                        unsigned threads) {
+            switch (engine) {
+                case Engine::Threads:
+                    integral_parallel::sum_weierstrass_batch(batch, lo, hi, out, rank_pool(threads));
+                    return;
+#ifdef ENABLE_OPENMP
+                case Engine::OpenMP: {
+                    integral_parallel_omp::OmpOptions omp = rank_omp(threads);
+                    integral_parallel_omp::sum_weierstrass_batch_omp(batch, lo, hi, out, omp);
+                    return;
+                }
+#endif
+                default: {
+                    std::vector<common::BatchPiece> pieces = batch.pieces(lo, hi, 0);
+                    std::vector<double> sums(pieces.size());
+                    for (std::size_t p = 0; p < pieces.size(); ++p) sums[p] = batch.sum(pieces[p]);
+                    batch.job_sums(pieces, sums.data(), out);
+                }
+            }
+        }
+
+        // Воспроизводимый режим: процессы делят блоки REPRO_BLOCK, суммы блоков
+        // собираются на всех процессах и складываются фиксированным деревом,
+        // поэтому результат не зависит от числа процессов и потоков
+        double reproducible_sum(const common::RangeSum& sum, double x0, double h, std::size_t steps, MPI_Comm comm,
+                                Engine engine, unsigned threads, MpiStats& st) {
+            int rank, size;
+            MPI_Comm_rank(comm, &rank);
+            MPI_Comm_size(comm, &size);
+            std::size_t blocks = common::reproducible_block_count(0, steps);
+            std::vector<int> counts(size), displs(size);
+            for (int r = 0; r < size; ++r) {
+                std::size_t first = blocks * r / size;
+                counts[r] = static_cast<int>(blocks * (r + 1) / size - first);
+                displs[r] = static_cast<int>(first);
+            }
+            std::vector<double> sums(blocks);
+            std::size_t first = static_cast<std::size_t>(displs[rank]);
+            auto t = Clock::now();
+            block_sums(sum, x0, h, steps, first, first + counts[rank], sums.data() + first, engine, threads);
+            st.compute_seconds = seconds_since(t);
+            st.chunks = 1;
+            st.points = std::min((first + counts[rank]) * common::REPRO_BLOCK, steps) -
+                        std::min(first * common::REPRO_BLOCK, steps);
+            t = Clock::now();
+            MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, sums.data(), counts.data(), displs.data(),
+                           MPI_DOUBLE, comm);
+            st.reduce_seconds = seconds_since(t);
+            return common::reproducible_tree_sum(sums.data(), blocks);
+        }
+
+        // Иерархическая сумма частичных: MPI_Ireduce к лидеру узла, MPI_Allreduce
+        // между лидерами, MPI_Bcast по узлу. Неблокирующая только первая ступень:
+        // она идёт, пока вызывающий между конструктором и finish делает свою
+        // коллективную работу (снятие окна счётчика); следующие ступени зависят
+        // от её результата, поэтому блокирующие
+        class NodeReduction {
+        public:
+            NodeReduction(const NodeComms& comms, double local) : comms_(comms), local_(local) {
+                MPI_Ireduce(&local_, &node_, 1, MPI_DOUBLE, MPI_SUM, 0, comms_.node, &request_);
+            }
+
+            double finish() {
+                MPI_Wait(&request_, MPI_STATUS_IGNORE);
+                double global = 0.0;
+                if (comms_.leaders != MPI_COMM_NULL)
+                    MPI_Allreduce(&node_, &global, 1, MPI_DOUBLE, MPI_SUM, comms_.leaders);
+                MPI_Bcast(&global, 1, MPI_DOUBLE, 0, comms_.node);
+                return global;
+            }
+
+        private:
+            const NodeComms& comms_;
+            double local_;
+            double node_ = 0.0;
+            MPI_Request request_;
+        };
+
+        // Номер следующего куска в окне процесса 0; MPI_Fetch_and_op атомарен
+        // и не требует участия процесса 0 (пассивная цель)
+        class ChunkCounter {
+        public:
+            explicit ChunkCounter(MPI_Comm comm) {
+                int rank;
+                MPI_Comm_rank(comm, &rank);
+                MPI_Win_allocate(rank == 0 ? sizeof(std::uint64_t) : 0, sizeof(std::uint64_t), MPI_INFO_NULL, comm,
+                                 &base_, &win_);
+                if (rank == 0) {
+                    // Своё окно пишем только под исключительной блокировкой
+                    MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win_);
+                    *base_ = 0;
+                    MPI_Win_unlock(0, win_);
+                }
+                MPI_Barrier(comm);
+                MPI_Win_lock_all(0, win_);
+            }
+
+            ~ChunkCounter() { close(); }
+            ChunkCounter(const ChunkCounter&) = delete;
+            ChunkCounter& operator=(const ChunkCounter&) = delete;
+
+            std::uint64_t next() {
+                const std::uint64_t one = 1;
+                std::uint64_t old = 0;
+                MPI_Fetch_and_op(&one, &old, MPI_UINT64_T, 0, 0, MPI_SUM, win_);
+                MPI_Win_flush(0, win_);
+                return old;
+            }
+
+            // Конец эпохи доступа и освобождение окна. MPI_Win_free коллективная и
+            // ждёт самый медленный процесс — под ней и идёт уже запущенная редукция
+            void close() {
+                if (win_ == MPI_WIN_NULL) return;
+                MPI_Win_unlock_all(win_);
+                MPI_Win_free(&win_);
+            }
+
+        private:
+            MPI_Win win_ = MPI_WIN_NULL;
+            std::uint64_t* base_ = nullptr;
+        };
+
+        // Границы кусков управляемого расписания: остаток / (2 * ranks), не меньше
+        // min_chunk, кратно align. Одинаковы на всех процессах — счётчик раздаёт номера
+        std::vector<std::size_t> guided_bounds(std::size_t units, int ranks, std::size_t min_chunk, std::size_t align) {
+            std::vector<std::size_t> bounds{0};
+            std::size_t pos = 0;
+            while (pos < units) {
+                std::size_t chunk = std::max((units - pos) / (2 * static_cast<std::size_t>(ranks)), min_chunk);
+                chunk = (chunk + align - 1) / align * align;
+                pos = std::min(pos + chunk, units);
+                bounds.push_back(pos);
+            }
+            return bounds;
+        }
+
+        // Динамическое расписание. В воспроизводимом режиме кусок — группа блоков
+        // REPRO_BLOCK; у каждой ячейки сумм ровно один процесс пишет ненулевое значение,
+        // поэтому MPI_SUM по процессам точен и дерево даёт тот же результат
+        double dynamic_sum(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double h,
+                           std::size_t steps, const MpiOptions& options, const NodeComms& comms, Engine engine,
+                           unsigned threads, MpiStats& st) {
+            int size;
+            MPI_Comm_size(options.comm, &size);
+            bool repro = precision.reproducible;
+            std::size_t min_chunk = std::max<std::size_t>(options.min_chunk, 1);
+            std::vector<std::size_t> bounds =
+                repro ? guided_bounds(common::reproducible_block_count(0, steps), size,
+                                      std::max<std::size_t>(min_chunk / common::REPRO_BLOCK, 1), 1)
+                      : guided_bounds(steps, size, min_chunk, common::BATCH_BLOCK);
+            std::vector<double> sums(repro ? bounds.back() : 0, 0.0);
+            common::RunningSum local(precision.summation);
+
+            ChunkCounter counter(options.comm);
+            for (std::uint64_t c = counter.next(); c + 1 < bounds.size(); c = counter.next()) {
+                auto t = Clock::now();
+                std::size_t lo = bounds[c], hi = bounds[c + 1];
+                if (repro) {
+                    block_sums(sum, x0, h, steps, lo, hi, sums.data() + lo, engine, threads);
+                    st.points += std::min(hi * common::REPRO_BLOCK, steps) - lo * common::REPRO_BLOCK;
+                } else {
+                    local.add(range_sum(sum, precision, x0, h, lo, hi, engine, threads));
+                    st.points += hi - lo;
+                }
+                st.compute_seconds += seconds_since(t);
+                ++st.chunks;
+            }
+
+            // Своя часть готова: редукция запускается сразу, а ожидание остальных
+            // процессов в коллективном MPI_Win_free идёт одновременно с ней
+            auto t = Clock::now();
+            double result;
+            if (repro) {
+                MPI_Request request;
+                MPI_Iallreduce(MPI_IN_PLACE, sums.data(), static_cast<int>(sums.size()), MPI_DOUBLE, MPI_SUM,
+                               options.comm, &request);
+                counter.close();
+                MPI_Wait(&request, MPI_STATUS_IGNORE);
+                result = common::reproducible_tree_sum(sums.data(), sums.size());
+            } else {
+                NodeReduction reduction(comms, local.value());
+                counter.close();
+                result = reduction.finish();
             }
-            return local;
+            st.reduce_seconds = seconds_since(t);
+            return result;
         }
     }
 
-    // Основная функция для параллельного интегрирования с использованием MPI.
-    // a, b, n — параметры функции Вейерштрасса
-    // x0, x1 — границы интегрирования
-    // steps — количество разбиений (шагов интегрирования)
-    double integrate_weierstrass_mpi(double a, double b, std::size_t n,
-                                    double x0, double x1, std::size_t steps) {
+    int init_funneled(int* argc, char*** argv) {
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Init_thread(argc, argv, MPI_THREAD_FUNNELED, &provided);
+        return provided;
+    }
+
+    MpiOptions default_options() {
+        MpiOptions options;
+        if (const char* env = std::getenv("WEIER_MPI_ENGINE")) {
+            std::string s(env);
+            if (s == "serial") options.engine = Engine::Serial;
+            if (s == "threads") options.engine = Engine::Threads;
+            if (s == "openmp") options.engine = Engine::OpenMP;
+        }
+        if (const char* env = std::getenv("WEIER_MPI_THREADS")) {
+            options.threads = static_cast<unsigned>(std::strtoul(env, nullptr, 10));
+        }
+        if (const char* env = std::getenv("WEIER_MPI_SCHEDULE")) {
+            std::string s(env);
+            if (s == "static") options.schedule = Schedule::Static;
+            if (s == "dynamic") options.schedule = Schedule::Dynamic;
+        }
+        return options;
+    }
+
+    const char* schedule_name(Schedule schedule) {
+        return schedule == Schedule::Dynamic ? "dynamic" : "static";
+    }
+
+    const char* engine_name(Engine engine) {
+        switch (engine) {
+            case Engine::Threads: return "threads";
+            case Engine::OpenMP: return "openmp";
+            default: return "serial";
+        }
+    }
+
+    Engine resolve_engine(Engine engine) {
+#ifndef ENABLE_OPENMP
+        if (engine == Engine::OpenMP) engine = Engine::Threads;
+#endif
+        // Потоки допустимы, только если MPI обещал хотя бы FUNNELED
+        int provided = MPI_THREAD_SINGLE;
+        MPI_Query_thread(&provided);
+        return provided < MPI_THREAD_FUNNELED ? Engine::Serial : engine;
+    }
+
+    unsigned resolve_threads(const MpiOptions& options) {
+        if (resolve_engine(options.engine) == Engine::Serial) return 1;
+        const NodeComms& comms = node_comms(options.comm);
+        return threads_for(comms.node, options.threads);
+    }
+
+    double sum_weierstrass_range_local(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                       std::size_t end, Engine engine, unsigned threads) {
+        common::PlanIntegrand f(plan);
+        return range_sum(common::range_sum(f), plan.precision(), x0, h, begin, end, engine, threads);
+    }
+
+    // Доля процесса — равный отрезок сквозной сетки пакета (без переполнения при больших points)
+    void sum_weierstrass_batch_share(const common::BatchPlan& batch, int rank, int ranks, double* out, Engine engine,
+                                     unsigned threads) {
+        std::size_t total = batch.points();
+        std::size_t r = static_cast<std::size_t>(rank), size = static_cast<std::size_t>(ranks);
+        std::size_t lo = total / size * r + total % size * r / size;
+        std::size_t hi = total / size * (r + 1) + total % size * (r + 1) / size;
+        batch_sums(batch, lo, hi, out, engine, threads);
+    }
+
+    // Пакет: одна коллективная операция на все задания
+    void integrate_weierstrass_batch_mpi(const common::IntegralJob* jobs, std::size_t count, double* results,
+                                         const MpiOptions& options) {
+        std::fill(results, results + count, 0.0);
+        if (options.comm == MPI_COMM_NULL || count == 0) return;
         int rank, size;
-        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-        MPI_Comm_size(MPI_COMM_WORLD, &size);
+        MPI_Comm_rank(options.comm, &rank);
+        MPI_Comm_size(options.comm, &size);
+        Engine engine = resolve_engine(options.engine);
+        // Разбиение по узлам (первый CPU процесса) кэшируется; при первом вызове
+        // на коммуникаторе это ещё одна коллективная операция
+        unsigned threads = engine == Engine::Serial ? 1 : resolve_threads(options);
+        common::BatchPlan batch(jobs, count);
+        MpiStats st;
+        auto t = Clock::now();
+        sum_weierstrass_batch_share(batch, rank, size, results, engine, threads);
+        st.compute_seconds = seconds_since(t);
+        st.chunks = 1;
+        t = Clock::now();
+        MPI_Allreduce(MPI_IN_PLACE, results, static_cast<int>(count), MPI_DOUBLE, MPI_SUM, options.comm);
+        st.reduce_seconds = seconds_since(t);
+        if (common::profiling()) record_rank(st);
+        batch.scale(results, results);
+    }
+
+    void integrate_weierstrass_batch_mpi(const common::IntegralJob* jobs, std::size_t count, double* results) {
+        integrate_weierstrass_batch_mpi(jobs, count, results, default_options());
+    }
+
+    namespace {
+        // Основная функция для параллельного интегрирования с использованием MPI.
+        // sum — сумма подынтегральной функции по диапазону сетки, precision — её режим суммирования
+        // x0, x1 — границы интегрирования
+        // steps — количество разбиений (шагов интегрирования)
+        double integrate_share(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0,
+                               double x1, std::size_t steps, const MpiOptions& options, MpiStats& st) {
+            int rank, size;
+            MPI_Comm_rank(options.comm, &rank);
+            MPI_Comm_size(options.comm, &size);
 
-        // h — ширина одного шага интегрирования
-        double h = (x1 - x0) / static_cast<double>(steps);
+            // h — ширина одного шага интегрирования
+            double h = (x1 - x0) / static_cast<double>(steps);
 
-        // Распределяем работу между процессами
-        // chunk — базовое количество шагов на процесс
-        std::size_t chunk = steps / size;
-        // remainder — сколько процессов получат на 1 шаг больше (для равномерного распределения)
-        std::size_t remainder = steps % size;
+            const NodeComms& comms = node_comms(options.comm);
+            Engine engine = resolve_engine(options.engine);
+            unsigned threads = engine == Engine::Serial ? 1 : threads_for(comms.node, options.threads);
+            if (options.schedule == Schedule::Dynamic) {
+                return dynamic_sum(sum, precision, x0, h, steps, options, comms, engine, threads, st) * h;
+            }
+            if (precision.reproducible) return reproducible_sum(sum, x0, h, steps, options.comm, engine, threads, st) * h;
+
+            // Распределяем работу между процессами
+            // chunk — базовое количество шагов на процесс
+            std::size_t chunk = steps / size;
+            // remainder — сколько процессов получат на 1 шаг больше (для равномерного распределения)
+            std::size_t remainder = steps % size;
 
-        // Определяем диапазон для текущего процесса
-        std::size_t local_size = chunk + (rank < remainder ? 1 : 0);
-        std::size_t start = rank * chunk + std::min(static_cast<std::size_t>(rank), remainder);
-        std::size_t end = start + local_size;
+            // Определяем диапазон для текущего процесса
+            std::size_t local_size = chunk + (rank < remainder ? 1 : 0);
+            std::size_t start = rank * chunk + std::min(static_cast<std::size_t>(rank), remainder);
+            std::size_t end = start + local_size;
 
-        // Вычисляем локальную часть интеграла
-        double local_result = weierstrass_chunk(a, b, n, x0, h, start, end);
+            // Вычисляем локальную часть интеграла потоками процесса
+            auto t = Clock::now();
+            double local_result = range_sum(sum, precision, x0, h, start, end, engine, threads);
+            st.compute_seconds = seconds_since(t);
+            st.chunks = 1;
+            st.points = local_size;
 
-        // Собираем результаты от всех процессов
-        double global_result = 0.0;
-        MPI_Allreduce(&local_result, &global_result, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+            // Сумма по узлу собирается у его лидера, в MPI_Allreduce входят только
+            // лидеры — по одной частичной сумме на узел, затем результат рассылается по узлу.
+            // Перекрывать здесь нечего: редукция сразу дожидается результата
+            t = Clock::now();
+            double global_result = NodeReduction(comms, local_result).finish();
+            st.reduce_seconds = seconds_since(t);
+
+            // Возвращаем итоговый результат интегрирования
+            return global_result * h;
+        }
+    }
+
+    double integrate_mpi(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double x1,
+                         std::size_t steps, const MpiOptions& options, MpiStats* stats) {
+        MpiStats local_stats;
+        MpiStats& st = stats ? *stats : local_stats;
+        st = MpiStats();
+        if (options.comm == MPI_COMM_NULL) return 0.0;
+        double result = integrate_share(sum, precision, x0, x1, steps, options, st);
+        if (common::profiling()) record_rank(st);
+        return result;
+    }
 
-        // Возвращаем итоговый результат интегрирования
-        return global_result * h;
+    common::ProfileReport gather_profile(MPI_Comm comm) {
+        common::ProfileReport report = common::profile_report();
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        // Строка процесса: номер в MPI_COMM_WORLD, его запись "mpi" и счётчики всех его потоков
+        enum { WORLD_RANK, RUNS, TASKS, BUSY, IDLE, CYCLES, INSTRUCTIONS, FIELDS };
+        double row[FIELDS] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        int world_rank;
+        MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+        row[WORLD_RANK] = world_rank;
+        std::vector<common::WorkerProfile> workers;
+        for (const common::WorkerProfile& w : report.workers) {
+            row[CYCLES] += static_cast<double>(w.cycles);
+            row[INSTRUCTIONS] += static_cast<double>(w.instructions);
+            if (w.group != "mpi") {
+                workers.push_back(w);
+                continue;
+            }
+            row[RUNS] = static_cast<double>(w.runs);
+            row[TASKS] = static_cast<double>(w.tasks);
+            row[BUSY] = w.busy;
+            row[IDLE] = w.idle;
+        }
+        std::vector<double> rows(rank == 0 ? FIELDS * size : 0);
+        MPI_Gather(row, FIELDS, MPI_DOUBLE, rows.data(), FIELDS, MPI_DOUBLE, 0, comm);
+        if (rank != 0) return report;
+        for (int r = 0; r < size; ++r) {
+            const double* v = rows.data() + FIELDS * r;
+            common::WorkerProfile w;
+            w.group = "mpi";
+            w.worker = static_cast<unsigned>(v[WORLD_RANK]);
+            w.runs = static_cast<std::size_t>(v[RUNS]);
+            w.tasks = static_cast<std::size_t>(v[TASKS]);
+            w.busy = v[BUSY];
+            w.idle = v[IDLE];
+            w.cycles = static_cast<std::uint64_t>(v[CYCLES]);
+            w.instructions = static_cast<std::uint64_t>(v[INSTRUCTIONS]);
+            workers.push_back(w);
+        }
+        report.workers = workers;
+        report.groups = common::profile_groups(report.workers);
+        return report;
+    }
+
+    double integrate_weierstrass_mpi(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                     const MpiOptions& options, MpiStats* stats) {
+        return integrate_mpi(common::PlanIntegrand(plan), x0, x1, steps, options, stats);
+    }
+
+    double integrate_weierstrass_mpi(const common::WeierstrassPlan& plan,
+                                    double x0, double x1, std::size_t steps) {
+        return integrate_weierstrass_mpi(plan, x0, x1, steps, default_options());
+    }
+
+    double integrate_weierstrass_mpi(double a, double b, std::size_t n,
+                                    double x0, double x1, std::size_t steps) {
+        return integrate_weierstrass_mpi(*common::weierstrass_plan(a, b, n), x0, x1, steps);
     }
-}
\ No newline at end of file
+}
@@ -1,6 +1,109 @@
 #pragma once
 #include <cstddef>
+#include <mpi.h>
+#include "../1_st_mt/cpp/common/integrand.hpp"
+#include "../1_st_mt/cpp/common/profile.hpp"
+
+namespace common { class BatchPlan; struct IntegralJob; }
 
 namespace integral_mpi {
+    // How a rank computes its share of the grid: on the calling thread, on the
+    // integral_parallel thread pool or with integral_parallel_omp
+    enum class Engine { Serial, Threads, OpenMP };
+
+    // Static: rank r gets the r-th equal contiguous range. Dynamic: ranks claim
+    // chunks from a counter on rank 0 with MPI_Fetch_and_op; chunks follow a
+    // guided schedule (remaining / (2 * ranks), at least min_chunk), so fast
+    // ranks take more of the grid and the tail is cut fine.
+    enum class Schedule { Static, Dynamic };
+
+    struct MpiOptions {
+        Engine engine = Engine::Threads;
+        // Threads per rank; 0: the CPUs of the rank's affinity mask, divided
+        // between the ranks of the node unless the launcher already bound them
+        unsigned threads = 0;
+        // Ranks taking part; others may pass MPI_COMM_NULL and get 0
+        MPI_Comm comm = MPI_COMM_WORLD;
+        Schedule schedule = Schedule::Static;
+        std::size_t min_chunk = std::size_t(1) << 14;   // Dynamic: smallest chunk, in grid points
+    };
+
+    // What this rank did in one call
+    struct MpiStats {
+        std::size_t chunks = 0;
+        std::size_t points = 0;
+        double compute_seconds = 0.0;   // in the engine
+        double reduce_seconds = 0.0;    // from the last chunk to the result
+    };
+
+    // MPI_Init_thread with MPI_THREAD_FUNNELED: worker threads only compute and
+    // the calling thread does all MPI calls. Returns the provided level; below
+    // FUNNELED the threaded engines fall back to Serial.
+    int init_funneled(int* argc, char*** argv);
+
+    // WEIER_MPI_ENGINE=serial|threads|openmp, WEIER_MPI_THREADS and
+    // WEIER_MPI_SCHEDULE=static|dynamic from the environment
+    MpiOptions default_options();
+    const char* engine_name(Engine engine);
+    const char* schedule_name(Schedule schedule);
+
+    // Engine that actually runs: Serial below MPI_THREAD_FUNNELED, Threads for
+    // OpenMP in builds without it
+    Engine resolve_engine(Engine engine);
+    // Threads per rank the options resolve to; collective over options.comm.
+    // Also fixes where the rank's pinned workers start: ranks the launcher did
+    // not bind share the node's mask, and node rank r takes slots from
+    // r * threads of common::Topology::assign, so they pin to disjoint CPUs.
+    unsigned resolve_threads(const MpiOptions& options);
+
+    // Sum of the integrand at x0 + h*(i + 0.5), i in [begin, end), without the
+    // factor h, on this rank alone with a resolved engine and thread count;
+    // not collective. Reproducible plans sum [begin, end) in fixed blocks.
+    double sum_weierstrass_range_local(const common::WeierstrassPlan& plan, double x0, double h, std::size_t begin,
+                                       std::size_t end, Engine engine, unsigned threads);
+    // out[j] = sum over job j's points in rank's equal share of the batch's
+    // concatenated grid (see common::BatchPlan::pieces), without the factor h,
+    // on this rank alone; not collective
+    void sum_weierstrass_batch_share(const common::BatchPlan& batch, int rank, int ranks, double* out, Engine engine,
+                                     unsigned threads);
+
+    // Each rank sums its range with the engine; rank partials are reduced inside
+    // each node first, and only one partial per node enters MPI_Allreduce.
+    // Under Dynamic the node-level MPI_Ireduce is posted as soon as the rank's
+    // chunks are done and runs while the collective teardown of the chunk
+    // counter's window waits for the slower ranks.
+    // Collective over options.comm; every rank gets the result. The range sum
+    // (see common/integrand.hpp) must be the same on every rank.
+    double integrate_mpi(const common::RangeSum& sum, const common::PrecisionPolicy& precision, double x0, double x1,
+                         std::size_t steps, const MpiOptions& options, MpiStats* stats = nullptr);
+    // Midpoint rule over any integrand, e.g. common::WeierstrassN<30>() or a lambda
+    template <class F>
+    double integrate_mpi(const F& f, double x0, double x1, std::size_t steps,
+                         const MpiOptions& options = default_options(), MpiStats* stats = nullptr) {
+        return integrate_mpi(common::range_sum(f), common::precision_of(f), x0, x1, steps, options, stats);
+    }
+
+    // The Weierstrass function through its plan (common::PlanIntegrand)
     double integrate_weierstrass_mpi(double a, double b, std::size_t n, double x0, double x1, std::size_t steps);
-}
\ No newline at end of file
+    double integrate_weierstrass_mpi(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps);
+    double integrate_weierstrass_mpi(const common::WeierstrassPlan& plan, double x0, double x1, std::size_t steps,
+                                     const MpiOptions& options, MpiStats* stats = nullptr);
+
+    // results[j] = integral of jobs[j], j < count: ranks take equal shares of
+    // the batch's concatenated grid and the per-job sums meet in one
+    // MPI_Allreduce (plus the node split of resolve_threads on first use of
+    // options.comm). Plans are built once per distinct (a, b, n).
+    // Collective over options.comm; every rank gets all results.
+    void integrate_weierstrass_batch_mpi(const common::IntegralJob* jobs, std::size_t count, double* results);
+    void integrate_weierstrass_batch_mpi(const common::IntegralJob* jobs, std::size_t count, double* results,
+                                         const MpiOptions& options);
+
+    // With common::profiling() on, every integrate_mpi / batch call records
+    // this process as worker <rank in MPI_COMM_WORLD> of group "mpi", whatever
+    // options.comm is: busy = compute_seconds, idle = reduce_seconds
+    // (collectives, including the wait for slower ranks). gather_profile
+    // collects those rows over comm on its rank 0, each labelled with the
+    // world rank and carrying the cycles and instructions of all threads of
+    // its process; other ranks get their local report. Collective over comm.
+    common::ProfileReport gather_profile(MPI_Comm comm = MPI_COMM_WORLD);
+}
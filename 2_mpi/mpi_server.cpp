@@ -0,0 +1,37 @@
+#include "job_server.hpp"
+#include <mpi.h>
+#include <cstdlib>
+#include <iostream>
+
+// Резидентный сервер интегрирования:
+//   mpirun -np 4 ./mpi_server [source] [batch] [sink]
+// source — "-" (stdin, по умолчанию), файл или FIFO заданий, unix:<путь> — локальный сокет
+// (клиент, например: socat - UNIX-CONNECT:<путь> < jobs.txt); sink — файл ответов вместо stdout.
+// Строка задания "a b n x0 x1 steps", ответ "id value seconds"; "quit" останавливает сервер.
+// Движок и потоки процессов — WEIER_MPI_ENGINE / WEIER_MPI_THREADS, сводка — в stderr.
+int main(int argc, char* argv[]) {
+    integral_mpi::init_funneled(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    integral_mpi::ServerOptions options;
+    options.mpi = integral_mpi::default_options();
+    if (argc > 1) options.source = argv[1];
+    if (argc > 2) options.batch = std::strtoul(argv[2], nullptr, 10);
+    if (argc > 3) options.sink = argv[3];
+
+    integral_mpi::ServerStats stats = integral_mpi::serve(options);
+    if (rank == 0) {
+        if (!stats.error.empty()) std::cerr << "mpi_server: " << stats.error << "\n";
+        double rate = stats.seconds > 0.0 ? stats.jobs / stats.seconds : 0.0;
+        double points = stats.seconds > 0.0 ? stats.points / stats.seconds : 0.0;
+        std::cerr << "mpi_server: " << stats.jobs << " jobs in " << stats.batches << " batches, " << stats.seconds
+                  << " s, " << rate << " jobs/s, " << points / 1e6 << " Mpoints/s\n"
+                  << "mpi_server: latency mean " << stats.mean_latency * 1e3 << " ms, p50 "
+                  << stats.p50_latency * 1e3 << " ms, p99 " << stats.p99_latency * 1e3 << " ms, max "
+                  << stats.max_latency * 1e3 << " ms\n";
+    }
+
+    MPI_Finalize();
+    return rank == 0 && !stats.error.empty() ? 1 : 0;
+}
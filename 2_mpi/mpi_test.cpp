@@ -1,25 +1,28 @@
 #include "mpi_parallel.hpp"
+#include "job_server.hpp"
 #include "../1_st_mt/cpp/common/common.hpp"
+#include "../1_st_mt/cpp/common/integrand.hpp"
+#include "../1_st_mt/cpp/common/jobs.hpp"
+#include "../1_st_mt/cpp/common/topology.hpp"
+#include "../1_st_mt/cpp/integral_single/single.hpp"
 #include <mpi.h>
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
 #include <vector>
 #include <cmath>
-
-// Simple single-threaded implementation for comparison
-double integrate_weierstrass_single(double a, double b, std::size_t n, double x0, double x1, std::size_t steps) {
-    double h = (x1 - x0) / static_cast<double>(steps);
-    double sum = 0.0;
-    for (std::size_t i = 0; i < steps; ++i) {
-        double x = x0 + h * (static_cast<double>(i) + 0.5);
-        sum += common::weierstrass(x, a, b, n);
-    }
-    return sum * h;
-}
+#include <cstdlib>
+#include <set>
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 int main(int argc, char* argv[]) {
-    MPI_Init(&argc, &argv);
+    int provided = integral_mpi::init_funneled(&argc, &argv);
     
     int rank, size;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -32,8 +35,13 @@ int main(int argc, char* argv[]) {
         {30, 1000000}
     };
 
+    integral_mpi::MpiOptions defaults = integral_mpi::default_options();
+    unsigned default_threads = integral_mpi::resolve_threads(defaults);
     if (rank == 0) {
-        std::cout << "MPI Weierstrass Integration Test (with " << size << " processes)\n";
+        std::cout << "MPI Weierstrass Integration Test (with " << size << " processes, "
+                  << integral_mpi::engine_name(integral_mpi::resolve_engine(defaults.engine)) << " engine, "
+                  << default_threads << " threads per rank"
+                  << (provided < MPI_THREAD_FUNNELED ? ", MPI_THREAD_FUNNELED not provided" : "") << ")\n";
         std::cout << std::left << std::setw(15) << "Config" 
                   << std::setw(20) << "Single Thread" 
                   << std::setw(20) << "MPI Parallel" 
@@ -42,6 +50,7 @@ int main(int argc, char* argv[]) {
         std::cout << std::string(70, '-') << "\n";
     }
 
+    bool all_ok = true;
     for (const auto &config : configs) {
         int n = config.first;
         std::size_t steps = config.second;
@@ -56,7 +65,7 @@ int main(int argc, char* argv[]) {
         // Только процесс 0 выполняет однопоточное интегрирование для сравнения
         if (rank == 0) {
             auto t_single = std::chrono::high_resolution_clock::now();
-            single_result = integrate_weierstrass_single(a, b, n, x0, x1, steps);
+            single_result = integral_single::integrate_weierstrass(a, b, n, x0, x1, steps);
             single_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t_single).count();
         }
 
@@ -69,6 +78,7 @@ int main(int argc, char* argv[]) {
 
         if (rank == 0) {
             bool check = std::abs(single_result - mpi_result) < 1e-6;
+            all_ok = all_ok && check;
             double speedup = single_time / mpi_time;
             
             std::cout << std::left << std::setw(15) << ("n=" + std::to_string(n) + ",s=" + std::to_string(steps/1000) + "k")
@@ -79,6 +89,248 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    // Перебор процессы x потоки: первые r процессов получают свой коммуникатор,
+    // каждый считает свою часть движком с t потоками
+    const int sweep_n = 20;
+    const std::size_t sweep_steps = 1000000;
+    auto sweep_plan = common::weierstrass_plan(common::WEIER_A, common::WEIER_B, sweep_n);
+    double sweep_ref = 0.0;
+    if (rank == 0) {
+        sweep_ref = integral_single::integrate_weierstrass(*sweep_plan, common::INTEGRAL_X0, common::INTEGRAL_X1,
+                                                           sweep_steps);
+        std::cout << "\nRanks x threads (n=" << sweep_n << ", s=" << sweep_steps / 1000 << "k)\n";
+        std::cout << std::left << std::setw(15) << "Ranks x thr" << std::setw(10) << "Engine" << std::setw(12) << "Time"
+                  << "Check\n";
+        std::cout << std::string(45, '-') << "\n";
+    }
+    std::vector<int> rank_counts;
+    for (int r = 1; r < size; r *= 2) rank_counts.push_back(r);
+    rank_counts.push_back(size);
+    for (int ranks : rank_counts) {
+        MPI_Comm sub;
+        MPI_Comm_split(MPI_COMM_WORLD, rank < ranks ? 0 : MPI_UNDEFINED, rank, &sub);
+        for (integral_mpi::Engine engine : {integral_mpi::Engine::Threads, integral_mpi::Engine::OpenMP}) {
+            for (unsigned threads : {1u, 2u, 4u}) {
+                integral_mpi::MpiOptions options;
+                options.engine = engine;
+                options.threads = threads;
+                options.comm = sub;
+                MPI_Barrier(MPI_COMM_WORLD);
+                auto t = std::chrono::high_resolution_clock::now();
+                double r = integral_mpi::integrate_weierstrass_mpi(*sweep_plan, common::INTEGRAL_X0,
+                                                                   common::INTEGRAL_X1, sweep_steps, options);
+                double dt = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t).count();
+                if (rank == 0) {
+                    bool check = std::abs(sweep_ref - r) < 1e-6;
+                    all_ok = all_ok && check;
+                    std::cout << std::left << std::setw(15) << (std::to_string(ranks) + " x " + std::to_string(threads))
+                              << std::setw(10) << integral_mpi::engine_name(integral_mpi::resolve_engine(engine))
+                              << std::setw(12) << (std::to_string(dt).substr(0, 6) + "s") << (check ? "OK" : "FAIL")
+                              << "\n";
+                }
+            }
+        }
+        if (sub != MPI_COMM_NULL) MPI_Comm_free(&sub);
+    }
+
+    // Динамическое расписание: куски раздаются счётчиком, печатаем доли процессов
+    integral_mpi::MpiOptions dynamic = defaults;
+    dynamic.schedule = integral_mpi::Schedule::Dynamic;
+    integral_mpi::MpiStats stats;
+    MPI_Barrier(MPI_COMM_WORLD);
+    auto t_dyn = std::chrono::high_resolution_clock::now();
+    double dyn_result = integral_mpi::integrate_weierstrass_mpi(*sweep_plan, common::INTEGRAL_X0, common::INTEGRAL_X1,
+                                                                sweep_steps, dynamic, &stats);
+    double dyn_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - t_dyn).count();
+    unsigned long long mine[2] = {stats.points, stats.chunks};
+    std::vector<unsigned long long> shares(2 * size);
+    MPI_Gather(mine, 2, MPI_UNSIGNED_LONG_LONG, shares.data(), 2, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        bool check = std::abs(sweep_ref - dyn_result) < 1e-6;
+        unsigned long long total = 0;
+        for (int r = 0; r < size; ++r) total += shares[2 * r];
+        check = check && total == sweep_steps;
+        all_ok = all_ok && check;
+        std::cout << "\nDynamic schedule (n=" << sweep_n << ", s=" << sweep_steps / 1000 << "k): "
+                  << std::to_string(dyn_time).substr(0, 6) << "s, " << (check ? "OK" : "FAIL") << "\n";
+        for (int r = 0; r < size; ++r) {
+            std::cout << "  rank " << r << ": " << shares[2 * r] << " points in " << shares[2 * r + 1] << " chunks\n";
+        }
+    }
+
+    // Воспроизводимый режим: побитно равен однопоточной сумме блоков при любом числе процессов
+    // и при любом расписании
+    common::PrecisionPolicy repro = common::default_precision();
+    repro.reproducible = true;
+    auto plan = common::weierstrass_plan(common::WEIER_A, common::WEIER_B, 20, common::Reduction::Standard, repro);
+    double mpi_repro = integral_mpi::integrate_weierstrass_mpi(*plan, common::INTEGRAL_X0, common::INTEGRAL_X1, 100000);
+    dynamic.min_chunk = common::REPRO_BLOCK;
+    double dyn_repro = integral_mpi::integrate_weierstrass_mpi(*plan, common::INTEGRAL_X0, common::INTEGRAL_X1, 100000,
+                                                               dynamic);
+    if (rank == 0) {
+        double h = (common::INTEGRAL_X1 - common::INTEGRAL_X0) / 100000.0;
+        double ref = common::weierstrass_midpoint_sum_reproducible(*plan, common::INTEGRAL_X0, h, 0, 100000) * h;
+        bool check = mpi_repro == ref && dyn_repro == ref;
+        all_ok = all_ok && check;
+        std::cout << "Reproducible (n=20, s=100k, static and dynamic): " << (check ? "OK, bit-identical" : "FAIL")
+                  << "\n";
+    }
+
+    // Обобщённый интерфейс: произвольное ядро и WeierstrassN<N> на тех же движках
+    {
+        double e1 = integral_mpi::integrate_mpi([](double x) { return std::exp(x); }, 0.0, 1.0, 100000);
+        auto plan5 = common::weierstrass_plan(common::WEIER_A, common::WEIER_B, 5);
+        double fixed = integral_mpi::integrate_mpi(common::FixedWeierstrass(*plan5), common::INTEGRAL_X0,
+                                                   common::INTEGRAL_X1, 100000);
+        if (rank == 0) {
+            double ref = integral_single::integrate(common::WeierstrassN<5>(), common::INTEGRAL_X0,
+                                                    common::INTEGRAL_X1, 100000);
+            bool check = std::abs(e1 - (std::exp(1.0) - 1.0)) < 1e-10 && std::abs(fixed - ref) < 1e-13;
+            all_ok = all_ok && check;
+            std::cout << "Generic integrands (exp, WeierstrassN<5>): " << (check ? "OK" : "FAIL") << "\n";
+        }
+    }
+
+    // Пакет: одна коллективная операция на 64 задания, сверка с однопоточным пакетом
+    std::vector<common::IntegralJob> batch(64);
+    for (std::size_t j = 0; j < batch.size(); ++j) {
+        batch[j].n = 5 + j % 3 * 10;
+        batch[j].x1 = common::INTEGRAL_X1 + 0.01 * static_cast<double>(j);
+        batch[j].steps = 1000 + 311 * j;
+    }
+    std::vector<double> batch_mpi(batch.size()), batch_ref(batch.size());
+    integral_mpi::integrate_weierstrass_batch_mpi(batch.data(), batch.size(), batch_mpi.data());
+    if (rank == 0) {
+        integral_single::integrate_weierstrass_batch(batch.data(), batch.size(), batch_ref.data());
+        bool check = true;
+        for (std::size_t j = 0; j < batch.size(); ++j) check = check && std::abs(batch_mpi[j] - batch_ref[j]) < 1e-12;
+        all_ok = all_ok && check;
+        std::cout << "Batch (" << batch.size() << " jobs, one collective): " << (check ? "OK" : "FAIL") << "\n";
+    }
+
+    // Резидентный сервер: задания из файла батчами по 2, ответы сверяются с однопоточным
+    integral_mpi::ServerOptions server;
+    server.source = "/tmp/weier_mpi_test_jobs.txt";
+    server.sink = "/tmp/weier_mpi_test_results.txt";
+    server.batch = 2;
+    std::vector<std::pair<int, std::size_t>> jobs = {{10, 10000}, {20, 100000}, {5, 3000}, {30, 20000}, {20, 7}};
+    if (rank == 0) {
+        std::ofstream out(server.source);
+        out << "# a b n x0 x1 steps\n";
+        for (const auto& job : jobs)
+            out << common::WEIER_A << ' ' << common::WEIER_B << ' ' << job.first << ' ' << common::INTEGRAL_X0 << ' '
+                << common::INTEGRAL_X1 << ' ' << job.second << "\n";
+        out << "not a job\n";
+        // n за пределом double для b^n, n и steps сверх ограничений сервера
+        out << "0.5 30 300 0 1 1000\n";
+        out << "0.5 1 1000000000 0 1 1000\n";
+        out << "0.5 30 5 0 1 1000000000000000\n";
+    }
+    integral_mpi::ServerStats served = integral_mpi::serve(server);
+    if (rank == 0) {
+        std::ifstream in(server.sink);
+        bool check = served.error.empty() && served.jobs == jobs.size() + 4;
+        for (std::size_t j = 0; j < jobs.size(); ++j) {
+            std::size_t id = 0;
+            double value = 0.0, latency = 0.0;
+            in >> id >> value >> latency;
+            double ref = integral_single::integrate_weierstrass(common::WEIER_A, common::WEIER_B, jobs[j].first,
+                                                                common::INTEGRAL_X0, common::INTEGRAL_X1,
+                                                                jobs[j].second);
+            check = check && in && id == j && std::abs(value - ref) < 1e-6;
+        }
+        std::string id, word, reason;
+        for (int e = 0; e < 4; ++e) {
+            check = check && (in >> id >> word) && word == "error" && std::getline(in, reason);
+            if (e > 0) check = check && reason == " bad parameters";
+        }
+        all_ok = all_ok && check;
+        std::cout << "Job server (" << served.jobs << " jobs, " << served.batches << " batches): "
+                  << (check ? "OK" : "FAIL") << "\n";
+        std::remove(server.source.c_str());
+        std::remove(server.sink.c_str());
+    }
+
+    // WEIER_PROFILE=1: время вычислений и коллективных операций по процессам
+    if (common::profiling()) {
+        common::ProfileReport report = integral_mpi::gather_profile();
+        if (rank == 0) std::cout << "\n" << common::profile_text(report);
+    }
+
+    // Строки профиля помечены номером в MPI_COMM_WORLD: запуски на коммуникаторе
+    // с обратным порядком номеров и на MPI_COMM_WORLD копятся в одной строке процесса
+    {
+        bool was_profiling = common::profiling();
+        common::reset_profile();
+        common::set_profiling(true);
+        MPI_Comm reversed;
+        MPI_Comm_split(MPI_COMM_WORLD, 0, size - 1 - rank, &reversed);
+        integral_mpi::MpiOptions options = defaults;
+        for (MPI_Comm comm : {reversed, MPI_COMM_WORLD}) {
+            options.comm = comm;
+            integral_mpi::integrate_weierstrass_mpi(*sweep_plan, common::INTEGRAL_X0, common::INTEGRAL_X1, 10000,
+                                                    options);
+        }
+        common::ProfileReport report = integral_mpi::gather_profile(reversed);
+        common::set_profiling(was_profiling);
+        common::reset_profile();
+        int reversed_rank;
+        MPI_Comm_rank(reversed, &reversed_rank);
+        int check = 1;
+        if (reversed_rank == 0) {
+            std::vector<int> seen(size, 0);
+            for (const common::WorkerProfile& w : report.workers) {
+                if (w.group != "mpi") continue;
+                check = check && w.worker < static_cast<unsigned>(size) && w.runs == 2;
+                if (w.worker < static_cast<unsigned>(size)) ++seen[w.worker];
+            }
+            for (int s : seen) check = check && s == 1;
+        }
+        MPI_Bcast(&check, 1, MPI_INT, 0, reversed);
+        MPI_Comm_free(&reversed);
+        all_ok = all_ok && check;
+        if (rank == 0) std::cout << "Profile rows by world rank: " << (check ? "OK" : "FAIL") << "\n";
+    }
+
+#ifdef __linux__
+    // WEIER_PLACEMENT у процессов без привязки от запускающей программы: процесс r
+    // узла закрепляется со слота r * threads, а не на первом CPU маски вместе со всеми
+    if (integral_mpi::resolve_engine(defaults.engine) != integral_mpi::Engine::Serial) {
+        const char* env = std::getenv("WEIER_PLACEMENT");
+        std::string saved = env ? env : "";
+        setenv("WEIER_PLACEMENT", "all", 1);
+        integral_mpi::MpiOptions options = defaults;
+        options.engine = integral_mpi::Engine::Threads;
+        options.schedule = integral_mpi::Schedule::Static;
+        options.threads = 1;
+        int cpu = -1;
+        integral_mpi::integrate_mpi([&cpu](double x) { cpu = sched_getcpu(); return x; }, 0.0, 1.0, 1000, options);
+        if (env) setenv("WEIER_PLACEMENT", saved.c_str(), 1);
+        else unsetenv("WEIER_PLACEMENT");
+
+        MPI_Comm node;
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &node);
+        int local, local_rank;
+        MPI_Comm_size(node, &local);
+        MPI_Comm_rank(node, &local_rank);
+        const common::Topology& topo = common::Topology::system();
+        unsigned cpus = static_cast<unsigned>(topo.cpus().size());
+        bool bound = cpus < std::thread::hardware_concurrency();
+        int expected = topo.assign(common::Placement::All, 1, bound ? 0 : static_cast<unsigned>(local_rank))[0].cpu;
+        std::vector<int> node_cpus(local);
+        MPI_Allgather(&cpu, 1, MPI_INT, node_cpus.data(), 1, MPI_INT, node);
+        MPI_Comm_free(&node);
+        int check = cpu == expected;
+        if (!bound && static_cast<unsigned>(local) <= cpus)
+            check = check && std::set<int>(node_cpus.begin(), node_cpus.end()).size() == node_cpus.size();
+        MPI_Allreduce(MPI_IN_PLACE, &check, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        all_ok = all_ok && check;
+        if (rank == 0)
+            std::cout << "Placement of unbound ranks (" << local << " per node, " << cpus << " CPUs): "
+                      << (check ? "OK" : "FAIL") << "\n";
+    }
+#endif
+
     MPI_Finalize();
-    return 0;
-}
\ No newline at end of file
+    return rank == 0 && !all_ok ? 1 : 0;
+}